@@ -0,0 +1,316 @@
+/*
+ *  drvbench.c
+ *  Throughput of the I2C, UART and MMA8450Q drivers built against the
+ *  simulated registers. For each driver call it reports the simulated
+ *  SMCLK cycles spent blocking on the bus (which is what limits the
+ *  firmware's sample rate), the register accesses and bus bytes it takes,
+ *  and the host time per call. A second accelerometer at 0x1D is on the
+ *  bus for MMA8450ReadAvg.
+ *
+ *  The wheel encoder driver is fed synthetic quadrature edge sequences on
+ *  the Timer A capture inputs: steady speeds both ways, missed edges and
+ *  jitter at a standstill. For each it reports the count, errors and speed
+ *  the driver measured against what was fed, the speed once the edges
+ *  stop, and the register accesses of the Timer A interrupt per edge, the
+ *  loop tick's included.
+ *
+ *  Usage: drvbench [iterations]
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - wheel encoder edge sequences
+ *             10/19/26 - two accelerometers
+ *             10/19/26 - watchdog held, it runs from reset
+ */
+
+#include "msp430_sim.h"
+#include "mma8450q_model.h"
+#include "i2c/i2c.h"
+#include "uart/uart.h"
+#include "mma8450q/mma8450q.h"
+#include "encoder/encoder.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+#define NEVER           UINT64_MAX
+// estimator velocity units per mm/s, see config.h
+#define VEL_PER_MM_S    (1000.0 * ACCEL_COUNTS_PER_G * TICK_HZ / \
+                         ((double)GRAVITY_UM_S2 * AVG_SAMPLES))
+
+typedef void (*BenchFunc)(void);
+
+// a synthetic edge sequence on the encoder inputs
+typedef struct
+{
+    const char * name;
+    long mmPerS;        // speed, negative backwards
+    long edges;         // edges fed
+    int skipEvery;      // every nth edge changes both channels, 0 for none
+    int jitter;         // every other edge undoes the one before
+} EncSeq;
+
+// edge generator driven by Advance
+typedef struct
+{
+    uint64_t next;      // cycle count of the next edge, NEVER when idle
+    uint32_t period;    // cycles between edges
+    long left;          // edges still to feed
+    long pos;           // position in counts
+    long n;             // edges fed
+    int dir;
+    const EncSeq * seq;
+} EncFeed;
+
+static MMAModel mma[MMA_MAX_DEVICES];
+static MMA8450 dev[MMA_MAX_DEVICES];
+static EncFeed feed = {NEVER, 0, 0, 0, 0, 0, NULL};
+static uint8_t motorCmd[] = {64, 192};
+
+static const EncSeq encSeqs[] =
+{
+    {"forward 1500 mm/s",   1500, 2000, 0, 0},
+    {"reverse 300 mm/s",    -300,  400, 0, 0},
+    {"forward 30 mm/s",       30,   40, 0, 0},
+    {"missed edges",         800,  996, 10, 0},
+    {"jitter at rest",       100,  200, 0, 1},
+};
+
+void TimerA1Interrupt(void)
+{
+    // the encoder cases of main.c's interrupt
+    switch(TAIV)
+    {
+        case TAIV_TAIFG:
+            EncoderTick();
+            break;
+        case TAIV_TACCR1:
+            EncoderEdge(ENC_A);
+            break;
+        case TAIV_TACCR2:
+            EncoderEdge(ENC_B);
+            break;
+        default:
+            break;
+    }
+}
+
+static void FeedEdges(uint64_t cycles)
+//-------------------------------------------------------------------------
+// Func:  Drive the encoder inputs with the edges due up to cycles
+//-------------------------------------------------------------------------
+{
+    static const uint8_t gray[4] =
+        {0, ENC_A_P1, ENC_A_P1 | ENC_B_P1, ENC_B_P1};  // A leads forward
+    while(feed.next <= cycles)
+    {
+        const EncSeq * seq = feed.seq;
+        feed.n++;
+        if(seq->jitter)
+        {
+            feed.pos += (feed.n & 1) ? feed.dir : -feed.dir;
+        }
+        else if(seq->skipEvery && feed.n % seq->skipEvery == 0)
+        {
+            feed.pos += 2 * feed.dir;
+        }
+        else
+        {
+            feed.pos += feed.dir;
+        }
+        SimSetInputsAt(1, ENC_A_P1 | ENC_B_P1, gray[feed.pos & 3], feed.next);
+        feed.next = (--feed.left > 0) ? feed.next + feed.period : NEVER;
+    }
+}
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void Advance(void * ctx, uint64_t cycles)
+{
+    // keep the accelerometer producing samples at rest
+    static const double g[3] = {0, 0, 1};
+    int i;
+    (void)ctx;
+    for(i = 0; i < MMA_MAX_DEVICES; i++)
+    {
+        while(mma[i].nextSample <= cycles)
+        {
+            uint32_t period = MMAModelPeriod(&mma[i]);
+            MMAModelSample(&mma[i], g);
+            mma[i].nextSample = period ? mma[i].nextSample + period : UINT64_MAX;
+        }
+    }
+    FeedEdges(cycles);
+}
+
+static uint64_t NextInput(void * ctx)
+{
+    (void)ctx;
+    return feed.next;
+}
+
+static void ReadXYZ(void)
+{
+    int16_t data[3];
+    MMA8450ReadXYZ(&dev[0], data);
+}
+
+static void ReadAvg(void)
+{
+    int16_t data[3];
+    MMA8450ReadAvg(dev, MMA_MAX_DEVICES, data);
+}
+
+static void ReadRegister(void)
+{
+    I2CReadRegister(MMA_STATUS);
+}
+
+static void SendRegister(void)
+{
+    I2CSendRegister(OFF_X, 0);
+}
+
+static void SendMotor(void)
+{
+    UARTSend(motorCmd, 2);
+}
+
+static int BenchEncoder(const EncSeq * seq)
+//-------------------------------------------------------------------------
+// Func:  Feed an edge sequence to the encoder driver and print what it
+//        measured against what was fed
+// Retn:  1 if the count, errors or speed are off, 0 otherwise
+//-------------------------------------------------------------------------
+{
+    long speed = seq->mmPerS < 0 ? -seq->mmPerS : seq->mmPerS;
+    long counts = seq->jitter ? 0 : seq->edges +
+                  (seq->skipEvery ? seq->edges / seq->skipEvery : 0);
+    long errors = seq->skipEvery ? seq->edges / seq->skipEvery : 0;
+    double expect = seq->jitter ? 0 : seq->mmPerS;
+    int32_t dist = EncoderDistance();
+    uint16_t err = EncoderErrors();
+    unsigned long accesses = SimGetStats()->accesses;
+    double measured;
+    double stopped;
+    int bad;
+
+    if(seq->mmPerS < 0)
+    {
+        counts = -counts;
+    }
+    feed.seq = seq;
+    feed.dir = seq->mmPerS < 0 ? -1 : 1;
+    feed.period = (uint32_t)(ENC_UM_PER_COUNT * (double)SMCLK_HZ / 1000 / speed + 0.5);
+    feed.left = seq->edges;
+    feed.n = 0;
+    feed.next = SimCycles() + feed.period;
+    __delay_cycles((uint32_t)seq->edges * feed.period);
+    measured = EncoderSpeed() / VEL_PER_MM_S;
+    dist = EncoderDistance() - dist;
+    err = EncoderErrors() - err;
+    accesses = SimGetStats()->accesses - accesses;
+    __delay_cycles(ENC_STOP_CYCLES + 2 * SLOW_TACCR0);
+    stopped = EncoderSpeed() / VEL_PER_MM_S;
+
+    bad = dist != counts || err != errors || stopped != 0 ||
+          (measured - expect) > 0.01 * speed || (expect - measured) > 0.01 * speed;
+    printf("%-22s %6ld %7ld %7ld %6u %6ld %8.1f %8.1f %7.1f %9.1f %6s\n",
+           seq->name, seq->edges, (long)dist, counts, err, errors, measured,
+           expect, stopped, accesses / (double)seq->edges, bad ? "FAIL" : "ok");
+    return bad;
+}
+
+static void Bench(const char * name, BenchFunc f, long iterations)
+//-------------------------------------------------------------------------
+// Func:  Run a driver call repeatedly and print its per call cost
+//-------------------------------------------------------------------------
+{
+    SimStats before = *SimGetStats();
+    uint64_t cycles = SimCycles();
+    double start = NowNs();
+    long i;
+
+    for(i = 0; i < iterations; i++)
+    {
+        f();
+    }
+
+    double ns = (NowNs() - start) / iterations;
+    const SimStats * after = SimGetStats();
+    double perCall = (double)(SimCycles() - cycles) / iterations;
+    printf("%-22s %10.1f %10.1f %9.1f %9.1f %9.1f %10.0f\n", name, perCall,
+           (after->accesses - before.accesses) / (double)iterations,
+           (after->i2cBytes - before.i2cBytes) / (double)iterations,
+           (after->uartBytes - before.uartBytes) / (double)iterations,
+           ns, SMCLK_HZ / perCall);
+}
+
+int main(int argc, char ** argv)
+{
+    long iterations = (argc > 1) ? atol(argv[1]) : 10000;
+    SimI2CDevice bus;
+    SimWorld world = {Advance, NULL, NULL, NextInput};
+    int failed = 0;
+    unsigned i;
+
+    if(iterations <= 0)
+    {
+        fprintf(stderr, "usage: drvbench [iterations]\n");
+        return 2;
+    }
+
+    SimReset();
+    WDTCTL = WDTPW | WDTHOLD;   // runs from reset, as on the MCU
+    for(i = 0; i < MMA_MAX_DEVICES; i++)
+    {
+        MMAModelInit(&mma[i], 0.005, 1 + i);
+        MMAModelDevice(&mma[i], &bus);
+        bus.addr = i ? MMA_ADDR_SA0_1 : MMA_ADDR_SA0_0;
+        SimAttachI2C(&bus);
+    }
+    SimSetWorld(&world);
+
+    UARTInit();
+    MMA8450InitBus();
+    for(i = 0; i < MMA_MAX_DEVICES; i++)
+    {
+        if(!MMA8450Init(&dev[i], i ? MMA_ADDR_SA0_1 : MMA_ADDR_SA0_0))
+        {
+            fprintf(stderr, "drvbench: no accelerometer at 0x%02X\n", dev[i].addr);
+            return 1;
+        }
+    }
+
+    printf("SMCLK 1 MHz, I2C SMCLK/%u, UART SMCLK/%u, %ld iterations\n",
+           UCB0BR0 | (UCB0BR1 << 8), UCA0BR0 | (UCA0BR1 << 8), iterations);
+    printf("%-22s %10s %10s %9s %9s %9s %10s\n", "call", "cycles", "accesses",
+           "i2c_B", "uart_B", "host_ns", "calls/s");
+    Bench("MMA8450ReadXYZ", ReadXYZ, iterations);
+    Bench("MMA8450ReadAvg (2)", ReadAvg, iterations);
+    Bench("I2CReadRegister", ReadRegister, iterations);
+    Bench("I2CSendRegister", SendRegister, iterations);
+    Bench("UARTSend (2 bytes)", SendMotor, iterations);
+
+    TACCR0 = TICK_TACCR0;                   // the control loop tick, which
+    TACTL = TASSEL_2 | ID_0 | MC_1 | TAIE;  // times the edges
+    EncoderInit();
+    __enable_interrupt();
+    printf("\nencoder, %ld um per count\n", (long)ENC_UM_PER_COUNT);
+    printf("%-22s %6s %7s %7s %6s %6s %8s %8s %7s %9s %6s\n", "sequence",
+           "edges", "counts", "expect", "errors", "expect", "mm/s", "expect",
+           "stopped", "acc/edge", "result");
+    for(i = 0; i < sizeof(encSeqs) / sizeof(encSeqs[0]); i++)
+    {
+        failed |= BenchEncoder(&encSeqs[i]);
+    }
+
+    return failed;
+}
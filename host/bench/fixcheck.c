@@ -0,0 +1,386 @@
+/*
+ *  fixcheck.c
+ *  Checks src/fixmath bit for bit against plain C arithmetic in 64 bits.
+ *  Every routine runs over its edge cases and a sweep of inputs, all of
+ *  one operand where that is cheap enough to run on each build, and a
+ *  pseudo random sample of the rest. The constant multiplies and divides
+ *  are checked for every 16 bit constant with the macros evaluated at run
+ *  time, and for the constants the firmware uses as the compiler folds
+ *  them. The cycle counts on the MSP430 are cyclebench's (mspbench).
+ *
+ *  The packed 12 bit samples of src/pack12 are checked the same way,
+ *  against the low 12 bits of every sample they were given.
+ *
+ *  Usage: fixcheck
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - packed 12 bit samples
+ */
+
+#include "fixmath/fixmath.h"
+#include "pack12/pack12.h"
+#include "config.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define MAX_SHOWN       5       // mismatches printed per routine
+
+typedef struct
+{
+    const char * name;
+    unsigned long cases;
+    unsigned long errors;
+} Check;
+
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t Rand32(void)
+{
+    // xorshift64*, deterministic so a failure repeats
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (uint32_t)((rngState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static void Expect(Check * c, int64_t got, int64_t want, int64_t a, int64_t b)
+//-------------------------------------------------------------------------
+// Func:  Count a case, and print the first few mismatches
+//-------------------------------------------------------------------------
+{
+    c->cases++;
+    if(got != want)
+    {
+        if(c->errors < MAX_SHOWN)
+        {
+            printf("  %s(%lld, %lld) = %lld, expected %lld\n", c->name,
+                   (long long)a, (long long)b, (long long)got, (long long)want);
+        }
+        c->errors++;
+    }
+}
+
+static int64_t RefRound(int64_t p, int shift, int64_t max)
+//-------------------------------------------------------------------------
+// Func:  p * 2^-shift rounded half away from zero, saturated at max
+//-------------------------------------------------------------------------
+{
+    uint64_t m = (p < 0) ? -(uint64_t)p : (uint64_t)p;
+    int64_t r = (int64_t)((m + (1ULL << (shift - 1))) >> shift);
+    if(p < 0)
+    {
+        return -r;
+    }
+    return r > max ? max : r;
+}
+
+static int64_t RefSat(int64_t s, int64_t min, int64_t max)
+{
+    return s < min ? min : s > max ? max : s;
+}
+
+static uint32_t RefISqrt(uint64_t v)
+{
+    uint64_t r = (uint64_t)sqrt((double)v);
+    while(r * r > v)
+    {
+        r--;
+    }
+    while((r + 1) * (r + 1) <= v)
+    {
+        r++;
+    }
+    return (uint32_t)r;
+}
+
+static void CheckMulConst(Check * c)
+{
+    static const int32_t edge[] = {0, 1, -1, 2, 32767, -32768, 65535, 65536,
+                                   INT32_MAX, INT32_MIN};
+    uint32_t k;
+    unsigned i;
+
+    for(k = 0; k < 65536; k++)
+    {
+        for(i = 0; i < sizeof(edge) / sizeof(edge[0]); i++)
+        {
+            Expect(c, FIX_MULU_CONST(edge[i], k), (uint32_t)edge[i] * k, edge[i], k);
+        }
+        for(i = 0; i < 16; i++)
+        {
+            int32_t x = (int32_t)Rand32() >> (Rand32() & 31);
+            Expect(c, FIX_MUL_CONST(x, k), (int32_t)((uint32_t)x * k), x, k);
+        }
+    }
+    // as the estimator folds them, over every velocity and count it can see
+    for(i = 0; i < 200000; i++)
+    {
+        int32_t v = (int32_t)(Rand32() % (2UL * VEL_FROM_MM_S(SPEED_MAX_MM_S) + 1)) -
+                    VEL_FROM_MM_S(SPEED_MAX_MM_S);
+        int32_t n = (int32_t)(Rand32() & 0xFFFF) - 32768;
+        Expect(c, FIX_MUL_CONST(v, BRAKE_TICKS_Q8), v * BRAKE_TICKS_Q8, v, BRAKE_TICKS_Q8);
+        Expect(c, FIX_MUL_CONST(n, ENC_DIST_PER_COUNT), n * ENC_DIST_PER_COUNT,
+               n, ENC_DIST_PER_COUNT);
+    }
+}
+
+static void CheckDivConst(Check * cu, Check * cs)
+{
+    static const uint16_t dFull[] = {3, 5, 7, 10, 100, 641, 1000, 4095, 32767,
+                                     32768, 32769, 65535};
+    uint32_t d, x;
+    unsigned i;
+
+    for(d = 1; d < 65536; d++)
+    {
+        // the edges around multiples of d, where truncation changes
+        for(i = 0; i < 8; i++)
+        {
+            uint32_t q = Rand32() % (65536 / d);
+            uint32_t m = q * d;
+            Expect(cu, FIX_DIVU_CONST(m, d), m / d, m, d);
+            if(m > 0)
+            {
+                Expect(cu, FIX_DIVU_CONST(m - 1, d), (m - 1) / d, m - 1, d);
+            }
+            x = Rand32() & 0xFFFF;
+            Expect(cu, FIX_DIVU_CONST(x, d), x / d, x, d);
+        }
+        Expect(cu, FIX_DIVU_CONST(65535, d), 65535 / d, 65535, d);
+        if(d < 32768)
+        {
+            int32_t s = -(int32_t)(Rand32() & 0x7FFF);
+            Expect(cs, FIX_DIV_CONST(s, d), s / (int32_t)d, s, d);
+            Expect(cs, FIX_DIV_CONST(-32768, d), -32768 / (int32_t)d, -32768, d);
+        }
+    }
+    for(d = 1; d <= 64; d++)
+    {
+        for(x = 0; x < 65536; x++)
+        {
+            Expect(cu, FIX_DIVU_CONST(x, d), x / d, x, d);
+        }
+    }
+    for(i = 0; i < sizeof(dFull) / sizeof(dFull[0]); i++)
+    {
+        for(x = 0; x < 65536; x++)
+        {
+            int32_t s = (int16_t)x;
+            Expect(cu, FIX_DIVU_CONST(x, dFull[i]), x / dFull[i], x, dFull[i]);
+            if(dFull[i] < 32768)
+            {
+                Expect(cs, FIX_DIV_CONST(s, dFull[i]), s / dFull[i], s, dFull[i]);
+            }
+        }
+    }
+    // a constant the compiler folds
+    for(x = 0; x < 65536; x++)
+    {
+        Expect(cu, FIX_DIVU_CONST(x, 1000), x / 1000, x, 1000);
+    }
+}
+
+static void CheckMul16(Check * cm, Check * c15)
+{
+    static const int32_t edge[] = {0, 1, -1, 2, 0x4000, -0x4000, 32767, -32767,
+                                   -32768, 0x5555, -0x5555};
+    uint32_t a;
+    unsigned i;
+
+    for(a = 0; a < 65536; a++)
+    {
+        for(i = 0; i < sizeof(edge) / sizeof(edge[0]); i++)
+        {
+            uint16_t b = (uint16_t)edge[i];
+            Expect(cm, FixMulU16(a, b), a * b, a, b);
+            Expect(c15, FixMulQ15((int16_t)a, (int16_t)edge[i]),
+                   RefRound((int64_t)(int16_t)a * edge[i], 15, Q15_MAX),
+                   (int16_t)a, edge[i]);
+        }
+        for(i = 0; i < 8; i++)
+        {
+            uint16_t b = Rand32();
+            Expect(cm, FixMulU16(a, b), a * b, a, b);
+            Expect(c15, FixMulQ15((int16_t)a, (int16_t)b),
+                   RefRound((int64_t)(int16_t)a * (int16_t)b, 15, Q15_MAX),
+                   (int16_t)a, (int16_t)b);
+        }
+    }
+}
+
+static void CheckMulQ31(Check * c)
+{
+    static const int32_t edge[] = {0, 1, -1, 0x40000000, -0x40000000,
+                                   INT32_MAX, -INT32_MAX, INT32_MIN, 0x10000,
+                                   0xFFFF, -0x10000, 0x7FFF8000};
+    unsigned i, j;
+
+    for(i = 0; i < sizeof(edge) / sizeof(edge[0]); i++)
+    {
+        for(j = 0; j < sizeof(edge) / sizeof(edge[0]); j++)
+        {
+            Expect(c, FixMulQ31(edge[i], edge[j]),
+                   RefRound((int64_t)edge[i] * edge[j], 31, Q31_MAX), edge[i], edge[j]);
+        }
+    }
+    for(i = 0; i < 1000000; i++)
+    {
+        int32_t a = (int32_t)Rand32() >> (Rand32() & 15);
+        int32_t b = (int32_t)Rand32();
+        Expect(c, FixMulQ31(a, b), RefRound((int64_t)a * b, 31, Q31_MAX), a, b);
+    }
+}
+
+static void CheckAdd(Check * c15, Check * c31)
+{
+    static const int32_t edge[] = {0, 1, -1, INT32_MAX, INT32_MIN, INT32_MAX - 1,
+                                   INT32_MIN + 1, 0x40000000, -0x40000000};
+    uint32_t a;
+    unsigned i, j;
+
+    for(a = 0; a < 65536; a++)
+    {
+        for(i = 0; i < 16; i++)
+        {
+            int16_t b = (i < 4) ? (int16_t)(0x7FFF + i) : (int16_t)Rand32();
+            Expect(c15, FixAddQ15((int16_t)a, b),
+                   RefSat((int16_t)a + b, Q15_MIN, Q15_MAX), (int16_t)a, b);
+        }
+    }
+    for(i = 0; i < sizeof(edge) / sizeof(edge[0]); i++)
+    {
+        for(j = 0; j < sizeof(edge) / sizeof(edge[0]); j++)
+        {
+            Expect(c31, FixAddQ31(edge[i], edge[j]),
+                   RefSat((int64_t)edge[i] + edge[j], Q31_MIN, Q31_MAX), edge[i], edge[j]);
+        }
+    }
+    for(i = 0; i < 1000000; i++)
+    {
+        int32_t x = (int32_t)Rand32();
+        int32_t y = (int32_t)Rand32();
+        Expect(c31, FixAddQ31(x, y), RefSat((int64_t)x + y, Q31_MIN, Q31_MAX), x, y);
+    }
+}
+
+static void CheckSqrt(Check * cs, Check * cm)
+{
+    uint32_t v;
+    unsigned i;
+
+    for(v = 0; v < (1UL << 22); v++)
+    {
+        Expect(cs, FixISqrt(v), RefISqrt(v), v, 0);
+    }
+    for(i = 0; i < 65536; i++)
+    {
+        uint32_t r = i;
+        Expect(cs, FixISqrt(r * r), r, r * r, 0);       // squares and one less
+        if(r > 0)
+        {
+            Expect(cs, FixISqrt(r * r - 1), r - 1, r * r - 1, 0);
+        }
+        v = Rand32();
+        Expect(cs, FixISqrt(v), RefISqrt(v), v, 0);
+    }
+    Expect(cs, FixISqrt(UINT32_MAX), 65535, UINT32_MAX, 0);
+
+    for(i = 0; i < 200000; i++)
+    {
+        int16_t vec[3];
+        int64_t sum = 0;
+        unsigned j;
+        for(j = 0; j < 3; j++)
+        {
+            vec[j] = (i < 8) ? ((i >> j) & 1 ? -32768 : 32767) :
+                               (int16_t)((int32_t)Rand32() >> (16 + (Rand32() & 7)));
+            sum += (int64_t)vec[j] * vec[j];
+        }
+        Expect(cm, FixMag3(vec), RefISqrt(sum), vec[0], vec[1]);
+    }
+}
+
+static void CheckPack12(Check * cb, Check * cg, Check * cp)
+//-------------------------------------------------------------------------
+// Func:  Pack runs of every length up to 64 samples and read them back as
+//        a run and one at a time, then overwrite single samples and check
+//        that their neighbours stay
+//-------------------------------------------------------------------------
+{
+    int16_t src[64];
+    int16_t back[64];
+    uint8_t buf[PACK12_BYTES(64) + 1];
+    unsigned n, i, k;
+
+    for(n = 0; n <= 64; n++)
+    {
+        for(k = 0; k < 500; k++)
+        {
+            for(i = 0; i < n; i++)
+            {
+                src[i] = (int16_t)Rand32();
+            }
+            buf[PACK12_BYTES(n)] = 0xA5;    // guard byte
+            Pack12(buf, src, n);
+            Unpack12(back, buf, n);
+            for(i = 0; i < n; i++)
+            {
+                Expect(cb, back[i], src[i] & 0x0FFF, n, i);
+                Expect(cg, Pack12Get(buf, i), src[i] & 0x0FFF, n, i);
+            }
+            Expect(cb, buf[PACK12_BYTES(n)], 0xA5, n, -1);
+            if(n == 0)
+            {
+                continue;
+            }
+
+            i = Rand32() % n;
+            src[i] = (int16_t)Rand32();
+            Pack12Put(buf, i, src[i]);
+            for(i = 0; i < n; i++)
+            {
+                Expect(cp, Pack12Get(buf, i), src[i] & 0x0FFF, n, i);
+            }
+            Expect(cp, buf[PACK12_BYTES(n)], 0xA5, n, -1);
+        }
+    }
+}
+
+int main(void)
+{
+    Check checks[] =
+    {
+        {"FIX_MUL_CONST", 0, 0},
+        {"FIX_DIVU_CONST", 0, 0},
+        {"FIX_DIV_CONST", 0, 0},
+        {"FixMulU16", 0, 0},
+        {"FixMulQ15", 0, 0},
+        {"FixMulQ31", 0, 0},
+        {"FixAddQ15", 0, 0},
+        {"FixAddQ31", 0, 0},
+        {"FixISqrt", 0, 0},
+        {"FixMag3", 0, 0},
+        {"Pack12/Unpack12", 0, 0},
+        {"Pack12Get", 0, 0},
+        {"Pack12Put", 0, 0},
+    };
+    unsigned i;
+    int failed = 0;
+
+    CheckMulConst(&checks[0]);
+    CheckDivConst(&checks[1], &checks[2]);
+    CheckMul16(&checks[3], &checks[4]);
+    CheckMulQ31(&checks[5]);
+    CheckAdd(&checks[6], &checks[7]);
+    CheckSqrt(&checks[8], &checks[9]);
+    CheckPack12(&checks[10], &checks[11], &checks[12]);
+
+    printf("%-16s %12s %8s\n", "routine", "cases", "errors");
+    for(i = 0; i < sizeof(checks) / sizeof(checks[0]); i++)
+    {
+        printf("%-16s %12lu %8lu\n", checks[i].name, checks[i].cases, checks[i].errors);
+        failed |= checks[i].errors != 0;
+    }
+    return failed;
+}
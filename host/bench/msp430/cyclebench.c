@@ -0,0 +1,178 @@
+/*
+ *  cyclebench.c
+ *  Target program for mspbench. Built with msp430-elf-gcc for the
+ *  MSP430F2274 and run on the instruction set simulator, it calls each hot
+ *  path of the sample loop a fixed number of times on varying inputs so
+ *  mspbench can report cycles per call and code size. Nothing is read back
+ *  from peripherals: the UART enqueue is measured with UCA0TXIFG preset,
+ *  which is its cost when the transmit buffer is free.
+ *
+ *  The samples go through both the x only path (AvgAddSample alone) and
+ *  the gravity compensated one (GravityProject, then AvgAddSample), so the
+ *  cost of the projection per sample reads off GravityProject's line.
+ *  The Kalman filter runs once per averaging period like BiasCorrect, on
+ *  an encoder count a few steps on from the last, so KalmanCheck,
+ *  KalmanMeasure and KalmanVel read against NewVel, NewDist. So does the complementary
+ *  filter, SpeedCtlModel on the last commands sent and CompVel, and the
+ *  battery: BattBlock as the ADC10 interrupt runs it, then BattScale on
+ *  the fresh block. The commands are scaled (SpeedCtlCompensate) before
+ *  each UARTSend.
+ *
+ *  The fixmath routines run next to the plain C operators they replace,
+ *  which call the libgcc multiply and divide: a constant multiply
+ *  (MulConstC/MulConstFix), a constant divide (DivConstC/DivConstFix), the
+ *  Q15 and Q31 multiplies (MulQ15C, MulQ31C) and a vector magnitude.
+ *
+ *  Each x sample is also kept in a packed history (Pack12Put) and one at
+ *  random read back (Pack12Get). Every averaging period 16 of them are
+ *  unpacked and packed again as a run (Unpack12, Pack12).
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - gravity projection
+ *             10/19/26 - Kalman filter
+ *             10/19/26 - drive model and complementary filter
+ *             10/19/26 - battery compensation
+ *             10/19/26 - fixmath against the C operators
+ *             10/19/26 - packed 12 bit samples
+ *             10/19/26 - encoder plausibility check
+ */
+
+#include "hal/hal.h"
+#include "estimator/estimator.h"
+#include "gravity/gravity.h"
+#include "speedctl/speedctl.h"
+#include "mma8450q/mma8450q.h"
+#include "uart/uart.h"
+#include "batt/batt.h"
+#include "fixmath/fixmath.h"
+#include "pack12/pack12.h"
+#include "stdint.h"
+
+#define RUNS    64
+
+volatile int32_t sink;      // keeps results live
+static uint8_t hist[PACK12_BYTES(RUNS)];    // packed x samples
+
+static uint16_t lfsr = 0xACE1;
+
+static int16_t Next(void)
+{
+    // 16 bit Galois LFSR, cheap varying input that gcc cannot fold
+    lfsr = (lfsr >> 1) ^ (-(lfsr & 1) & 0xB400);
+    return lfsr;
+}
+
+// the operators fixmath replaces, and fixmath, each in a function of its
+// own so mspbench counts them apart from main
+static __attribute__((noinline)) int32_t MulConstC(int32_t v)
+{
+    return v * BRAKE_TICKS_Q8;
+}
+
+static __attribute__((noinline)) int32_t MulConstFix(int32_t v)
+{
+    return FIX_MUL_CONST(v, BRAKE_TICKS_Q8);
+}
+
+static __attribute__((noinline)) uint16_t DivConstC(uint16_t x)
+{
+    return x / 1000;
+}
+
+static __attribute__((noinline)) uint16_t DivConstFix(uint16_t x)
+{
+    return FIX_DIVU_CONST(x, 1000);
+}
+
+static __attribute__((noinline)) int16_t MulQ15C(int16_t a, int16_t b)
+{
+    return (int16_t)(((int32_t)a * b + 0x4000) >> 15);
+}
+
+static __attribute__((noinline)) int32_t MulQ31C(int32_t a, int32_t b)
+{
+    return (int32_t)(((int64_t)a * b + 0x40000000L) >> 31);
+}
+
+int main(void)
+{
+    uint8_t raw[7];
+    int16_t xyz[3];
+    int16_t run[16];
+    uint8_t cmd[2] = {64, 192};
+    uint8_t drive[2];
+    uint16_t scale = BATT_SCALE_ONE;
+    SampleAvg avg = {0, 0};
+    SampleAvg xOnly = {0, 0};
+    Gravity grav;
+    int32_t gravSum[3] = {36L * 64, 30L * 64, 1023L * 64};  // 2 degree tilt
+    BiasEst bias = {0, 0, 0};
+    Kalman kal;
+    int32_t count = 0;
+    int32_t model = 0;
+    SpeedCtl ctl;
+    int32_t vel = 0;
+    int32_t dist = 0;
+    uint8_t i, j;
+
+    WDTCTL = WDTPW + WDTHOLD;
+    SpeedCtlInit(&ctl);
+    GravityInit(&grav, gravSum, CAL_SHIFT);
+    KalmanInit(&kal, count);
+
+    for(i = 0; i < RUNS; i++)
+    {
+        for(j = 0; j < 7; j++)
+        {
+            raw[j] = Next() & 0xFF;
+        }
+        MMA8450Unpack(raw, xyz);
+        sink = SignExtend12(xyz[0]);
+        Pack12Put(hist, i, xyz[0]);
+        sink = Pack12Get(hist, Next() & (RUNS - 1));
+
+        if(AvgAddSample(&xOnly, xyz[0], 0))
+        {
+            sink = AvgTake(&xOnly);
+        }
+        if(AvgAddSample(&avg, GravityProject(&grav, xyz), 0))
+        {
+            int16_t accel = BiasCorrect(&bias, &avg, (i & 8) ? BIAS_STOPPED : BIAS_STEADY);
+            count += Next() & 7;
+            sink = KalmanCheck(&kal, count, model);
+            dist = KalmanMeasure(&kal, count, dist);
+            vel = KalmanVel(&kal, accel, vel);
+            model = SpeedCtlModel(model, cmd);
+            vel = CompVel(accel, vel, model);
+            BattBlock();
+            scale = BattScale();
+            Unpack12(run, hist, 16);
+            Pack12(hist, run, 16);
+        }
+
+        vel = NewVel(Next() >> 4, vel);
+        dist = NewDist(vel, dist, 0);
+        sink = dist + BrakeDist(vel);
+        sink = SpeedCtlUpdate(&ctl, vel, SPEED_CRUISE_VEL, Next());
+        sink = SpeedCtlSteady(&ctl);
+
+        cmd[0] = MOTOR1_STOP + (Next() & 0x3F);
+        cmd[1] = MOTOR2_STOP - (Next() & 0x3F);
+        SpeedCtlCompensate(cmd, drive, scale + (Next() & 0x1F));
+        IFG2 |= UCA0TXIFG;
+        UARTSend(drive, 2);
+
+        sink = MulConstC((int16_t)Next()) + MulConstFix((int16_t)Next());
+        sink = DivConstC(Next()) + DivConstFix(Next());
+        sink = MulQ15C(Next(), Next()) + FixMulQ15(Next(), Next());
+        sink = MulQ31C(((int32_t)Next() << 16) | (uint16_t)Next(), (int32_t)Next() << 15) +
+               FixMulQ31(((int32_t)Next() << 16) | (uint16_t)Next(), (int32_t)Next() << 15);
+        sink = FixAddQ15(Next(), Next()) + FixAddQ31((int32_t)Next() << 16, (int32_t)Next() << 16);
+        xyz[0] = Next() >> 4;
+        xyz[1] = Next() >> 4;
+        xyz[2] = Next() >> 4;
+        sink = FixMag3(xyz);
+    }
+
+    return 0;
+}
@@ -0,0 +1,230 @@
+/*
+ *  kalgen.c
+ *  Generates the steady state Kalman gains in src/estimator/kalgain.h from
+ *  the noise model in config.h. The filter (KalmanMeasure, KalmanVel in
+ *  src/estimator) runs once per averaging period on three states: the
+ *  distance, the velocity and a residual accelerometer bias. The bias
+ *  corrected average acceleration is its input, the wheel encoder distance
+ *  its measurement:
+ *
+ *      v' = v + (a - b) T          a  average acceleration, noise KAL_ACCEL
+ *      d' = d + v' T               b  random walk, KAL_DRIFT per root second
+ *      b' = b                      z = d + encoder noise, KAL_ENC
+ *
+ *  The Riccati equation is iterated to its steady state in double
+ *  precision. Each gain is then rounded to a power of two in the
+ *  firmware's units, so the correction is three shifts. The covariance
+ *  the rounded gains settle at is computed as well, and the generator
+ *  fails if they do not settle.
+ *
+ *  Usage: kalgen outdir
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define AVG_PERIOD      ((double)AVG_SAMPLES / TICK_HZ)     // s
+#define TICK_PERIOD     (1.0 / TICK_HZ)
+#define BIAS_FRAC       8       // KAL_BIAS_FRAC in estimator.h
+#define ITERATIONS      100000
+
+typedef double Mat[3][3];
+
+static void Mul(Mat a, Mat b, Mat out)
+{
+    Mat t;
+    int i, j, k;
+    for(i = 0; i < 3; i++)
+    {
+        for(j = 0; j < 3; j++)
+        {
+            t[i][j] = 0;
+            for(k = 0; k < 3; k++)
+            {
+                t[i][j] += a[i][k] * b[k][j];
+            }
+        }
+    }
+    memcpy(out, t, sizeof(Mat));
+}
+
+static void MulT(Mat a, Mat b, Mat out)
+//-------------------------------------------------------------------------
+// Func:  out = a b a'
+//-------------------------------------------------------------------------
+{
+    Mat at;
+    int i, j;
+    for(i = 0; i < 3; i++)
+    {
+        for(j = 0; j < 3; j++)
+        {
+            at[i][j] = a[j][i];
+        }
+    }
+    Mul(a, b, out);
+    Mul(out, at, out);
+}
+
+static int Settle(Mat f, Mat q, double r, double k[3], int optimal, Mat p)
+//-------------------------------------------------------------------------
+// Func:  Iterate the covariance after the measurement update to its steady
+//        state, P = (I - K H)(F P F' + Q)(I - K H)' + K R K', with the
+//        optimal gain (which it then returns in k) or the one given
+// Retn:  0 once it has settled, -1 if it diverges
+//-------------------------------------------------------------------------
+{
+    int n, i, j;
+    double last = -1;
+
+    memset(p, 0, sizeof(Mat));
+    for(i = 0; i < 3; i++)
+    {
+        p[i][i] = 1;
+    }
+    for(n = 0; n < ITERATIONS; n++)
+    {
+        Mat pp, a;
+        MulT(f, p, pp);
+        for(i = 0; i < 3; i++)
+        {
+            for(j = 0; j < 3; j++)
+            {
+                pp[i][j] += q[i][j];
+            }
+        }
+        if(optimal)
+        {
+            for(i = 0; i < 3; i++)
+            {
+                k[i] = pp[i][0] / (pp[0][0] + r);
+            }
+        }
+        for(i = 0; i < 3; i++)
+        {
+            for(j = 0; j < 3; j++)
+            {
+                a[i][j] = (i == j) - (j == 0 ? k[i] : 0);
+            }
+        }
+        MulT(a, pp, p);
+        for(i = 0; i < 3; i++)
+        {
+            for(j = 0; j < 3; j++)
+            {
+                p[i][j] += k[i] * k[j] * r;
+            }
+        }
+        if(!(p[0][0] < 1e6))
+        {
+            return -1;
+        }
+        if(fabs(p[0][0] - last) <= 1e-15 * p[0][0] && n > 100)
+        {
+            return 0;
+        }
+        last = p[0][0];
+    }
+    return -1;
+}
+
+int main(int argc, char ** argv)
+{
+    double t = AVG_PERIOD;
+    double sa = KAL_ACCEL_MM_S2 * 1e-3;     // m/s^2
+    double sz = KAL_ENC_UM * 1e-6;          // m
+    double sb = KAL_DRIFT_MM_S2 * 1e-3;     // m/s^2 per root second
+    Mat f = {{1, t, -t * t}, {0, 1, -t}, {0, 0, 1}};
+    double g[3] = {t * t, t, 0};
+    // gain per firmware unit: distance units, velocity units and bias
+    // counts, all per distance unit of innovation
+    double scale[3] = {1, TICK_PERIOD, -TICK_PERIOD * t};
+    const char * name[3] = {"KAL_D_SHIFT", "KAL_V_SHIFT", "KAL_B_SHIFT"};
+    Mat q, p, pr;
+    double k[3], kr[3];
+    int shift[3];
+    char path[512];
+    FILE * h;
+    int i, j;
+
+    if(argc != 2)
+    {
+        fprintf(stderr, "usage: kalgen outdir\n");
+        return 2;
+    }
+
+    for(i = 0; i < 3; i++)
+    {
+        for(j = 0; j < 3; j++)
+        {
+            q[i][j] = g[i] * g[j] * sa * sa;
+        }
+    }
+    q[2][2] += sb * sb * t;
+
+    if(Settle(f, q, sz * sz, k, 1, p) != 0)
+    {
+        fprintf(stderr, "kalgen: the optimal filter does not settle\n");
+        return 1;
+    }
+    for(i = 0; i < 3; i++)
+    {
+        double x = k[i] * scale[i];
+        if(x <= 0 || x > 1)
+        {
+            fprintf(stderr, "kalgen: %s gain %g is not a right shift\n", name[i], x);
+            return 1;
+        }
+        shift[i] = (int)floor(-log2(x) + 0.5);
+        kr[i] = ldexp(1, -shift[i]) / scale[i];
+    }
+    if(shift[2] <= BIAS_FRAC)
+    {
+        fprintf(stderr, "kalgen: bias gain too large for KAL_BIAS_FRAC\n");
+        return 1;
+    }
+    if(Settle(f, q, sz * sz, kr, 0, pr) != 0)
+    {
+        fprintf(stderr, "kalgen: the rounded gains do not settle\n");
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "%s/kalgain.h", argv[1]);
+    h = fopen(path, "w");
+    if(h == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+    fprintf(h,
+            "/*\n"
+            " *  kalgain.h\n"
+            " *  Steady state Kalman gains, generated by host/gen/kalgen.c from the\n"
+            " *  noise model in config.h. Do not edit, rebuild the kalman-gains target\n"
+            " *  instead.\n"
+            " *\n"
+            " *  Optimal gains %.4f, %.3f/s, %.2f/s^2, rounded %.4f, %.3f/s, %.2f/s^2.\n"
+            " *  Steady state error, rms: distance %.2f mm, velocity %.1f mm/s and\n"
+            " *  bias %.1f mm/s^2 (optimal %.2f mm, %.1f mm/s, %.1f mm/s^2).\n"
+            " */\n"
+            "\n"
+            "#ifndef KALGAIN_H_\n"
+            "#define KALGAIN_H_\n"
+            "\n"
+            "// gains 2^-n per distance unit of innovation\n"
+            "#define KAL_D_SHIFT     %-7d // distance units\n"
+            "#define KAL_V_SHIFT     %-7d // velocity units\n"
+            "#define KAL_B_SHIFT     %-7d // accelerometer counts, subtracted\n"
+            "\n"
+            "#endif\n",
+            k[0], k[1], -k[2], kr[0], kr[1], -kr[2],
+            sqrt(pr[0][0]) * 1e3, sqrt(pr[1][1]) * 1e3, sqrt(pr[2][2]) * 1e3,
+            sqrt(p[0][0]) * 1e3, sqrt(p[1][1]) * 1e3, sqrt(p[2][2]) * 1e3,
+            shift[0], shift[1], shift[2]);
+    fclose(h);
+    return 0;
+}
@@ -0,0 +1,256 @@
+/*
+ *  profgen.c
+ *  Generates the speed profile tables in src/speedctl/proftable.{c,h} from
+ *  a drive characterization (command, steady speed, time constant, as
+ *  written by drivechar or measured on the robot) and the settings in
+ *  config.h. The tables are const so they live in flash:
+ *
+ *      profCmd[k], profVel[k]  motor command and expected speed for each
+ *                              averaged sample k of the acceleration phase,
+ *                              the command leading the speed by the drive
+ *                              time constant
+ *      profSpeedCmd[i]         command holding the speed i << PROF_SPEED_SHIFT,
+ *                              the feedforward for cruise and approach
+ *      profCmdVel[c]           steady speed at command c, up to the trims on
+ *                              top of SPEED_CMD_MAX, for the drive model
+ *                              (SpeedCtlModel), which follows it with a lag
+ *                              of 2^PROF_LAG_SHIFT averaging periods, the
+ *                              time constant at the cruise speed
+ *
+ *  Usage: profgen characterization.csv outdir
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - speed for each command and the drive lag
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_CMDS        (SPEED_CMD_MAX + 1)
+#define MOTOR_CMD_MAX   63          // Sabertooth full speed, from stop
+#define PROF_SPEED_SHIFT    6
+#define PROF_MAX_LEN    250
+
+// estimator units per mm/s, see config.h
+#define VEL_PER_MM_S    (1000.0 * ACCEL_COUNTS_PER_G * TICK_HZ / \
+                         ((double)GRAVITY_UM_S2 * AVG_SAMPLES))
+#define AVG_PERIOD      ((double)AVG_SAMPLES / TICK_HZ)     // s
+
+static double speed[MOTOR_CMD_MAX + 1];     // mm/s
+static double tau[MOTOR_CMD_MAX + 1];       // s
+
+static int ReadCharacterization(const char * path)
+{
+    FILE * f = fopen(path, "r");
+    char line[128];
+    int seen = 0;
+
+    if(f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    while(fgets(line, sizeof(line), f))
+    {
+        int cmd;
+        double v, t;
+        if(line[0] == '#' || sscanf(line, "%d,%lf,%lf", &cmd, &v, &t) != 3)
+        {
+            continue;
+        }
+        if(cmd >= 0 && cmd <= MOTOR_CMD_MAX)
+        {
+            speed[cmd] = v;
+            tau[cmd] = t * 1e-3;
+            seen++;
+        }
+    }
+    fclose(f);
+    if(seen != MOTOR_CMD_MAX + 1)
+    {
+        fprintf(stderr, "%s: need commands 0 to %d\n", path, MOTOR_CMD_MAX);
+        return -1;
+    }
+    return 0;
+}
+
+static double CommandFor(double v)
+//-------------------------------------------------------------------------
+// Func:  Interpolated command for a steady speed, mm/s
+//-------------------------------------------------------------------------
+{
+    int c;
+    if(v <= 0)
+    {
+        return 0;
+    }
+    for(c = 1; c < NUM_CMDS; c++)
+    {
+        if(speed[c] >= v)
+        {
+            return c - 1 + (v - speed[c - 1]) / (speed[c] - speed[c - 1]);
+        }
+    }
+    return SPEED_CMD_MAX;
+}
+
+static double TauFor(double v)
+//-------------------------------------------------------------------------
+// Func:  Drive time constant around a steady speed, s
+//-------------------------------------------------------------------------
+{
+    int c;
+    for(c = 1; c < SPEED_CMD_MAX && (speed[c] < v || tau[c] <= 0); c++)
+    {
+    }
+    return tau[c];
+}
+
+static int Round(double x)
+{
+    return (int)floor(x + 0.5);
+}
+
+int main(int argc, char ** argv)
+{
+    static int profCmd[PROF_MAX_LEN];
+    static long profVel[PROF_MAX_LEN];
+    int profLen = 0;
+    int bins;
+    int lag;
+    double cruise = CRUISE_MM_S;
+    double accel = ACCEL_MM_S2;
+    double v = 0;
+    double sp = 0;
+    char path[512];
+    FILE * c;
+    FILE * h;
+    int i;
+
+    if(argc != 3)
+    {
+        fprintf(stderr, "usage: profgen characterization.csv outdir\n");
+        return 2;
+    }
+    if(ReadCharacterization(argv[1]) != 0)
+    {
+        return 1;
+    }
+    if(speed[SPEED_CMD_MAX] < cruise)
+    {
+        fprintf(stderr, "CRUISE_MM_S is faster than the drive at SPEED_CMD_MAX\n");
+        return 1;
+    }
+
+    // acceleration phase: run the first order drive model on the commands,
+    // until it has settled at the cruise speed
+    while(profLen < PROF_MAX_LEN)
+    {
+        double cmd;
+        int k;
+
+        sp = fmin(sp + accel * AVG_PERIOD, cruise);
+        cmd = CommandFor(sp < cruise ? sp + accel * TauFor(sp) : sp);
+        k = Round(fmin(cmd, SPEED_CMD_MAX));
+        v += (speed[k] - v) * (1 - exp(-AVG_PERIOD / TauFor(speed[k])));
+
+        profCmd[profLen] = k;
+        profVel[profLen] = lround(v * VEL_PER_MM_S);
+        profLen++;
+        if(sp >= cruise && fabs(v - cruise) < 0.02 * cruise)
+        {
+            break;
+        }
+    }
+
+    bins = (int)(speed[SPEED_CMD_MAX] * VEL_PER_MM_S) / (1 << PROF_SPEED_SHIFT) + 1;
+    // first order lag per averaging period, 1 - exp(-T / tau), rounded to
+    // a power of two
+    lag = Round(-log2(1 - exp(-AVG_PERIOD / TauFor(cruise))));
+
+    snprintf(path, sizeof(path), "%s/proftable.h", argv[2]);
+    h = fopen(path, "w");
+    snprintf(path, sizeof(path), "%s/proftable.c", argv[2]);
+    c = fopen(path, "w");
+    if(h == NULL || c == NULL)
+    {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(h,
+            "/*\n"
+            " *  proftable.h\n"
+            " *  Speed profile tables, generated by host/gen/profgen.c from\n"
+            " *  misc/drive_characterization.csv and config.h. Do not edit, rebuild\n"
+            " *  the profile-tables target instead.\n"
+            " */\n"
+            "\n"
+            "#ifndef PROFTABLE_H_\n"
+            "#define PROFTABLE_H_\n"
+            "\n"
+            "#include \"stdint.h\"\n"
+            "\n"
+            "#define PROF_LEN        %d      // averaged samples to reach cruise speed\n"
+            "#define PROF_SPEED_SHIFT    %d  // profSpeedCmd bin width, log2 velocity units\n"
+            "#define PROF_SPEED_BINS %d\n"
+            "#define PROF_VEL_MAX    %ldL  // fastest possible speed plus 1/8\n"
+            "#define PROF_LAG_SHIFT  %d      // drive time constant, log2 averaged samples\n"
+            "#define PROF_CMD_MAX    %d     // last profCmdVel command, full speed\n"
+            "\n"
+            "extern const uint8_t profCmd[PROF_LEN];\n"
+            "extern const int16_t profVel[PROF_LEN];\n"
+            "extern const uint8_t profSpeedCmd[PROF_SPEED_BINS];\n"
+            "extern const int16_t profCmdVel[PROF_CMD_MAX + 1];\n"
+            "\n"
+            "#endif\n",
+            profLen, PROF_SPEED_SHIFT, bins,
+            lround(speed[SPEED_CMD_MAX] * VEL_PER_MM_S * 9 / 8), lag, MOTOR_CMD_MAX);
+
+    fprintf(c,
+            "/*\n"
+            " *  proftable.c\n"
+            " *  Speed profile tables, generated by host/gen/profgen.c, see\n"
+            " *  proftable.h. Acceleration %d mm/s^2 to %d mm/s.\n"
+            " */\n"
+            "\n"
+            "#include \"proftable.h\"\n"
+            "#include \"stdint.h\"\n"
+            "\n"
+            "// motor command for each averaged sample of the acceleration phase\n"
+            "const uint8_t profCmd[PROF_LEN] =\n{",
+            (int)ACCEL_MM_S2, (int)CRUISE_MM_S);
+    for(i = 0; i < profLen; i++)
+    {
+        fprintf(c, "%s%s%d", i ? "," : "", i % 16 ? " " : "\n    ", profCmd[i]);
+    }
+    fprintf(c, "\n};\n\n// expected speed after each, velocity units\n"
+            "const int16_t profVel[PROF_LEN] =\n{");
+    for(i = 0; i < profLen; i++)
+    {
+        fprintf(c, "%s%s%ld", i ? "," : "", i % 12 ? " " : "\n    ", profVel[i]);
+    }
+    fprintf(c, "\n};\n\n// command for a steady speed, indexed by speed >> PROF_SPEED_SHIFT\n"
+            "const uint8_t profSpeedCmd[PROF_SPEED_BINS] =\n{");
+    for(i = 0; i < bins; i++)
+    {
+        double mm = (double)(i << PROF_SPEED_SHIFT) / VEL_PER_MM_S;
+        fprintf(c, "%s%s%d", i ? "," : "", i % 16 ? " " : "\n    ",
+                Round(fmin(CommandFor(mm), SPEED_CMD_MAX)));
+    }
+    fprintf(c, "\n};\n\n// steady speed at each command, velocity units\n"
+            "const int16_t profCmdVel[PROF_CMD_MAX + 1] =\n{");
+    for(i = 0; i <= MOTOR_CMD_MAX; i++)
+    {
+        fprintf(c, "%s%s%ld", i ? "," : "", i % 12 ? " " : "\n    ",
+                lround(speed[i] * VEL_PER_MM_S));
+    }
+    fprintf(c, "\n};\n");
+
+    fclose(h);
+    fclose(c);
+    return 0;
+}
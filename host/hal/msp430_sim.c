@@ -0,0 +1,1262 @@
+/*
+ *  msp430_sim.c
+ *  Simulated MSP430F2274 peripherals, see msp430_sim.h.
+ *
+ *  Register accesses are handled one behind: SimReg8/SimReg16 hand the
+ *  firmware a pointer into simulated register memory, and the next access
+ *  (or a delay/sleep) looks at what happened to that register and lets the
+ *  peripheral react. That is enough for the polled drivers in this project,
+ *  which never write a receive buffer or read a transmit buffer.
+ *
+ *  Version 1: 10/19/26 - Timer A, USCI_A0 UART and USCI_B0 I2C master
+ *             10/19/26 - bus statistics
+ *             10/19/26 - port 1 and 2 inputs and pin change interrupts
+ *             10/19/26 - Timer A from ACLK (VLO or LFXT1)
+ *             10/19/26 - Timer A capture on CCI1A and CCI2A
+ *             10/19/26 - ADC10 triggered by Timer A OUT0, data transfer
+ *                        controller
+ *             10/19/26 - watchdog timer, its reset restarts the firmware,
+ *                        ADC10 triggered by ADC10SC
+ *             10/19/26 - Timer B counting, continuous mode
+ *             10/19/26 - time in LPM3 and LPM4
+ */
+
+#include "msp430_sim.h"
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEM_SIZE            0x1100      // peripherals plus info memory
+#define NO_ACCESS           0xFFFF
+#define NEVER               UINT64_MAX
+#define ACCESS_CYCLES       3           // rough cost of one register access
+#define ISR_CYCLES          11          // interrupt entry plus reti
+#define SIM_SMCLK_HZ        1000000.0   // one cycle per microsecond
+#define VLO_HZ              12000       // typical VLO frequency
+#define SIM_VCC             3.0         // supply, ADC10 reference with SREF_0
+#define ADC_CHANNELS        16
+#define RAM_START           0x0200      // MSP430F2274 RAM
+#define RAM_END             0x0600
+#define WDTCTL_RESET        0x6900      // reads back with this password
+#define JMP_EXIT            1           // longjmp to SimRun from SimExit
+#define JMP_PUC             2           // and from a watchdog reset
+
+// interrupt service routines provided by the firmware, if any
+extern void TimerA1Interrupt(void) __attribute__((weak));
+extern void Port2Interrupt(void) __attribute__((weak));
+extern void Port1Interrupt(void) __attribute__((weak));
+extern void ADC10Interrupt(void) __attribute__((weak));
+extern void WdtInterrupt(void) __attribute__((weak));
+
+typedef union
+{
+    uint8_t b[MEM_SIZE];
+    uint16_t w[MEM_SIZE / 2];
+} SimMem;
+
+// firmware memory that the ADC10 data transfer controller writes to, at
+// an address SimRamAddr handed out
+typedef struct
+{
+    volatile void * host;
+    uint16_t addr;
+    uint16_t size;
+} SimRamRegion;
+
+typedef enum
+{
+    I2C_IDLE,
+    I2C_TX,
+    I2C_RX
+} I2CState;
+
+static SimMem mem;              // register contents seen by the firmware
+static SimMem shadow;           // control registers after the last commit
+static uint16_t lastAddr;       // register handed out by the last access
+static uint64_t now;            // simulated SMCLK cycles since reset
+static uint16_t sr;             // status register
+static uint16_t isrExitSR;      // status register restored by reti
+static int inIsr;
+
+static SimWorld world;
+static SimStats stats;
+static SimI2CDevice i2cDevs[SIM_MAX_I2C_DEVICES];
+static uint8_t i2cDevCount;
+static jmp_buf exitJmp;
+static int exitCode;
+static int running;             // inside SimRun
+
+// timer a
+static uint64_t taBase;         // cycle count when TAR was last zero
+static uint64_t taNext;         // next TAIFG
+static double vloHz = VLO_HZ;   // VLO, ACLK source with LFXT1S_2
+static int taOut0;              // OUT0 level
+
+// timer b
+static uint64_t tbBase;         // cycle count when TBR was last zero
+
+// watchdog
+static uint64_t wdtBase;        // cycle count when the count was last zero
+static uint64_t wdtNext;        // next interval, NEVER while held
+static uint32_t wdtCount;       // count while held
+
+// adc10
+static double analog[ADC_CHANNELS];     // input voltages
+static uint8_t dtcCount;        // transfers into the current block
+static int dtcDone;             // one block mode, block complete
+static SimRamRegion ramRegions[SIM_MAX_RAM_REGIONS];
+static uint8_t ramRegionCount;
+
+// usci a0
+static uint64_t uartShiftDone;  // end of byte in shift register
+static uint8_t uartShift;       // byte being shifted out
+static int uartBufFull;         // TXBUF waiting for shift register
+static uint8_t uartBuf;
+
+// usci b0
+static I2CState i2cState;
+static SimI2CDevice * i2cDev;   // addressed slave, NULL on NACK
+static uint64_t i2cSttDone;     // address byte sent, UCTXSTT clears
+static uint64_t i2cTxReady;     // data byte sent, UCB0TXIFG sets
+static uint64_t i2cRxReady;     // data byte received, UCB0RXIFG sets
+static uint64_t i2cStopDone;    // stop condition sent
+static int i2cStopAfterRx;      // stop once the current RX byte is read
+
+static uint16_t Word(uint16_t addr)
+{
+    return mem.w[addr >> 1];
+}
+
+static void SyncShadow(void)
+//-------------------------------------------------------------------------
+// Func:  Remember the control registers whose changes Commit looks for
+//-------------------------------------------------------------------------
+{
+    shadow.b[UCA0CTL1_] = mem.b[UCA0CTL1_];
+    shadow.b[UCB0CTL1_] = mem.b[UCB0CTL1_];
+    shadow.w[TACTL_ >> 1] = mem.w[TACTL_ >> 1];
+    shadow.w[TACCR0_ >> 1] = mem.w[TACCR0_ >> 1];
+    shadow.w[WDTCTL_ >> 1] = mem.w[WDTCTL_ >> 1];
+    shadow.w[TBCTL_ >> 1] = mem.w[TBCTL_ >> 1];
+}
+
+static uint16_t UartByteCycles(void)
+{
+    uint16_t br = mem.b[UCA0BR0_] | (mem.b[UCA0BR1_] << 8);
+    return (br ? br : 1) * 10;      // start, 8 data, stop
+}
+
+static uint16_t I2CByteCycles(void)
+{
+    uint16_t br = mem.b[UCB0BR0_] | (mem.b[UCB0BR1_] << 8);
+    return (br ? br : 1) * 9;       // 8 data bits plus ack
+}
+
+static double AclkHz(void)
+//-------------------------------------------------------------------------
+// Func:  ACLK frequency, VLO or a 32768 Hz crystal on LFXT1, over DIVA
+//-------------------------------------------------------------------------
+{
+    double hz = ((mem.b[BCSCTL3_] & LFXT1S_3) == LFXT1S_2) ? vloHz : 32768.0;
+    return hz / (1 << ((mem.b[BCSCTL1_] >> 4) & 0x03));
+}
+
+static double TimerTick(uint16_t ctl)
+//-------------------------------------------------------------------------
+// Func:  Length of one Timer A count in SMCLK cycles, from SMCLK or ACLK
+//        and the input divider
+// Args:  ctl - TACTL
+//-------------------------------------------------------------------------
+{
+    double tick = 1 << ((ctl >> 6) & 0x03);
+    if((ctl & TASSEL_3) == TASSEL_1)
+    {
+        tick *= SIM_SMCLK_HZ / AclkHz();
+    }
+    return tick;
+}
+
+static uint64_t TimerPeriod(void)
+//-------------------------------------------------------------------------
+// Func:  Timer A overflow period in SMCLK cycles, 0 if stopped. Only up mode
+//        and continuous mode from SMCLK or ACLK are modelled
+//-------------------------------------------------------------------------
+{
+    uint16_t ctl = Word(TACTL_);
+    switch(ctl & MC_3)
+    {
+        case MC_1:
+            return (uint64_t)((Word(TACCR0_) + 1) * TimerTick(ctl) + 0.5);
+        case MC_2:
+            return (uint64_t)(65536 * TimerTick(ctl) + 0.5);
+        default:
+            return 0;
+    }
+}
+
+static uint16_t TimerCountAt(uint16_t ctl, uint64_t at)
+//-------------------------------------------------------------------------
+// Func:  TAR of a running timer
+// Args:  ctl - TACTL it has been running with
+//        at  - cycle count, from now up to the next overflow
+//-------------------------------------------------------------------------
+{
+    uint64_t count = (uint64_t)((at - taBase) / TimerTick(ctl));
+    if((ctl & MC_3) == MC_1)
+    {
+        count %= Word(TACCR0_) + 1;
+    }
+    return (uint16_t)count;
+}
+
+static uint16_t TimerCount(uint16_t ctl)
+{
+    return TimerCountAt(ctl, now);
+}
+
+static void TimerCapture(uint16_t ctlAddr, uint16_t ccrAddr, int rising,
+                         uint64_t at)
+//-------------------------------------------------------------------------
+// Func:  Capture TAR on an edge of CCIxA, if the channel is set up for it
+// Args:  ctlAddr - TACCTLx
+//        ccrAddr - TACCRx
+//        rising  - 1 for a rising edge, 0 for a falling one
+//        at      - cycle count of the edge
+//-------------------------------------------------------------------------
+{
+    uint16_t cctl = Word(ctlAddr);
+    uint16_t ctl = Word(TACTL_);
+    if(!(cctl & CAP) || (cctl & CCIS_3) != CCIS_0 ||
+       !(cctl & (rising ? CM_1 : CM_2)))
+    {
+        return;
+    }
+    mem.w[ccrAddr >> 1] = (ctl & MC_3) ? TimerCountAt(ctl, at) : Word(TAR_);
+    if(cctl & CCIFG)
+    {
+        mem.w[ctlAddr >> 1] |= COV;
+    }
+    mem.w[ctlAddr >> 1] |= CCIFG;
+}
+
+static void TimerResync(void)
+//-------------------------------------------------------------------------
+// Func:  Recalculate the next overflow after TACTL or TACCR0 changed
+//-------------------------------------------------------------------------
+{
+    uint16_t ctl = Word(TACTL_);
+    uint16_t wasRunning = shadow.w[TACTL_ >> 1] & MC_3;
+    if(ctl & TACLR)
+    {
+        mem.w[TACTL_ >> 1] &= ~TACLR;
+        mem.w[TAR_ >> 1] = 0;
+        taBase = now;
+    }
+    else if(!wasRunning)
+    {
+        // counting resumes from TAR
+        taBase = now - (uint64_t)(Word(TAR_) * TimerTick(ctl));
+    }
+    else if(!(ctl & MC_3))
+    {
+        // stopped, TAR holds its count
+        mem.w[TAR_ >> 1] = TimerCount(shadow.w[TACTL_ >> 1]);
+    }
+
+    uint64_t period = TimerPeriod();
+    taNext = period ? taBase + period : NEVER;
+    while(taNext != NEVER && taNext <= now)
+    {
+        taBase = taNext;
+        taNext += period;
+    }
+}
+
+static void TimerBResync(void)
+//-------------------------------------------------------------------------
+// Func:  Restart Timer B's count after TBCTL changed. Only its count in
+//        continuous mode is modelled, no compare, capture or interrupts.
+//-------------------------------------------------------------------------
+{
+    uint16_t ctl = Word(TBCTL_);
+    uint16_t old = shadow.w[TBCTL_ >> 1];
+    if(ctl & TBCLR)
+    {
+        mem.w[TBCTL_ >> 1] &= ~TBCLR;
+        mem.w[TBR_ >> 1] = 0;
+        tbBase = now;
+    }
+    else if(!(old & MC_3))
+    {
+        tbBase = now - (uint64_t)(Word(TBR_) * TimerTick(ctl));
+    }
+    else if(!(ctl & MC_3))
+    {
+        mem.w[TBR_ >> 1] = (uint16_t)((now - tbBase) / TimerTick(old));
+    }
+}
+
+static double WdtTick(uint16_t ctl)
+//-------------------------------------------------------------------------
+// Func:  Length of one watchdog count in SMCLK cycles
+// Args:  ctl - WDTCTL
+//-------------------------------------------------------------------------
+{
+    return (ctl & WDTSSEL) ? SIM_SMCLK_HZ / AclkHz() : 1.0;
+}
+
+static uint64_t WdtPeriod(uint16_t ctl)
+//-------------------------------------------------------------------------
+// Func:  Watchdog interval in SMCLK cycles, 32768, 8192, 512 or 64 counts
+// Args:  ctl - WDTCTL
+//-------------------------------------------------------------------------
+{
+    static const uint16_t counts[4] = {32768, 8192, 512, 64};
+    return (uint64_t)(counts[ctl & (WDTIS1 | WDTIS0)] * WdtTick(ctl) + 0.5);
+}
+
+static void WdtResync(uint16_t old, uint16_t ctl)
+//-------------------------------------------------------------------------
+// Func:  Recalculate the next interval after a WDTCTL write. The count
+//        carries over a change of clock or interval unless WDTCNTCL clears
+//        it, and stands still while held.
+// Args:  old - WDTCTL before the write
+//        ctl - as written
+//-------------------------------------------------------------------------
+{
+    uint64_t period = WdtPeriod(ctl);
+    double tick = WdtTick(ctl);
+    uint32_t count = wdtCount;
+
+    if(!(old & WDTHOLD))
+    {
+        count = (uint32_t)((now - wdtBase) / WdtTick(old));
+    }
+    if(ctl & WDTCNTCL)
+    {
+        count = 0;
+    }
+    count %= (uint32_t)(period / tick + 0.5);
+    wdtCount = count;
+    if(ctl & WDTHOLD)
+    {
+        wdtNext = NEVER;
+        return;
+    }
+    wdtBase = now - (uint64_t)(count * tick);
+    wdtNext = wdtBase + period;
+}
+
+static void I2CStop(void)
+{
+    if(i2cDev != NULL && i2cDev->stop != NULL)
+    {
+        i2cDev->stop(i2cDev->ctx);
+    }
+    i2cState = I2C_IDLE;
+    i2cDev = NULL;
+    i2cStopAfterRx = 0;
+    i2cStopDone = NEVER;
+    i2cRxReady = NEVER;
+    i2cTxReady = NEVER;
+    mem.b[UCB0CTL1_] &= ~(UCTXSTP | UCTXNACK);
+    mem.b[UCB0STAT_] &= ~UCBBUSY;
+}
+
+static void I2CStart(void)
+//-------------------------------------------------------------------------
+// Func:  Start (or repeated start) condition requested by UCTXSTT
+//-------------------------------------------------------------------------
+{
+    uint8_t i;
+    uint8_t addr = Word(UCB0I2CSA_) & 0x7F;
+    int read = !(mem.b[UCB0CTL1_] & UCTR);
+
+    i2cDev = NULL;
+    for(i = 0; i < i2cDevCount; i++)
+    {
+        if(i2cDevs[i].addr == addr && now >= i2cDevs[i].readyAt)
+        {
+            i2cDev = &i2cDevs[i];
+        }
+    }
+
+    mem.b[UCB0STAT_] |= UCBBUSY;
+    stats.i2cStarts++;
+    i2cSttDone = now + I2CByteCycles();
+    i2cRxReady = NEVER;
+    i2cTxReady = NEVER;
+    if(i2cDev == NULL)
+    {
+        i2cState = I2C_IDLE;        // UCNACKIFG once the address is out
+        return;
+    }
+
+    i2cDev->start(i2cDev->ctx, read);
+    if(read)
+    {
+        i2cState = I2C_RX;
+        i2cRxReady = i2cSttDone + I2CByteCycles();
+    }
+    else
+    {
+        i2cState = I2C_TX;
+        mem.b[IFG2_] |= UCB0TXIFG;  // set as soon as start is generated
+    }
+}
+
+static void Puc(void)
+//-------------------------------------------------------------------------
+// Func:  Power up clear by the watchdog, SimRun restarts the firmware. A
+//        transfer in progress ends for the I2C slave.
+//-------------------------------------------------------------------------
+{
+    I2CStop();
+    mem.b[IFG1_] |= WDTIFG;
+    stats.wdtResets++;
+    if(!running)
+    {
+        fprintf(stderr, "sim: watchdog reset outside SimRun\n");
+        exit(3);
+    }
+    longjmp(exitJmp, JMP_PUC);
+}
+
+static void DtcWrite(uint16_t addr, uint16_t value)
+//-------------------------------------------------------------------------
+// Func:  Store a word in firmware memory registered with SimRamAddr
+//-------------------------------------------------------------------------
+{
+    uint8_t i;
+    for(i = 0; i < ramRegionCount; i++)
+    {
+        SimRamRegion * r = &ramRegions[i];
+        if(addr >= r->addr && addr + 2 <= r->addr + r->size)
+        {
+            memcpy((uint8_t *)r->host + (addr - r->addr), &value, 2);
+            return;
+        }
+    }
+    fprintf(stderr, "sim: ADC10 transfer to unmapped address 0x%04X\n", addr);
+}
+
+static void AdcConvert(void)
+//-------------------------------------------------------------------------
+// Func:  One conversion of the INCHx input, started by a trigger. The
+//        result is ready at once, the sample and conversion time is not
+//        modelled. With ADC10DTC1 set the data transfer controller moves
+//        it to memory and ADC10IFG marks a full block, otherwise
+//        ADC10IFG marks each conversion.
+//-------------------------------------------------------------------------
+{
+    uint16_t ctl0 = Word(ADC10CTL0_);
+    uint16_t ctl1 = Word(ADC10CTL1_);
+    double ref = SIM_VCC;
+    double v = analog[ctl1 >> 12];
+    uint16_t code;
+    uint8_t n = mem.b[ADC10DTC1_];
+
+    if((ctl0 & SREF_7) == SREF_1)
+    {
+        ref = !(ctl0 & REFON) ? 0 : (ctl0 & REF2_5V) ? 2.5 : 1.5;
+    }
+    code = (ref <= 0 || v <= 0) ? 0 :
+           (v >= ref) ? 0x3FF : (uint16_t)(v / ref * 1024);
+    mem.w[ADC10MEM_ >> 1] = code;
+    stats.adcConversions++;
+
+    if(n == 0)
+    {
+        mem.w[ADC10CTL0_ >> 1] |= ADC10IFG;
+        return;
+    }
+    if(dtcDone)
+    {
+        return;
+    }
+    DtcWrite(Word(ADC10SA_) + 2 * dtcCount, code);
+    if(++dtcCount >= n)
+    {
+        dtcCount = 0;
+        dtcDone = !(mem.b[ADC10DTC0_] & ADC10CT);
+        mem.w[ADC10CTL0_ >> 1] |= ADC10IFG;
+    }
+}
+
+static void TimerOut0(void)
+//-------------------------------------------------------------------------
+// Func:  OUT0 at the end of an up mode period, where TAR reaches TACCR0.
+//        Only the toggle output mode is modelled. A rising edge triggers
+//        the ADC10 when it samples on OUT0 (SHS_2).
+//-------------------------------------------------------------------------
+{
+    uint16_t ctl0 = Word(ADC10CTL0_);
+    if((Word(TACTL_) & MC_3) != MC_1 || (Word(TACCTL0_) & OUTMOD_7) != OUTMOD_4)
+    {
+        return;
+    }
+    taOut0 = !taOut0;
+    if(taOut0 && (ctl0 & (ENC | ADC10ON)) == (ENC | ADC10ON) &&
+       (Word(ADC10CTL1_) & SHS_3) == SHS_2)
+    {
+        AdcConvert();
+    }
+}
+
+static void Commit(void)
+//-------------------------------------------------------------------------
+// Func:  React to the register access made before this one
+//-------------------------------------------------------------------------
+{
+    uint16_t addr = lastAddr;
+    lastAddr = NO_ACCESS;
+    if(addr == NO_ACCESS)
+    {
+        return;
+    }
+
+    switch(addr)
+    {
+        case UCA0TXBUF_:
+            if(mem.b[UCA0CTL1_] & UCSWRST)
+            {
+                break;
+            }
+            if(uartShiftDone == NEVER)
+            {
+                uartShift = mem.b[UCA0TXBUF_];
+                uartShiftDone = now + UartByteCycles();
+            }
+            else
+            {
+                uartBuf = mem.b[UCA0TXBUF_];
+                uartBufFull = 1;
+                mem.b[IFG2_] &= ~UCA0TXIFG;
+            }
+            break;
+
+        case UCA0CTL1_:
+            if((mem.b[UCA0CTL1_] & UCSWRST) && !(shadow.b[UCA0CTL1_] & UCSWRST))
+            {
+                uartShiftDone = NEVER;
+                uartBufFull = 0;
+                mem.b[IFG2_] |= UCA0TXIFG;
+            }
+            break;
+
+        case UCB0CTL1_:
+        {
+            uint8_t ctl = mem.b[UCB0CTL1_];
+            uint8_t set = ctl & ~shadow.b[UCB0CTL1_];
+            if(ctl & UCSWRST)
+            {
+                if(set & UCSWRST)
+                {
+                    i2cDev = NULL;
+                    I2CStop();
+                    i2cSttDone = NEVER;
+                    mem.b[UCB0CTL1_] &= ~UCTXSTT;
+                    mem.b[IFG2_] &= ~(UCB0TXIFG | UCB0RXIFG);
+                }
+                break;
+            }
+            if(set & UCTXSTT)
+            {
+                I2CStart();
+            }
+            if(set & UCTXSTP)
+            {
+                if(i2cState == I2C_RX)
+                {
+                    i2cStopAfterRx = 1;
+                }
+                else
+                {
+                    uint64_t from = (i2cTxReady != NEVER) ? i2cTxReady : now;
+                    i2cStopDone = from + I2CByteCycles() / 9;
+                }
+            }
+            break;
+        }
+
+        case UCB0TXBUF_:
+            mem.b[IFG2_] &= ~UCB0TXIFG;
+            if(i2cState == I2C_TX)
+            {
+                uint64_t from = (i2cSttDone != NEVER && i2cSttDone > now) ? i2cSttDone : now;
+                i2cDev->write(i2cDev->ctx, mem.b[UCB0TXBUF_]);
+                stats.i2cBytes++;
+                i2cTxReady = from + I2CByteCycles();
+            }
+            break;
+
+        case UCB0RXBUF_:
+            mem.b[IFG2_] &= ~UCB0RXIFG;
+            if(i2cState == I2C_RX)
+            {
+                if(i2cStopAfterRx)
+                {
+                    i2cStopDone = now + I2CByteCycles() / 9;
+                    i2cState = I2C_IDLE;
+                }
+                else
+                {
+                    i2cRxReady = now + I2CByteCycles();
+                }
+            }
+            break;
+
+        case TAIV_:
+            if(mem.w[TAIV_ >> 1] == TAIV_TACCR1)
+            {
+                mem.w[TACCTL1_ >> 1] &= ~CCIFG;
+            }
+            else if(mem.w[TAIV_ >> 1] == TAIV_TACCR2)
+            {
+                mem.w[TACCTL2_ >> 1] &= ~CCIFG;
+            }
+            else if(mem.w[TAIV_ >> 1] == TAIV_TAIFG)
+            {
+                mem.w[TACTL_ >> 1] &= ~TAIFG;
+            }
+            mem.w[TAIV_ >> 1] = 0;
+            break;
+
+        case ADC10SA_:
+            dtcCount = 0;           // writing the start address starts a
+            dtcDone = 0;            // new block
+            break;
+
+        case ADC10CTL0_:
+            if(mem.w[ADC10CTL0_ >> 1] & ADC10SC)
+            {
+                uint16_t ctl0;
+                mem.w[ADC10CTL0_ >> 1] &= ~ADC10SC;     // resets itself
+                ctl0 = Word(ADC10CTL0_);
+                if((ctl0 & (ENC | ADC10ON)) == (ENC | ADC10ON) &&
+                   (Word(ADC10CTL1_) & SHS_3) == SHS_0)
+                {
+                    AdcConvert();
+                }
+            }
+            break;
+
+        case TBCTL_:
+            TimerBResync();
+            break;
+
+        case WDTCTL_:
+        {
+            uint16_t ctl = Word(WDTCTL_);
+            mem.w[WDTCTL_ >> 1] = WDTCTL_RESET | (ctl & 0xFF & ~WDTCNTCL);
+            if((ctl & 0xFF00) != WDTPW)
+            {
+                Puc();              // password violation
+            }
+            WdtResync(shadow.w[WDTCTL_ >> 1], ctl);
+            break;
+        }
+
+        case TACTL_:
+        case TACCR0_:
+            if(mem.w[addr >> 1] != shadow.w[addr >> 1])
+            {
+                TimerResync();
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    SyncShadow();
+}
+
+static uint64_t NextEvent(void)
+{
+    uint64_t t = taNext;
+    if(wdtNext < t) t = wdtNext;
+    if(uartShiftDone < t) t = uartShiftDone;
+    if((mem.b[UCB0CTL1_] & UCTXSTT) && i2cSttDone < t) t = i2cSttDone;
+    if(i2cTxReady < t) t = i2cTxReady;
+    if(i2cRxReady < t) t = i2cRxReady;
+    if(i2cStopDone < t) t = i2cStopDone;
+    if(world.nextInput != NULL)
+    {
+        uint64_t in = world.nextInput(world.ctx);
+        if(in > now && in < t) t = in;
+    }
+    return t;
+}
+
+static void ProcessEvents(void)
+//-------------------------------------------------------------------------
+// Func:  Update peripherals whose pending event time has been reached
+//-------------------------------------------------------------------------
+{
+    while(wdtNext <= now)
+    {
+        mem.b[IFG1_] |= WDTIFG;
+        if(!(Word(WDTCTL_) & WDTTMSEL))
+        {
+            Puc();                  // watchdog mode, ran out
+        }
+        wdtBase = wdtNext;
+        wdtNext += WdtPeriod(Word(WDTCTL_));
+    }
+
+    while(taNext <= now)
+    {
+        TimerOut0();
+        mem.w[TACTL_ >> 1] |= TAIFG;
+        taBase = taNext;
+        taNext += TimerPeriod();
+    }
+
+    if(uartShiftDone <= now)
+    {
+        stats.uartBytes++;
+        if(world.uartTx != NULL)
+        {
+            world.uartTx(world.ctx, uartShift);
+        }
+        uartShiftDone = NEVER;
+        if(uartBufFull)
+        {
+            uartShift = uartBuf;
+            uartBufFull = 0;
+            uartShiftDone = now + UartByteCycles();
+            mem.b[IFG2_] |= UCA0TXIFG;
+        }
+    }
+
+    if((mem.b[UCB0CTL1_] & UCTXSTT) && i2cSttDone <= now)
+    {
+        mem.b[UCB0CTL1_] &= ~UCTXSTT;
+        i2cSttDone = NEVER;
+        if(i2cDev == NULL)
+        {
+            mem.b[UCB0STAT_] |= UCNACKIFG;
+        }
+    }
+    if(i2cTxReady <= now)
+    {
+        mem.b[IFG2_] |= UCB0TXIFG;
+        i2cTxReady = NEVER;
+    }
+    if(i2cRxReady <= now)
+    {
+        mem.b[UCB0RXBUF_] = i2cDev->read(i2cDev->ctx);
+        stats.i2cBytes++;
+        mem.b[IFG2_] |= UCB0RXIFG;
+        i2cRxReady = NEVER;
+    }
+    if(i2cStopDone <= now)
+    {
+        I2CStop();
+    }
+
+    SyncShadow();
+}
+
+static void AdvanceTo(uint64_t target)
+//-------------------------------------------------------------------------
+// Func:  Move simulated time forward, handling peripheral events in order
+//-------------------------------------------------------------------------
+{
+    while(now < target)
+    {
+        uint64_t t = NextEvent();
+        if(t > target)
+        {
+            t = target;
+        }
+        if(world.advance != NULL)
+        {
+            world.advance(world.ctx, t);
+        }
+        now = t;
+        ProcessEvents();
+    }
+}
+
+static uint16_t TimerVector(void)
+//-------------------------------------------------------------------------
+// Func:  Highest priority enabled TIMERA1_VECTOR source, as TAIV reads it
+//-------------------------------------------------------------------------
+{
+    static const uint16_t ccr[2] = {TACCTL1_, TACCTL2_};
+    static const uint16_t iv[2] = {TAIV_TACCR1, TAIV_TACCR2};
+    uint16_t ctl = Word(TACTL_);
+    int i;
+    for(i = 0; i < 2; i++)
+    {
+        if((Word(ccr[i]) & (CCIE | CCIFG)) == (CCIE | CCIFG))
+        {
+            return iv[i];
+        }
+    }
+    return ((ctl & TAIE) && (ctl & TAIFG)) ? TAIV_TAIFG : 0;
+}
+
+static int Dispatch(void)
+//-------------------------------------------------------------------------
+// Func:  Run the highest priority pending interrupt, if enabled
+// Retn:  1 if an interrupt was serviced
+//-------------------------------------------------------------------------
+{
+    void (*isr)(void) = NULL;
+    if(inIsr || !(sr & GIE))
+    {
+        return 0;
+    }
+
+    if((mem.b[IE1_] & mem.b[IFG1_] & WDTIE) && (Word(WDTCTL_) & WDTTMSEL) &&
+       WdtInterrupt)
+    {
+        mem.b[IFG1_] &= ~WDTIFG;    // cleared on acceptance
+        isr = WdtInterrupt;
+    }
+    else if(TimerVector() && TimerA1Interrupt)
+    {
+        isr = TimerA1Interrupt;
+    }
+    else if((Word(ADC10CTL0_) & (ADC10IE | ADC10IFG)) == (ADC10IE | ADC10IFG) &&
+            ADC10Interrupt)
+    {
+        mem.w[ADC10CTL0_ >> 1] &= ~ADC10IFG;    // cleared on acceptance
+        isr = ADC10Interrupt;
+    }
+    else if((mem.b[P2IE_] & mem.b[P2IFG_]) && Port2Interrupt)
+    {
+        isr = Port2Interrupt;
+    }
+    else if((mem.b[P1IE_] & mem.b[P1IFG_]) && Port1Interrupt)
+    {
+        isr = Port1Interrupt;
+    }
+    if(isr == NULL)
+    {
+        return 0;
+    }
+
+    isrExitSR = sr;
+    sr &= ~(GIE | CPUOFF | SCG0 | SCG1 | OSCOFF);
+    inIsr = 1;
+    stats.interrupts++;
+    AdvanceTo(now + ISR_CYCLES);
+    isr();
+    Commit();
+    inIsr = 0;
+    sr = isrExitSR;
+    return 1;
+}
+
+static uint16_t Refresh(uint16_t addr)
+//-------------------------------------------------------------------------
+// Func:  Update registers whose value is computed when read
+//-------------------------------------------------------------------------
+{
+    if(addr == TAR_ && (Word(TACTL_) & MC_3))
+    {
+        mem.w[TAR_ >> 1] = TimerCount(Word(TACTL_));
+    }
+    else if(addr == TBR_ && (Word(TBCTL_) & MC_3))
+    {
+        mem.w[TBR_ >> 1] = (uint16_t)((now - tbBase) / TimerTick(Word(TBCTL_)));
+    }
+    else if(addr == TAIV_)
+    {
+        mem.w[TAIV_ >> 1] = TimerVector();
+    }
+    else if(addr == TACCTL1_ || addr == TACCTL2_)
+    {
+        // CCI follows CCIxA, P1.2 for TACCR1 and P1.3 for TACCR2
+        uint8_t pin = (addr == TACCTL1_) ? 0x04 : 0x08;
+        uint16_t cctl = Word(addr) & ~CCI;
+        if((cctl & CCIS_3) == CCIS_0 && (mem.b[P1IN_] & mem.b[P1SEL_] & pin))
+        {
+            cctl |= CCI;
+        }
+        mem.w[addr >> 1] = cctl;
+    }
+    return addr;
+}
+
+static void Access(uint16_t addr)
+{
+    stats.accesses++;
+    Commit();
+    AdvanceTo(now + ACCESS_CYCLES);
+    if(Dispatch())
+    {
+        Commit();
+    }
+    lastAddr = Refresh(addr);
+}
+
+volatile uint8_t * SimReg8(uint16_t addr)
+//-------------------------------------------------------------------------
+// Func:  Access a byte register
+// Args:  addr - register address from msp430x22x4.h
+// Retn:  pointer to the simulated register
+//-------------------------------------------------------------------------
+{
+    Access(addr);
+    return &mem.b[addr];
+}
+
+volatile uint16_t * SimReg16(uint16_t addr)
+//-------------------------------------------------------------------------
+// Func:  Access a word register
+// Args:  addr - register address from msp430x22x4.h, must be even
+// Retn:  pointer to the simulated register
+//-------------------------------------------------------------------------
+{
+    Access(addr);
+    return &mem.w[addr >> 1];
+}
+
+static void RunUntil(uint64_t target)
+{
+    Commit();
+    while(now < target)
+    {
+        uint64_t t;
+        if(Dispatch())
+        {
+            continue;       // one left pending by the last interrupt
+        }
+        t = NextEvent();
+        AdvanceTo(t < target ? t : target);
+    }
+    Dispatch();
+}
+
+void __delay_cycles(uint32_t cycles)
+{
+    RunUntil(now + cycles);
+}
+
+void __bis_SR_register(uint16_t bits)
+//-------------------------------------------------------------------------
+// Func:  Set status register bits. With CPUOFF this sleeps, time runs until
+//        an interrupt clears CPUOFF on exit. Sleeping with SMCLK off counts
+//        as LPM3, with the oscillator off as well as LPM4.
+//-------------------------------------------------------------------------
+{
+    uint64_t start = now;
+    Commit();
+    sr |= bits;
+    while(sr & CPUOFF)
+    {
+        if(!Dispatch())
+        {
+            uint64_t t = NextEvent();
+            AdvanceTo(t != NEVER ? t : now + 1000);
+        }
+    }
+    if((bits & (CPUOFF | SCG1)) == (CPUOFF | SCG1))
+    {
+        if(bits & OSCOFF)
+        {
+            stats.lpm4Cycles += now - start;
+        }
+        else
+        {
+            stats.lpm3Cycles += now - start;
+        }
+    }
+}
+
+void __bic_SR_register(uint16_t bits)
+{
+    Commit();
+    sr &= ~bits;
+}
+
+void __bic_SR_register_on_exit(uint16_t bits)
+{
+    isrExitSR &= ~bits;
+}
+
+void __bis_SR_register_on_exit(uint16_t bits)
+{
+    isrExitSR |= bits;
+}
+
+void __enable_interrupt(void)
+{
+    __bis_SR_register(GIE);
+}
+
+void __disable_interrupt(void)
+{
+    __bic_SR_register(GIE);
+}
+
+static void ResetRegisters(void)
+//-------------------------------------------------------------------------
+// Func:  Register values after a reset, from the family user guide, and
+//        the peripherals idle. The watchdog runs, SMCLK / 32768.
+//-------------------------------------------------------------------------
+{
+    memset(&mem, 0, sizeof(mem));
+    mem.w[WDTCTL_ >> 1] = WDTCTL_RESET;
+    mem.b[IFG2_] = UCA0TXIFG;
+    mem.b[UCA0CTL1_] = UCSWRST;
+    mem.b[UCB0CTL0_] = UCSYNC;
+    mem.b[UCB0CTL1_] = UCSWRST;
+    mem.b[CALDCO_1MHZ_] = 0x8E;
+    mem.b[CALBC1_1MHZ_] = 0x86;
+    memcpy(&shadow, &mem, sizeof(mem));
+
+    lastAddr = NO_ACCESS;
+    sr = 0;
+    inIsr = 0;
+    taBase = now;
+    taNext = NEVER;
+    taOut0 = 0;
+    tbBase = now;
+    wdtBase = now;
+    wdtNext = now + WdtPeriod(WDTCTL_RESET);
+    wdtCount = 0;
+    dtcCount = 0;
+    dtcDone = 0;
+    uartShiftDone = NEVER;
+    uartBufFull = 0;
+    i2cState = I2C_IDLE;
+    i2cDev = NULL;
+    i2cSttDone = NEVER;
+    i2cTxReady = NEVER;
+    i2cRxReady = NEVER;
+    i2cStopDone = NEVER;
+    i2cStopAfterRx = 0;
+}
+
+void SimReset(void)
+//-------------------------------------------------------------------------
+// Func:  Power on reset. The watchdog runs, as on the MCU, and the firmware
+//        holds it or SimRun restarts it after 32768 cycles.
+//-------------------------------------------------------------------------
+{
+    now = 0;
+    vloHz = VLO_HZ;
+    ResetRegisters();
+    memset(analog, 0, sizeof(analog));
+    ramRegionCount = 0;
+    i2cDevCount = 0;
+    memset(&world, 0, sizeof(world));
+    memset(&stats, 0, sizeof(stats));
+}
+
+static void PowerUpClear(void)
+//-------------------------------------------------------------------------
+// Func:  Reset after the watchdog, registers as after power on except the
+//        input pins, which the world drives, and WDTIFG. Time, the world,
+//        I2C slaves and RAM carry on.
+//-------------------------------------------------------------------------
+{
+    static const uint16_t in[4] = {P1IN_, P2IN_, P3IN_, P4IN_};
+    uint8_t levels[4];
+    uint8_t i;
+
+    for(i = 0; i < 4; i++)
+    {
+        levels[i] = mem.b[in[i]];
+    }
+    ResetRegisters();
+    for(i = 0; i < 4; i++)
+    {
+        mem.b[in[i]] = levels[i];
+    }
+    mem.b[IFG1_] |= WDTIFG;
+    shadow.b[IFG1_] = mem.b[IFG1_];
+}
+
+void SimSetWorld(const SimWorld * w)
+{
+    world = *w;
+}
+
+void SimAttachI2C(const SimI2CDevice * dev)
+{
+    if(i2cDevCount < SIM_MAX_I2C_DEVICES)
+    {
+        i2cDevs[i2cDevCount++] = *dev;
+    }
+}
+
+void SimDetachI2C(uint8_t addr)
+//-------------------------------------------------------------------------
+// Func:  Stop a slave acknowledging from its next start condition on, as
+//        if its wiring had come loose. A transfer in progress finishes.
+// Args:  addr - 7 bit slave address
+//-------------------------------------------------------------------------
+{
+    uint8_t i;
+    for(i = 0; i < i2cDevCount; i++)
+    {
+        if(i2cDevs[i].addr == addr)
+        {
+            i2cDevs[i].readyAt = NEVER;
+        }
+    }
+}
+
+void SimSetInputs(uint8_t port, uint8_t mask, uint8_t levels)
+//-------------------------------------------------------------------------
+// Func:  Drive input pins from outside the MCU. On ports 1 and 2 an edge
+//        sets PxIFG, rising edges where the PxIES bit is clear and falling
+//        edges where it is set, whether or not PxIE is set; an enabled
+//        flag is serviced by Port1Interrupt/Port2Interrupt. Edges on P1.2
+//        and P1.3 are also Timer A's capture inputs CCI1A and CCI2A.
+// Args:  port   - 1 to 4
+//        mask   - pins to change
+//        levels - new levels of those pins
+//-------------------------------------------------------------------------
+{
+    SimSetInputsAt(port, mask, levels, now);
+}
+
+void SimSetInputsAt(uint8_t port, uint8_t mask, uint8_t levels, uint64_t at)
+//-------------------------------------------------------------------------
+// Func:  SimSetInputs for an edge between the current cycle count and the
+//        one passed to SimWorld.advance, which times Timer A captures
+// Args:  port   - 1 to 4
+//        mask   - pins to change
+//        levels - new levels of those pins
+//        at     - cycle count of the edges, clamped to the current one
+//-------------------------------------------------------------------------
+{
+    static const uint16_t in[4] = {P1IN_, P2IN_, P3IN_, P4IN_};
+    uint8_t old;
+    uint8_t changed;
+
+    if(port < 1 || port > 4)
+    {
+        return;
+    }
+    old = mem.b[in[port - 1]];
+    mem.b[in[port - 1]] = (old & ~mask) | (levels & mask);
+    changed = (old ^ levels) & mask;
+    if(at < now)
+    {
+        at = now;
+    }
+    if(port == 1)
+    {
+        mem.b[P1IFG_] |= changed & (levels ^ mem.b[P1IES_]);
+        if(changed & mem.b[P1SEL_] & 0x04)
+        {
+            TimerCapture(TACCTL1_, TACCR1_, (levels & 0x04) != 0, at);
+        }
+        if(changed & mem.b[P1SEL_] & 0x08)
+        {
+            TimerCapture(TACCTL2_, TACCR2_, (levels & 0x08) != 0, at);
+        }
+    }
+    else if(port == 2)
+    {
+        mem.b[P2IFG_] |= changed & (levels ^ mem.b[P2IES_]);
+    }
+}
+
+void SimSetVlo(double hz)
+//-------------------------------------------------------------------------
+// Func:  Set the VLO frequency, 4 to 20 kHz over parts and temperature,
+//        12 kHz after SimReset
+//-------------------------------------------------------------------------
+{
+    vloHz = hz;
+}
+
+void SimSetAnalog(uint8_t channel, double volts)
+//-------------------------------------------------------------------------
+// Func:  Drive an ADC10 input, 0 after SimReset
+// Args:  channel - INCHx, 0 to 15
+//        volts   - level at the pin
+//-------------------------------------------------------------------------
+{
+    if(channel < ADC_CHANNELS)
+    {
+        analog[channel] = volts;
+    }
+}
+
+uint16_t SimRamAddr(volatile void * p, uint16_t size)
+//-------------------------------------------------------------------------
+// Func:  16 bit address of firmware memory, for registers that hold an
+//        address (ADC10SA). Each region gets its own range of the
+//        MSP430's RAM addresses, the same one on every call.
+// Args:  p    - start of the region
+//        size - its length in bytes
+// Retn:  address the data transfer controller writes through
+//-------------------------------------------------------------------------
+{
+    uint16_t addr = RAM_START;
+    uint8_t i;
+    for(i = 0; i < ramRegionCount; i++)
+    {
+        if(ramRegions[i].host == p)
+        {
+            return ramRegions[i].addr;
+        }
+        addr = ramRegions[i].addr + ((ramRegions[i].size + 1) & ~1);
+    }
+    if(ramRegionCount >= SIM_MAX_RAM_REGIONS || addr + size > RAM_END)
+    {
+        fprintf(stderr, "sim: out of RAM regions\n");
+        SimExit(3);
+    }
+    ramRegions[ramRegionCount].host = p;
+    ramRegions[ramRegionCount].addr = addr;
+    ramRegions[ramRegionCount].size = size;
+    ramRegionCount++;
+    return addr;
+}
+
+uint64_t SimCycles(void)
+{
+    return now;
+}
+
+const SimStats * SimGetStats(void)
+{
+    return &stats;
+}
+
+int SimRun(void (*entry)(void))
+//-------------------------------------------------------------------------
+// Func:  Run firmware code until it returns or SimExit is called. A
+//        watchdog reset starts it again from the top. Unlike on the MCU,
+//        where the C startup code runs first, its globals keep their values.
+// Args:  entry - firmware entry point, normally main renamed by the build
+// Retn:  code passed to SimExit, 0 if entry returned
+//-------------------------------------------------------------------------
+{
+    exitCode = 0;
+    running = 1;
+    switch(setjmp(exitJmp))
+    {
+        case JMP_PUC:
+            PowerUpClear();
+            entry();
+            break;
+        case JMP_EXIT:
+            break;
+        default:
+            entry();
+            break;
+    }
+    running = 0;
+    inIsr = 0;
+    return exitCode;
+}
+
+void SimExit(int code)
+{
+    exitCode = code;
+    longjmp(exitJmp, JMP_EXIT);
+}
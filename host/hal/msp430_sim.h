@@ -0,0 +1,284 @@
+/*
+ *  msp430_sim.h
+ *  Simulated MSP430F2274 peripheral registers for building the firmware on a
+ *  PC. Included through src/hal/hal.h when SIM_HOST is defined, in place of
+ *  msp430x22x4.h. Bit definitions still come from msp430x22x4.h, only the
+ *  register names are replaced.
+ *
+ *  Every register access goes through SimReg8/SimReg16, which advances the
+ *  simulated clock and lets the peripheral models react to the previous
+ *  access (a write to TXBUF starts a transfer, a read of RXBUF frees the
+ *  buffer, ...). Time also advances in __delay_cycles and in low power mode,
+ *  which runs until an interrupt clears CPUOFF on exit.
+ *
+ *  Timer A's capture/compare channels 1 and 2 capture TAR on edges of their
+ *  CCIxA inputs (P1.2, P1.3), compare mode is not modelled. Channel 0's
+ *  output toggles at the end of each up mode period with OUTMOD_4, which
+ *  triggers ADC10 conversions (SHS_2). ADC10 inputs are set with
+ *  SimSetAnalog, and its data transfer controller writes to memory the
+ *  firmware has mapped with RAM_ADDR. ADC10SC starts a conversion with
+ *  SHS_0.
+ *
+ *  Timer B counts in continuous mode from SMCLK or ACLK, nothing else of
+ *  it is modelled.
+ *
+ *  The watchdog runs from reset as on the MCU. In watchdog mode, running
+ *  out or a WDTCTL write without the password resets the registers and
+ *  sets WDTIFG, and SimRun starts the firmware again. In interval mode it
+ *  sets WDTIFG, serviced by WdtInterrupt with WDTIE.
+ *
+ *  Clocks are not modelled beyond their frequencies, SMCLK is assumed to be
+ *  1 MHz so one simulated cycle is one microsecond, and ACLK comes from the
+ *  VLO (SimSetVlo) or a 32768 Hz crystal. Low power modes do not gate the
+ *  clocks.
+ *
+ *  Every register in msp430x22x4.h is mapped so any driver builds. Only the
+ *  peripherals listed in msp430_sim.c react to accesses, the rest behave as
+ *  plain memory.
+ *
+ *  Version 1: 10/19/26 - Timer A, USCI_A0 UART and USCI_B0 I2C master
+ *             10/19/26 - mapped all registers, added bus statistics
+ *             10/19/26 - port 1 and 2 inputs and pin change interrupts
+ *             10/19/26 - Timer A from ACLK (VLO or LFXT1)
+ *             10/19/26 - Timer A capture on CCI1A (P1.2) and CCI2A (P1.3)
+ *             10/19/26 - ADC10 and its data transfer controller
+ *             10/19/26 - I2C slaves powering up, not acknowledged
+ *             10/19/26 - watchdog timer and reset, ADC10SC, I2C slaves
+ *                        coming loose
+ *             10/19/26 - Timer B count
+ *             10/19/26 - time in LPM3 and LPM4
+ */
+
+#ifndef MSP430_SIM_H_
+#define MSP430_SIM_H_
+
+#include <stdint.h>
+
+// pull in the bit definitions, the register declarations become unused
+// externs so READ_ONLY in front of them still parses
+#define __TID__ (0x2b << 8)
+#define __DisableCalData
+#define DEFC(name, address) extern unsigned char SimUnused_##name;
+#define DEFW(name, address) extern unsigned short SimUnused_##name;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunknown-pragmas"
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wold-style-declaration"
+#endif
+#include "msp430x22x4.h"
+#pragma GCC diagnostic pop
+#undef DEFC
+#undef DEFW
+#undef __TID__
+
+// low power mode bits, only defined for IAR C in msp430x22x4.h
+#ifndef LPM0_bits
+#define LPM0_bits   (CPUOFF)
+#define LPM1_bits   (SCG0+CPUOFF)
+#define LPM2_bits   (SCG1+CPUOFF)
+#define LPM3_bits   (SCG1+SCG0+CPUOFF)
+#define LPM4_bits   (SCG1+SCG0+OSCOFF+CPUOFF)
+#endif
+
+// calibration data addresses, skipped above with __DisableCalData
+#define CALDCO_16MHZ_   (0x10F8)
+#define CALBC1_16MHZ_   (0x10F9)
+#define CALDCO_12MHZ_   (0x10FA)
+#define CALBC1_12MHZ_   (0x10FB)
+#define CALDCO_8MHZ_    (0x10FC)
+#define CALBC1_8MHZ_    (0x10FD)
+#define CALDCO_1MHZ_    (0x10FE)
+#define CALBC1_1MHZ_    (0x10FF)
+
+volatile uint8_t * SimReg8(uint16_t addr);
+volatile uint16_t * SimReg16(uint16_t addr);
+
+#define SIM_REG8(addr)  (*SimReg8(addr))
+#define SIM_REG16(addr) (*SimReg16(addr))
+
+// 16 bit address of a RAM buffer for the data transfer controller, see hal.h
+uint16_t SimRamAddr(volatile void * p, uint16_t size);
+#define RAM_ADDR(p, size)   SimRamAddr((p), (size))
+
+// special function registers
+#define IE1          SIM_REG8(IE1_)
+#define IFG1         SIM_REG8(IFG1_)
+#define IE2          SIM_REG8(IE2_)
+#define IFG2         SIM_REG8(IFG2_)
+// adc10
+#define ADC10DTC0    SIM_REG8(ADC10DTC0_)
+#define ADC10DTC1    SIM_REG8(ADC10DTC1_)
+#define ADC10AE0     SIM_REG8(ADC10AE0_)
+#define ADC10AE1     SIM_REG8(ADC10AE1_)
+#define ADC10CTL0    SIM_REG16(ADC10CTL0_)
+#define ADC10CTL1    SIM_REG16(ADC10CTL1_)
+#define ADC10MEM     SIM_REG16(ADC10MEM_)
+#define ADC10SA      SIM_REG16(ADC10SA_)
+// clocks
+#define DCOCTL       SIM_REG8(DCOCTL_)
+#define BCSCTL1      SIM_REG8(BCSCTL1_)
+#define BCSCTL2      SIM_REG8(BCSCTL2_)
+#define BCSCTL3      SIM_REG8(BCSCTL3_)
+// flash
+#define FCTL1        SIM_REG16(FCTL1_)
+#define FCTL2        SIM_REG16(FCTL2_)
+#define FCTL3        SIM_REG16(FCTL3_)
+// operational amplifiers
+#define OA0CTL0      SIM_REG8(OA0CTL0_)
+#define OA0CTL1      SIM_REG8(OA0CTL1_)
+#define OA1CTL0      SIM_REG8(OA1CTL0_)
+#define OA1CTL1      SIM_REG8(OA1CTL1_)
+// ports
+#define P1IN         SIM_REG8(P1IN_)
+#define P1OUT        SIM_REG8(P1OUT_)
+#define P1DIR        SIM_REG8(P1DIR_)
+#define P1IFG        SIM_REG8(P1IFG_)
+#define P1IES        SIM_REG8(P1IES_)
+#define P1IE         SIM_REG8(P1IE_)
+#define P1SEL        SIM_REG8(P1SEL_)
+#define P1REN        SIM_REG8(P1REN_)
+#define P2IN         SIM_REG8(P2IN_)
+#define P2OUT        SIM_REG8(P2OUT_)
+#define P2DIR        SIM_REG8(P2DIR_)
+#define P2IFG        SIM_REG8(P2IFG_)
+#define P2IES        SIM_REG8(P2IES_)
+#define P2IE         SIM_REG8(P2IE_)
+#define P2SEL        SIM_REG8(P2SEL_)
+#define P2REN        SIM_REG8(P2REN_)
+#define P3IN         SIM_REG8(P3IN_)
+#define P3OUT        SIM_REG8(P3OUT_)
+#define P3DIR        SIM_REG8(P3DIR_)
+#define P3SEL        SIM_REG8(P3SEL_)
+#define P3REN        SIM_REG8(P3REN_)
+#define P4IN         SIM_REG8(P4IN_)
+#define P4OUT        SIM_REG8(P4OUT_)
+#define P4DIR        SIM_REG8(P4DIR_)
+#define P4SEL        SIM_REG8(P4SEL_)
+#define P4REN        SIM_REG8(P4REN_)
+// timer a
+#define TAIV         SIM_REG16(TAIV_)
+#define TACTL        SIM_REG16(TACTL_)
+#define TACCTL0      SIM_REG16(TACCTL0_)
+#define TACCTL1      SIM_REG16(TACCTL1_)
+#define TACCTL2      SIM_REG16(TACCTL2_)
+#define TAR          SIM_REG16(TAR_)
+#define TACCR0       SIM_REG16(TACCR0_)
+#define TACCR1       SIM_REG16(TACCR1_)
+#define TACCR2       SIM_REG16(TACCR2_)
+// timer b
+#define TBIV         SIM_REG16(TBIV_)
+#define TBCTL        SIM_REG16(TBCTL_)
+#define TBCCTL0      SIM_REG16(TBCCTL0_)
+#define TBCCTL1      SIM_REG16(TBCCTL1_)
+#define TBCCTL2      SIM_REG16(TBCCTL2_)
+#define TBR          SIM_REG16(TBR_)
+#define TBCCR0       SIM_REG16(TBCCR0_)
+#define TBCCR1       SIM_REG16(TBCCR1_)
+#define TBCCR2       SIM_REG16(TBCCR2_)
+// usci a0
+#define UCA0CTL0     SIM_REG8(UCA0CTL0_)
+#define UCA0CTL1     SIM_REG8(UCA0CTL1_)
+#define UCA0BR0      SIM_REG8(UCA0BR0_)
+#define UCA0BR1      SIM_REG8(UCA0BR1_)
+#define UCA0MCTL     SIM_REG8(UCA0MCTL_)
+#define UCA0STAT     SIM_REG8(UCA0STAT_)
+#define UCA0RXBUF    SIM_REG8(UCA0RXBUF_)
+#define UCA0TXBUF    SIM_REG8(UCA0TXBUF_)
+#define UCA0ABCTL    SIM_REG8(UCA0ABCTL_)
+#define UCA0IRTCTL   SIM_REG8(UCA0IRTCTL_)
+#define UCA0IRRCTL   SIM_REG8(UCA0IRRCTL_)
+// usci b0
+#define UCB0CTL0     SIM_REG8(UCB0CTL0_)
+#define UCB0CTL1     SIM_REG8(UCB0CTL1_)
+#define UCB0BR0      SIM_REG8(UCB0BR0_)
+#define UCB0BR1      SIM_REG8(UCB0BR1_)
+#define UCB0I2CIE    SIM_REG8(UCB0I2CIE_)
+#define UCB0STAT     SIM_REG8(UCB0STAT_)
+#define UCB0RXBUF    SIM_REG8(UCB0RXBUF_)
+#define UCB0TXBUF    SIM_REG8(UCB0TXBUF_)
+#define UCB0I2COA    SIM_REG16(UCB0I2COA_)
+#define UCB0I2CSA    SIM_REG16(UCB0I2CSA_)
+// watchdog
+#define WDTCTL       SIM_REG16(WDTCTL_)
+// calibration data in info memory
+#define CALDCO_16MHZ SIM_REG8(CALDCO_16MHZ_)
+#define CALBC1_16MHZ SIM_REG8(CALBC1_16MHZ_)
+#define CALDCO_12MHZ SIM_REG8(CALDCO_12MHZ_)
+#define CALBC1_12MHZ SIM_REG8(CALBC1_12MHZ_)
+#define CALDCO_8MHZ  SIM_REG8(CALDCO_8MHZ_)
+#define CALBC1_8MHZ  SIM_REG8(CALBC1_8MHZ_)
+#define CALDCO_1MHZ  SIM_REG8(CALDCO_1MHZ_)
+#define CALBC1_1MHZ  SIM_REG8(CALBC1_1MHZ_)
+
+// intrinsics
+void __bis_SR_register(uint16_t bits);
+void __bic_SR_register(uint16_t bits);
+void __bic_SR_register_on_exit(uint16_t bits);
+void __bis_SR_register_on_exit(uint16_t bits);
+void __delay_cycles(uint32_t cycles);
+void __enable_interrupt(void);
+void __disable_interrupt(void);
+#define __even_in_range(value, bound)   (value)
+
+//-------------------------------------------------------------------------
+// Simulator interface, used by host programs and device models
+//-------------------------------------------------------------------------
+
+// I2C slave attached to USCI_B0. start is called with read = 1 for a read
+// transfer, write/read for each data byte, stop at the end of the transfer.
+// Until readyAt the slave is powering up and does not acknowledge
+typedef struct
+{
+    uint8_t addr;                               // 7 bit slave address
+    uint64_t readyAt;                           // cycle count
+    void (*start)(void * ctx, int read);
+    void (*write)(void * ctx, uint8_t data);
+    uint8_t (*read)(void * ctx);
+    void (*stop)(void * ctx);
+    void * ctx;
+} SimI2CDevice;
+
+// the world outside the MCU. advance is called with increasing time before
+// any register access that could observe it, uartTx receives each byte sent
+// by USCI_A0 once it has been shifted out. nextInput, if set, returns the
+// earliest time the world may change an input pin, time stops there so an
+// interrupt can be serviced before the next change
+typedef struct
+{
+    void (*advance)(void * ctx, uint64_t cycles);
+    void (*uartTx)(void * ctx, uint8_t data);
+    void * ctx;
+    uint64_t (*nextInput)(void * ctx);
+} SimWorld;
+
+// running totals since SimReset
+typedef struct
+{
+    unsigned long accesses;     // register accesses by the firmware
+    unsigned long i2cBytes;     // bytes on the I2C bus, not counting addresses
+    unsigned long i2cStarts;    // start and repeated start conditions
+    unsigned long uartBytes;    // bytes shifted out of USCI_A0
+    unsigned long interrupts;   // interrupt service routines run
+    unsigned long adcConversions;   // ADC10 conversions
+    unsigned long wdtResets;    // watchdog resets
+    uint64_t lpm3Cycles;        // SMCLK cycles asleep in LPM3 (SMCLK off)
+    uint64_t lpm4Cycles;        // and in LPM4
+} SimStats;
+
+#define SIM_MAX_I2C_DEVICES 4
+#define SIM_MAX_RAM_REGIONS 4
+
+void SimReset(void);
+void SimSetWorld(const SimWorld * world);
+void SimAttachI2C(const SimI2CDevice * dev);
+void SimDetachI2C(uint8_t addr);
+void SimSetInputs(uint8_t port, uint8_t mask, uint8_t levels);
+void SimSetInputsAt(uint8_t port, uint8_t mask, uint8_t levels, uint64_t at);
+void SimSetVlo(double hz);
+void SimSetAnalog(uint8_t channel, double volts);
+uint64_t SimCycles(void);
+const SimStats * SimGetStats(void);
+int SimRun(void (*entry)(void));
+void SimExit(int code);
+
+#endif
@@ -0,0 +1,265 @@
+/*
+ *  isscheck.c
+ *  Checks the instruction set simulator against hand assembled
+ *  instructions: every addressing mode of the double operand (format I)
+ *  and single operand (format II) instructions, the constant generators,
+ *  the jumps, and interrupt entry and RETI. Each instruction runs from the
+ *  same register and memory state, and its cycles, length, result and
+ *  flags are compared with the instruction timing tables of the MSP430x2xx
+ *  family user guide (SLAU144, 3.4.4) and the instruction descriptions.
+ *
+ *  Usage: isscheck
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include "msp430_iss.h"
+#include <stdio.h>
+#include <string.h>
+
+#define CODE            0xC000  // where each instruction runs from
+#define FLAGS           (ISS_N | ISS_Z | ISS_C | ISS_V)
+
+typedef struct
+{
+    char kind;          // 'r' register, 'w' memory word, 'b' memory byte,
+                        // 's' status flags N Z C V, 0 none
+    uint16_t where;     // register number or address
+    uint16_t value;
+} Want;
+
+typedef struct
+{
+    const char * text;
+    uint16_t code[3];
+    uint8_t words;
+    uint8_t cycles;
+    uint16_t pc;        // PC after, 0 for the next instruction
+    Want want[2];
+} Case;
+
+// start state: R4 = 0x0300, R5 = 0x1234, R8 = 0x7FFF, R9 = 0x12FF,
+// R10 = 0x0019, R11 = 0x0001, SP = 0x0400, SR = 0, and memory 0x0200 =
+// 0x0F0F, 0x0300 = 0xAAAA, 0x0302 = 0x5555, 0x0304 = 0x0008, 0x0400 =
+// 0xC300, 0xC100 = 0xBEEF
+static const Case cases[] =
+{
+    // format I, source modes to a register
+    {"mov r5, r7",          {0x4507},           1, 1, 0, {{'r', 7, 0x1234}}},
+    {"mov @r4, r7",         {0x4427},           1, 2, 0, {{'r', 7, 0xAAAA}}},
+    {"mov @r4+, r7",        {0x4437},           1, 2, 0, {{'r', 7, 0xAAAA}, {'r', 4, 0x0302}}},
+    {"mov #0x4321, r7",     {0x4037, 0x4321},   2, 2, 0, {{'r', 7, 0x4321}}},
+    {"mov 2(r4), r7",       {0x4417, 0x0002},   2, 3, 0, {{'r', 7, 0x5555}}},
+    {"mov &0x0200, r7",     {0x4217, 0x0200},   2, 3, 0, {{'r', 7, 0x0F0F}}},
+    {"mov 0xc100, r7",      {0x4017, 0x00FE},   2, 3, 0, {{'r', 7, 0xBEEF}}},
+    {"mov.b @r4, r7",       {0x4467},           1, 2, 0, {{'r', 7, 0x00AA}}},
+
+    // constant generators, register timing and one word
+    {"mov #0, r7",          {0x4307},           1, 1, 0, {{'r', 7, 0x0000}}},
+    {"mov #1, r7",          {0x4317},           1, 1, 0, {{'r', 7, 0x0001}}},
+    {"mov #2, r7",          {0x4327},           1, 1, 0, {{'r', 7, 0x0002}}},
+    {"mov #-1, r7",         {0x4337},           1, 1, 0, {{'r', 7, 0xFFFF}}},
+    {"mov #4, r7",          {0x4227},           1, 1, 0, {{'r', 7, 0x0004}}},
+    {"mov #8, r7",          {0x4237},           1, 1, 0, {{'r', 7, 0x0008}}},
+
+    // format I, memory destinations
+    {"mov r5, 4(r4)",       {0x4584, 0x0004},   2, 4, 0, {{'w', 0x0304, 0x1234}}},
+    {"mov r5, &0x0202",     {0x4582, 0x0202},   2, 4, 0, {{'w', 0x0202, 0x1234}}},
+    {"mov r5, 0xc100",      {0x4580, 0x00FE},   2, 4, 0, {{'w', 0xC100, 0x1234}}},
+    {"add @r4, 2(r4)",      {0x54A4, 0x0002},   2, 5, 0, {{'w', 0x0302, 0xFFFF}, {'s', 0, ISS_N}}},
+    {"mov #0x1234, 0(r4)",  {0x40B4, 0x1234, 0x0000}, 3, 5, 0, {{'w', 0x0300, 0x1234}}},
+    {"mov 2(r4), 4(r4)",    {0x4494, 0x0002, 0x0004}, 3, 6, 0, {{'w', 0x0304, 0x5555}}},
+    {"bit #8, 4(r4)",       {0xB2B4, 0x0004},   2, 4, 0, {{'w', 0x0304, 0x0008}, {'s', 0, ISS_C}}},
+
+    // format I, PC destination
+    {"mov r5, pc",          {0x4500},           1, 2, 0x1234, {{0}}},
+    {"mov @r4, pc",         {0x4420},           1, 2, 0xAAAA, {{0}}},
+    {"ret",                 {0x4130},           1, 3, 0xC300, {{'r', ISS_SP, 0x0402}}},
+    {"br #0xc200",          {0x4030, 0xC200},   2, 3, 0xC200, {{0}}},
+    {"mov 2(r4), pc",       {0x4410, 0x0002},   2, 3, 0x5554, {{0}}},
+
+    // arithmetic and logic flags
+    {"inc r8",              {0x5318},           1, 1, 0, {{'r', 8, 0x8000}, {'s', 0, ISS_N | ISS_V}}},
+    {"sub r5, r5",          {0x8505},           1, 1, 0, {{'r', 5, 0x0000}, {'s', 0, ISS_Z | ISS_C}}},
+    {"inc.b r9",            {0x5359},           1, 1, 0, {{'r', 9, 0x0000}, {'s', 0, ISS_Z | ISS_C}}},
+    {"and #0xff, r5",       {0xF035, 0x00FF},   2, 2, 0, {{'r', 5, 0x0034}, {'s', 0, ISS_C}}},
+    {"dadd r10, r11",       {0xAA0B},           1, 1, 0, {{'r', 11, 0x0020}}},
+    {"cmp r5, r5",          {0x9505},           1, 1, 0, {{'r', 5, 0x1234}, {'s', 0, ISS_Z | ISS_C}}},
+    {"xor r5, r5",          {0xE505},           1, 1, 0, {{'r', 5, 0x0000}, {'s', 0, ISS_Z}}},
+
+    // format II
+    {"rra r5",              {0x1105},           1, 1, 0, {{'r', 5, 0x091A}}},
+    {"rrc r9",              {0x1009},           1, 1, 0, {{'r', 9, 0x097F}, {'s', 0, ISS_C}}},
+    {"swpb r5",             {0x1085},           1, 1, 0, {{'r', 5, 0x3412}}},
+    {"sxt r9",              {0x1189},           1, 1, 0, {{'r', 9, 0xFFFF}, {'s', 0, ISS_N | ISS_C}}},
+    {"rrc @r4",             {0x1024},           1, 3, 0, {{'w', 0x0300, 0x5555}}},
+    {"rra 2(r4)",           {0x1114, 0x0002},   2, 4, 0, {{'w', 0x0302, 0x2AAA}, {'s', 0, ISS_C}}},
+    {"push r5",             {0x1205},           1, 3, 0, {{'r', ISS_SP, 0x03FE}, {'w', 0x03FE, 0x1234}}},
+    {"push.b r9",           {0x1249},           1, 3, 0, {{'r', ISS_SP, 0x03FE}, {'b', 0x03FE, 0x00FF}}},
+    {"push @r4",            {0x1224},           1, 4, 0, {{'w', 0x03FE, 0xAAAA}}},
+    {"push #0x4321",        {0x1230, 0x4321},   2, 4, 0, {{'w', 0x03FE, 0x4321}}},
+    {"push @r4+",           {0x1234},           1, 5, 0, {{'w', 0x03FE, 0xAAAA}, {'r', 4, 0x0302}}},
+    {"push 2(r4)",          {0x1214, 0x0002},   2, 5, 0, {{'w', 0x03FE, 0x5555}}},
+    {"call r5",             {0x1285},           1, 4, 0x1234, {{'w', 0x03FE, 0xC002}}},
+    {"call @r4",            {0x12A4},           1, 4, 0xAAAA, {{'w', 0x03FE, 0xC002}}},
+    {"call #0xc200",        {0x12B0, 0xC200},   2, 5, 0xC200, {{'w', 0x03FE, 0xC004}}},
+    {"call @r4+",           {0x12B4},           1, 5, 0xAAAA, {{'r', 4, 0x0302}}},
+    {"call 2(r4)",          {0x1294, 0x0002},   2, 5, 0x5554, {{'w', 0x03FE, 0xC004}}},
+    {"call &0x0200",        {0x1292, 0x0200},   2, 5, 0x0F0E, {{'r', ISS_SP, 0x03FE}}},
+
+    // jumps, 2 cycles taken or not, with all flags clear
+    {"jmp $+8",             {0x3C03},           1, 2, 0xC008, {{0}}},
+    {"jmp $-4",             {0x3FFD},           1, 2, 0xBFFC, {{0}}},
+    {"jne $+8",             {0x2003},           1, 2, 0xC008, {{0}}},
+    {"jeq $+8",             {0x2403},           1, 2, 0, {{0}}},
+    {"jnc $+8",             {0x2803},           1, 2, 0xC008, {{0}}},
+    {"jc $+8",              {0x2C03},           1, 2, 0, {{0}}},
+    {"jn $+8",              {0x3003},           1, 2, 0, {{0}}},
+    {"jge $+8",             {0x3403},           1, 2, 0xC008, {{0}}},
+    {"jl $+8",              {0x3803},           1, 2, 0, {{0}}},
+};
+
+static Msp430Iss cpu;
+static unsigned long checks;
+static unsigned long errors;
+
+static void Setup(void)
+{
+    memset(&cpu, 0, sizeof(cpu));
+    IssWriteWord(&cpu, 0xFFFE, CODE);
+    IssReset(&cpu);
+    cpu.r[ISS_SP] = 0x0400;
+    cpu.r[4] = 0x0300;
+    cpu.r[5] = 0x1234;
+    cpu.r[8] = 0x7FFF;
+    cpu.r[9] = 0x12FF;
+    cpu.r[10] = 0x0019;
+    cpu.r[11] = 0x0001;
+    IssWriteWord(&cpu, 0x0200, 0x0F0F);
+    IssWriteWord(&cpu, 0x0300, 0xAAAA);
+    IssWriteWord(&cpu, 0x0302, 0x5555);
+    IssWriteWord(&cpu, 0x0304, 0x0008);
+    IssWriteWord(&cpu, 0x0400, 0xC300);
+    IssWriteWord(&cpu, 0xC100, 0xBEEF);
+}
+
+static void Expect(const char * text, const char * what, unsigned got, unsigned want)
+//-------------------------------------------------------------------------
+// Func:  Count a check, and print it if it fails
+//-------------------------------------------------------------------------
+{
+    checks++;
+    if(got != want)
+    {
+        printf("  %-20s %s 0x%04x, expected 0x%04x\n", text, what, got, want);
+        errors++;
+    }
+}
+
+static void CheckWant(const char * text, const Want * w)
+{
+    switch(w->kind)
+    {
+        case 'r':
+            Expect(text, "register", cpu.r[w->where], w->value);
+            break;
+        case 'w':
+            Expect(text, "memory", IssReadWord(&cpu, w->where), w->value);
+            break;
+        case 'b':
+            Expect(text, "memory byte", cpu.mem[w->where], w->value);
+            break;
+        case 's':
+            Expect(text, "flags", cpu.r[ISS_SR] & FLAGS, w->value);
+            break;
+        default:
+            break;
+    }
+}
+
+static void CheckCase(const Case * c)
+//-------------------------------------------------------------------------
+// Func:  Run one instruction from the start state and check it
+//-------------------------------------------------------------------------
+{
+    IssResult res;
+    int i;
+
+    Setup();
+    for(i = 0; i < c->words; i++)
+    {
+        IssWriteWord(&cpu, CODE + 2 * i, c->code[i]);
+    }
+    res = IssStep(&cpu);
+    Expect(c->text, "result", res, ISS_OK);
+    Expect(c->text, "cycles", (unsigned)cpu.cycles, c->cycles);
+    Expect(c->text, "PC", cpu.r[ISS_PC], c->pc ? c->pc : CODE + 2 * c->words);
+    for(i = 0; i < 2; i++)
+    {
+        CheckWant(c->text, &c->want[i]);
+    }
+}
+
+static void CheckInterrupt(void)
+//-------------------------------------------------------------------------
+// Func:  Sleep in LPM0, take an interrupt, clear CPUOFF in the stacked SR
+//        (__bic_SR_register_on_exit) and return to the instruction after
+//        the sleep, awake. The CPU takes 6 cycles to enter a handler and
+//        5 for RETI.
+//-------------------------------------------------------------------------
+{
+    const char * text = "interrupt";
+
+    Setup();
+    IssWriteWord(&cpu, 0xFFF2, 0xC400);             // TIMERA0_VECTOR
+    IssWriteWord(&cpu, 0xC400, 0xC0B1);             // bic #16, 0(sp)
+    IssWriteWord(&cpu, 0xC402, 0x0010);
+    IssWriteWord(&cpu, 0xC404, 0x0000);
+    IssWriteWord(&cpu, 0xC406, 0x1300);             // reti
+    IssWriteWord(&cpu, CODE, 0x3FFF);               // jmp $
+    cpu.r[ISS_SR] = ISS_GIE | ISS_CPUOFF | ISS_C;
+
+    Expect(text, "asleep", IssStep(&cpu), ISS_HALT);
+    Expect(text, "asleep cycles", (unsigned)cpu.cycles, 0);
+
+    IssInterrupt(&cpu, 0xFFF2);
+    Expect(text, "entry cycles", (unsigned)cpu.cycles, 6);
+    Expect(text, "entry PC", cpu.r[ISS_PC], 0xC400);
+    Expect(text, "entry SR", cpu.r[ISS_SR], 0);
+    Expect(text, "entry SP", cpu.r[ISS_SP], 0x03FC);
+    Expect(text, "stacked PC", IssReadWord(&cpu, 0x03FE), CODE);
+    Expect(text, "stacked SR", IssReadWord(&cpu, 0x03FC), ISS_GIE | ISS_CPUOFF | ISS_C);
+
+    IssStep(&cpu);
+    Expect(text, "bic cycles", (unsigned)cpu.cycles, 6 + 5);
+    IssStep(&cpu);
+    Expect(text, "reti cycles", (unsigned)cpu.cycles, 6 + 5 + 5);
+    Expect(text, "reti PC", cpu.r[ISS_PC], CODE);
+    Expect(text, "reti SR", cpu.r[ISS_SR], ISS_GIE | ISS_C);
+    Expect(text, "reti SP", cpu.r[ISS_SP], 0x0400);
+
+    // awake, the jump to self ends the program
+    Expect(text, "halt", IssStep(&cpu), ISS_HALT);
+    Expect(text, "halt PC", cpu.r[ISS_PC], CODE);
+
+    // no interrupt with GIE clear
+    cpu.r[ISS_SR] = 0;
+    IssInterrupt(&cpu, 0xFFF2);
+    Expect(text, "masked PC", cpu.r[ISS_PC], CODE);
+    Expect(text, "masked SP", cpu.r[ISS_SP], 0x0400);
+}
+
+int main(void)
+{
+    unsigned i;
+
+    for(i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        CheckCase(&cases[i]);
+    }
+    CheckInterrupt();
+
+    printf("%u instructions and an interrupt, %lu checks, %lu errors\n",
+           (unsigned)(sizeof(cases) / sizeof(cases[0])), checks, errors);
+    return errors != 0;
+}
@@ -0,0 +1,530 @@
+/*
+ *  msp430_iss.c
+ *  Instruction set simulator for the MSP430 CPU, see msp430_iss.h.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - interrupt entry, CPUOFF waits for it
+ */
+
+#include "msp430_iss.h"
+#include <string.h>
+
+// operand addressing classes, as used by the cycle tables
+typedef enum
+{
+    M_REG,      // Rn, or a constant generator value
+    M_IND,      // @Rn
+    M_INC,      // @Rn+
+    M_IMM,      // #N
+    M_IDX       // x(Rn), EDE, &EDE
+} Mode;
+
+typedef struct
+{
+    Mode mode;
+    int reg;            // register number when mode is M_REG, else -1
+    uint16_t addr;      // memory address for the other modes
+    uint16_t value;
+} Operand;
+
+// format I cycles by source mode and destination: register, PC, memory
+static const uint8_t formatOneCycles[5][3] =
+{
+    {1, 2, 4},      // Rn
+    {2, 2, 5},      // @Rn
+    {2, 3, 5},      // @Rn+
+    {2, 3, 5},      // #N
+    {3, 3, 6}       // x(Rn), EDE, &EDE
+};
+
+// cycles from an interrupt request to the first instruction of the handler
+#define INTERRUPT_CYCLES    6
+
+// format II cycles by mode: RRA/RRC/SWPB/SXT, PUSH, CALL
+static const uint8_t formatTwoCycles[5][3] =
+{
+    {1, 3, 4},
+    {3, 4, 4},
+    {3, 5, 5},
+    {3, 4, 5},
+    {4, 5, 5}
+};
+
+uint16_t IssReadWord(const Msp430Iss * cpu, uint16_t addr)
+{
+    addr &= ~1;
+    return cpu->mem[addr] | (cpu->mem[addr + 1] << 8);
+}
+
+void IssWriteWord(Msp430Iss * cpu, uint16_t addr, uint16_t value)
+{
+    addr &= ~1;
+    cpu->mem[addr] = value & 0xFF;
+    cpu->mem[addr + 1] = value >> 8;
+}
+
+static uint16_t Read(const Msp430Iss * cpu, uint16_t addr, int byte)
+{
+    return byte ? cpu->mem[addr] : IssReadWord(cpu, addr);
+}
+
+static void Write(Msp430Iss * cpu, uint16_t addr, uint16_t value, int byte)
+{
+    if(byte)
+    {
+        cpu->mem[addr] = value & 0xFF;
+    }
+    else
+    {
+        IssWriteWord(cpu, addr, value);
+    }
+}
+
+static uint16_t Fetch(Msp430Iss * cpu)
+{
+    uint16_t w = IssReadWord(cpu, cpu->r[ISS_PC]);
+    cpu->r[ISS_PC] += 2;
+    return w;
+}
+
+static void SetReg(Msp430Iss * cpu, int reg, uint16_t value, int byte)
+{
+    if(byte)
+    {
+        value &= 0xFF;      // byte writes clear the upper byte
+    }
+    if(reg == ISS_PC)
+    {
+        value &= ~1;
+    }
+    if(reg != 3)            // constant generator, writes are discarded
+    {
+        cpu->r[reg] = value;
+    }
+}
+
+static void Source(Msp430Iss * cpu, int reg, int as, int byte, Operand * op)
+//-------------------------------------------------------------------------
+// Func:  Decode and read a source operand, including constant generators
+//-------------------------------------------------------------------------
+{
+    static const uint16_t cg2[4] = {0, 1, 2, 0xFFFF};
+    op->reg = -1;
+
+    if(reg == 3 || (reg == ISS_SR && as >= 2))
+    {
+        op->mode = M_REG;
+        op->value = (reg == 3) ? cg2[as] : (as == 2 ? 4 : 8);
+        if(byte)
+        {
+            op->value &= 0xFF;
+        }
+        return;
+    }
+
+    switch(as)
+    {
+        case 0:
+            op->mode = M_REG;
+            op->reg = reg;
+            op->value = byte ? (cpu->r[reg] & 0xFF) : cpu->r[reg];
+            return;
+        case 1:
+        {
+            uint16_t ext = cpu->r[ISS_PC];
+            uint16_t x = Fetch(cpu);
+            op->mode = M_IDX;
+            if(reg == ISS_SR)
+            {
+                op->addr = x;                       // &EDE
+            }
+            else if(reg == ISS_PC)
+            {
+                op->addr = ext + x;                 // EDE
+            }
+            else
+            {
+                op->addr = cpu->r[reg] + x;         // x(Rn)
+            }
+            break;
+        }
+        case 2:
+            op->mode = M_IND;
+            op->addr = cpu->r[reg];
+            break;
+        default:
+            if(reg == ISS_PC)
+            {
+                op->mode = M_IMM;
+                op->addr = cpu->r[ISS_PC];
+                cpu->r[ISS_PC] += 2;
+            }
+            else
+            {
+                op->mode = M_INC;
+                op->addr = cpu->r[reg];
+                cpu->r[reg] += (byte && reg != ISS_SP) ? 1 : 2;
+            }
+            break;
+    }
+    op->value = Read(cpu, op->addr, byte);
+}
+
+static void SetNZ(Msp430Iss * cpu, uint16_t r, uint16_t msb)
+{
+    cpu->r[ISS_SR] &= ~(ISS_N | ISS_Z);
+    if(r & msb)
+    {
+        cpu->r[ISS_SR] |= ISS_N;
+    }
+    if(r == 0)
+    {
+        cpu->r[ISS_SR] |= ISS_Z;
+    }
+}
+
+static uint16_t Add(Msp430Iss * cpu, uint16_t d, uint16_t s, uint16_t c, int byte)
+//-------------------------------------------------------------------------
+// Func:  d + s + c with all four flags, s already inverted for subtraction
+//-------------------------------------------------------------------------
+{
+    uint32_t mask = byte ? 0xFF : 0xFFFF;
+    uint16_t msb = byte ? 0x80 : 0x8000;
+    uint32_t full = (uint32_t)d + s + c;
+    uint16_t r = full & mask;
+
+    SetNZ(cpu, r, msb);
+    cpu->r[ISS_SR] &= ~(ISS_C | ISS_V);
+    if(full > mask)
+    {
+        cpu->r[ISS_SR] |= ISS_C;
+    }
+    if(~(d ^ s) & (d ^ r) & msb)
+    {
+        cpu->r[ISS_SR] |= ISS_V;
+    }
+    return r;
+}
+
+static uint16_t Dadd(Msp430Iss * cpu, uint16_t d, uint16_t s, int byte)
+{
+    int digits = byte ? 2 : 4;
+    uint16_t carry = cpu->r[ISS_SR] & ISS_C;
+    uint16_t r = 0;
+    int i;
+
+    for(i = 0; i < digits; i++)
+    {
+        uint16_t sum = ((d >> (i * 4)) & 0xF) + ((s >> (i * 4)) & 0xF) + carry;
+        carry = sum > 9;
+        if(carry)
+        {
+            sum -= 10;
+        }
+        r |= (sum & 0xF) << (i * 4);
+    }
+    SetNZ(cpu, r, byte ? 0x80 : 0x8000);
+    cpu->r[ISS_SR] &= ~ISS_C;
+    if(carry)
+    {
+        cpu->r[ISS_SR] |= ISS_C;
+    }
+    return r;
+}
+
+static void Logic(Msp430Iss * cpu, uint16_t r, uint16_t msb, int v)
+{
+    SetNZ(cpu, r, msb);
+    cpu->r[ISS_SR] &= ~(ISS_C | ISS_V);
+    if(r != 0)
+    {
+        cpu->r[ISS_SR] |= ISS_C;
+    }
+    if(v)
+    {
+        cpu->r[ISS_SR] |= ISS_V;
+    }
+}
+
+static IssResult FormatOne(Msp430Iss * cpu, uint16_t op)
+{
+    int opc = op >> 12;
+    int srcReg = (op >> 8) & 0xF;
+    int ad = (op >> 7) & 1;
+    int byte = (op >> 6) & 1;
+    int as = (op >> 4) & 3;
+    int dstReg = op & 0xF;
+    uint16_t msb = byte ? 0x80 : 0x8000;
+    uint16_t mask = byte ? 0xFF : 0xFFFF;
+    uint16_t c = cpu->r[ISS_SR] & ISS_C;
+    Operand src;
+    uint16_t dstAddr = 0;
+    uint16_t d;
+    uint16_t r;
+    int write = 1;
+    int dstClass;
+
+    Source(cpu, srcReg, as, byte, &src);
+
+    if(ad)
+    {
+        uint16_t ext = cpu->r[ISS_PC];
+        uint16_t x = Fetch(cpu);
+        if(dstReg == ISS_SR)
+        {
+            dstAddr = x;
+        }
+        else if(dstReg == ISS_PC)
+        {
+            dstAddr = ext + x;
+        }
+        else
+        {
+            dstAddr = cpu->r[dstReg] + x;
+        }
+        d = Read(cpu, dstAddr, byte);
+        dstClass = 2;
+    }
+    else
+    {
+        d = cpu->r[dstReg] & mask;
+        dstClass = (dstReg == ISS_PC) ? 1 : 0;
+    }
+
+    switch(opc)
+    {
+        case 0x4:   // MOV
+            r = src.value;
+            break;
+        case 0x5:   // ADD
+            r = Add(cpu, d, src.value, 0, byte);
+            break;
+        case 0x6:   // ADDC
+            r = Add(cpu, d, src.value, c, byte);
+            break;
+        case 0x7:   // SUBC
+            r = Add(cpu, d, ~src.value & mask, c, byte);
+            break;
+        case 0x8:   // SUB
+            r = Add(cpu, d, ~src.value & mask, 1, byte);
+            break;
+        case 0x9:   // CMP
+            r = Add(cpu, d, ~src.value & mask, 1, byte);
+            write = 0;
+            break;
+        case 0xA:   // DADD
+            r = Dadd(cpu, d, src.value, byte);
+            break;
+        case 0xB:   // BIT
+            r = src.value & d;
+            Logic(cpu, r, msb, 0);
+            write = 0;
+            break;
+        case 0xC:   // BIC
+            r = d & ~src.value;
+            break;
+        case 0xD:   // BIS
+            r = d | src.value;
+            break;
+        case 0xE:   // XOR
+            r = (src.value ^ d) & mask;
+            Logic(cpu, r, msb, (src.value & msb) && (d & msb));
+            break;
+        default:    // AND
+            r = src.value & d;
+            Logic(cpu, r, msb, 0);
+            break;
+    }
+
+    if(write)
+    {
+        if(ad)
+        {
+            Write(cpu, dstAddr, r, byte);
+        }
+        else
+        {
+            SetReg(cpu, dstReg, r, byte);
+        }
+    }
+
+    cpu->cycles += formatOneCycles[src.mode][dstClass];
+    return ISS_OK;
+}
+
+static IssResult FormatTwo(Msp430Iss * cpu, uint16_t op)
+{
+    int opc = (op >> 7) & 7;
+    int byte = (op >> 6) & 1;
+    int as = (op >> 4) & 3;
+    int reg = op & 0xF;
+    uint16_t msb = byte ? 0x80 : 0x8000;
+    Operand o;
+    uint16_t r;
+    uint16_t c;
+
+    if(opc == 6)    // RETI
+    {
+        cpu->r[ISS_SR] = IssReadWord(cpu, cpu->r[ISS_SP]);
+        cpu->r[ISS_PC] = IssReadWord(cpu, cpu->r[ISS_SP] + 2);
+        cpu->r[ISS_SP] += 4;
+        cpu->cycles += 5;
+        return ISS_OK;
+    }
+    if(opc == 7)
+    {
+        return ISS_ILLEGAL;
+    }
+
+    Source(cpu, reg, as, byte, &o);
+
+    switch(opc)
+    {
+        case 0:     // RRC
+            c = cpu->r[ISS_SR] & ISS_C;
+            r = (o.value >> 1) | (c ? msb : 0);
+            SetNZ(cpu, r, msb);
+            cpu->r[ISS_SR] &= ~(ISS_C | ISS_V);
+            cpu->r[ISS_SR] |= (o.value & 1) ? ISS_C : 0;
+            break;
+        case 1:     // SWPB
+            r = (o.value >> 8) | (o.value << 8);
+            break;
+        case 2:     // RRA
+            r = (o.value >> 1) | (o.value & msb);
+            SetNZ(cpu, r, msb);
+            cpu->r[ISS_SR] &= ~(ISS_C | ISS_V);
+            cpu->r[ISS_SR] |= (o.value & 1) ? ISS_C : 0;
+            break;
+        case 3:     // SXT
+            r = (uint16_t)(int16_t)(int8_t)(o.value & 0xFF);
+            Logic(cpu, r, 0x8000, 0);
+            byte = 0;
+            break;
+        case 4:     // PUSH
+            cpu->r[ISS_SP] -= 2;
+            Write(cpu, cpu->r[ISS_SP], o.value, byte);
+            cpu->cycles += formatTwoCycles[o.mode][1];
+            return ISS_OK;
+        default:    // CALL
+            cpu->r[ISS_SP] -= 2;
+            IssWriteWord(cpu, cpu->r[ISS_SP], cpu->r[ISS_PC]);
+            cpu->r[ISS_PC] = o.value & ~1;
+            cpu->cycles += formatTwoCycles[o.mode][2];
+            return ISS_OK;
+    }
+
+    if(o.mode == M_REG)
+    {
+        SetReg(cpu, o.reg, r, byte);
+    }
+    else if(o.mode != M_IMM)
+    {
+        Write(cpu, o.addr, r, byte);
+    }
+    cpu->cycles += formatTwoCycles[o.mode][0];
+    return ISS_OK;
+}
+
+static IssResult Jump(Msp430Iss * cpu, uint16_t op)
+{
+    uint16_t sr = cpu->r[ISS_SR];
+    int n = (sr & ISS_N) != 0;
+    int v = (sr & ISS_V) != 0;
+    int take;
+    int16_t offset = (int16_t)((op & 0x3FF) << 6) >> 5;    // sign extend, x2
+
+    switch((op >> 10) & 7)
+    {
+        case 0: take = !(sr & ISS_Z); break;    // JNE
+        case 1: take = (sr & ISS_Z) != 0; break;// JEQ
+        case 2: take = !(sr & ISS_C); break;    // JNC
+        case 3: take = (sr & ISS_C) != 0; break;// JC
+        case 4: take = n; break;                // JN
+        case 5: take = (n == v); break;         // JGE
+        case 6: take = (n != v); break;         // JL
+        default: take = 1; break;               // JMP
+    }
+
+    cpu->cycles += 2;
+    if(take)
+    {
+        if(offset == -2)
+        {
+            cpu->r[ISS_PC] -= 2;
+            return ISS_HALT;    // jump to self, end of program
+        }
+        cpu->r[ISS_PC] += offset;
+    }
+    return ISS_OK;
+}
+
+void IssReset(Msp430Iss * cpu)
+//-------------------------------------------------------------------------
+// Func:  Clear registers and start from the reset vector, memory is kept
+//-------------------------------------------------------------------------
+{
+    memset(cpu->r, 0, sizeof(cpu->r));
+    cpu->r[ISS_PC] = IssReadWord(cpu, 0xFFFE);
+    cpu->cycles = 0;
+    cpu->instructions = 0;
+}
+
+IssResult IssStep(Msp430Iss * cpu)
+//-------------------------------------------------------------------------
+// Func:  Execute one instruction
+//-------------------------------------------------------------------------
+{
+    uint16_t op;
+    IssResult res;
+
+    if(cpu->r[ISS_SR] & ISS_CPUOFF)
+    {
+        return ISS_HALT;    // asleep until IssInterrupt, if GIE is set
+    }
+
+    op = Fetch(cpu);
+    if((op & 0xE000) == 0x2000)
+    {
+        res = Jump(cpu, op);
+    }
+    else if((op & 0xFC00) == 0x1000)
+    {
+        res = FormatTwo(cpu, op);
+    }
+    else if(op >= 0x4000)
+    {
+        res = FormatOne(cpu, op);
+    }
+    else
+    {
+        res = ISS_ILLEGAL;
+    }
+
+    if(res != ISS_ILLEGAL)
+    {
+        cpu->instructions++;
+    }
+    return res;
+}
+
+void IssInterrupt(Msp430Iss * cpu, uint16_t vector)
+//-------------------------------------------------------------------------
+// Func:  Enter an interrupt handler as the CPU does: push PC and SR, clear
+//        SR (GIE and the low power bits, SCG0 is kept) and load PC from
+//        the vector, which also wakes the CPU. Does nothing with GIE clear.
+// Args:  vector - address of the vector, 0xFFE0 to 0xFFFC
+//-------------------------------------------------------------------------
+{
+    if(!(cpu->r[ISS_SR] & ISS_GIE))
+    {
+        return;
+    }
+    cpu->r[ISS_SP] -= 2;
+    IssWriteWord(cpu, cpu->r[ISS_SP], cpu->r[ISS_PC]);
+    cpu->r[ISS_SP] -= 2;
+    IssWriteWord(cpu, cpu->r[ISS_SP], cpu->r[ISS_SR]);
+    cpu->r[ISS_SR] &= ISS_SCG0;
+    cpu->r[ISS_PC] = IssReadWord(cpu, vector);
+    cpu->cycles += INTERRUPT_CYCLES;
+}
@@ -0,0 +1,54 @@
+/*
+ *  msp430_iss.h
+ *  Instruction set simulator for the MSP430 CPU (not CPUX) used in the
+ *  MSP430F2274. Counts MCLK cycles per instruction using the tables in
+ *  section 3.4.4 of the MSP430x2xx family user guide (SLAU144), which is
+ *  exact for code running from flash with no wait states. Peripherals are
+ *  not modelled, the peripheral address range behaves as plain memory;
+ *  the caller raises interrupts (IssInterrupt). host/iss/isscheck.c checks
+ *  the timings and results against hand assembled instructions.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - interrupt entry, CPUOFF waits for it
+ */
+
+#ifndef MSP430_ISS_H_
+#define MSP430_ISS_H_
+
+#include <stdint.h>
+
+#define ISS_PC  0
+#define ISS_SP  1
+#define ISS_SR  2
+
+// status register bits
+#define ISS_C   0x0001
+#define ISS_Z   0x0002
+#define ISS_N   0x0004
+#define ISS_GIE 0x0008
+#define ISS_CPUOFF  0x0010
+#define ISS_SCG0    0x0040
+#define ISS_V   0x0100
+
+typedef enum
+{
+    ISS_OK,
+    ISS_HALT,       // jump to self, or CPUOFF until an interrupt
+    ISS_ILLEGAL     // undefined opcode
+} IssResult;
+
+typedef struct
+{
+    uint16_t r[16];         // registers, r[0] is PC
+    uint8_t mem[65536];
+    uint64_t cycles;
+    uint64_t instructions;
+} Msp430Iss;
+
+void IssReset(Msp430Iss * cpu);
+IssResult IssStep(Msp430Iss * cpu);
+void IssInterrupt(Msp430Iss * cpu, uint16_t vector);
+uint16_t IssReadWord(const Msp430Iss * cpu, uint16_t addr);
+void IssWriteWord(Msp430Iss * cpu, uint16_t addr, uint16_t value);
+
+#endif
@@ -0,0 +1,299 @@
+/*
+ *  mspbench.c
+ *  Cycle counts and code size of firmware functions on the real CPU. Loads
+ *  an msp430-elf executable (the cyclebench program built from
+ *  host/bench/msp430, or any other image), runs it from reset on the
+ *  instruction set simulator until it halts, and reports for every
+ *  function that was entered its code size, call count and MCLK cycles per
+ *  call including callees such as the libgcc multiply and divide helpers.
+ *
+ *  Usage: mspbench [--csv] [--limit cycles] image.elf
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include "msp430_iss.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EM_MSP430       105
+#define PT_LOAD         1
+#define SHT_SYMTAB      2
+#define STT_FUNC        2
+#define MAX_DEPTH       64
+
+typedef struct
+{
+    char name[48];
+    uint16_t addr;
+    uint16_t size;
+    uint64_t calls;
+    uint64_t cycles;
+} Func;
+
+typedef struct
+{
+    int func;
+    uint16_t sp;            // SP on entry, return address is at this slot
+    uint64_t start;
+} Frame;
+
+static Msp430Iss cpu;
+static Func * funcs;
+static int numFuncs;
+static int16_t funcAt[65536];   // function index by entry address, or -1
+
+static uint32_t Get32(const uint8_t * p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t Get16(const uint8_t * p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static int LoadElf(const char * path)
+//-------------------------------------------------------------------------
+// Func:  Copy the loadable segments into memory and collect the function
+//        symbols
+// Retn:  0 on success, -1 if the file is not an MSP430 executable
+//-------------------------------------------------------------------------
+{
+    FILE * f = fopen(path, "rb");
+    uint8_t * img;
+    long len;
+    uint32_t phoff, shoff;
+    uint16_t phnum, shnum, phentsize, shentsize;
+    int i;
+
+    if(f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    img = malloc(len);
+    if(img == NULL || fread(img, 1, len, f) != (size_t)len)
+    {
+        fclose(f);
+        free(img);
+        return -1;
+    }
+    fclose(f);
+
+    if(len < 52 || memcmp(img, "\177ELF", 4) != 0 || img[4] != 1 || img[5] != 1 ||
+       Get16(img + 18) != EM_MSP430)
+    {
+        fprintf(stderr, "%s: not a 32 bit little endian MSP430 ELF file\n", path);
+        free(img);
+        return -1;
+    }
+
+    phoff = Get32(img + 28);
+    shoff = Get32(img + 32);
+    phentsize = Get16(img + 42);
+    phnum = Get16(img + 44);
+    shentsize = Get16(img + 46);
+    shnum = Get16(img + 48);
+
+    // load by physical address, the startup code copies .data itself
+    for(i = 0; i < phnum; i++)
+    {
+        const uint8_t * ph = img + phoff + i * phentsize;
+        uint32_t offset = Get32(ph + 4);
+        uint32_t paddr = Get32(ph + 12);
+        uint32_t filesz = Get32(ph + 16);
+        if(Get32(ph) == PT_LOAD && filesz > 0 && paddr + filesz <= 0x10000)
+        {
+            memcpy(cpu.mem + paddr, img + offset, filesz);
+        }
+    }
+
+    memset(funcAt, 0xFF, sizeof(funcAt));
+    for(i = 0; i < shnum; i++)
+    {
+        const uint8_t * sh = img + shoff + i * shentsize;
+        const uint8_t * strsh;
+        uint32_t symoff, symsize, entsize, stroff;
+        uint32_t j;
+
+        if(Get32(sh + 4) != SHT_SYMTAB)
+        {
+            continue;
+        }
+        symoff = Get32(sh + 16);
+        symsize = Get32(sh + 20);
+        entsize = Get32(sh + 36);
+        strsh = img + shoff + Get32(sh + 24) * shentsize;
+        stroff = Get32(strsh + 16);
+
+        funcs = calloc(symsize / entsize, sizeof(Func));
+        for(j = 0; j < symsize / entsize; j++)
+        {
+            const uint8_t * sym = img + symoff + j * entsize;
+            uint32_t value = Get32(sym + 4);
+            uint32_t size = Get32(sym + 8);
+            if((sym[12] & 0xF) != STT_FUNC || value >= 0x10000 || funcAt[value] >= 0)
+            {
+                continue;
+            }
+            Func * fn = &funcs[numFuncs];
+            snprintf(fn->name, sizeof(fn->name), "%s",
+                     (const char *)img + stroff + Get32(sym));
+            fn->addr = value;
+            fn->size = size;
+            funcAt[value] = numFuncs++;
+        }
+    }
+
+    free(img);
+    return 0;
+}
+
+static int FindFunc(const char * name)
+{
+    int i;
+    for(i = 0; i < numFuncs; i++)
+    {
+        if(strcmp(funcs[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int ByAddress(const void * a, const void * b)
+{
+    return ((const Func *)a)->addr - ((const Func *)b)->addr;
+}
+
+static void Usage(void)
+{
+    fprintf(stderr,
+            "usage: mspbench [options] image.elf\n"
+            "  --csv          print name,size,calls,cycles_per_call lines\n"
+            "  --limit n      stop after n cycles, default 100000000\n");
+}
+
+int main(int argc, char ** argv)
+{
+    const char * path = NULL;
+    uint64_t limit = 100000000;
+    int csv = 0;
+    Frame stack[MAX_DEPTH];
+    int depth = 0;
+    IssResult res = ISS_OK;
+    int exitFunc;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(strcmp(argv[i], "--limit") == 0 && i + 1 < argc)
+        {
+            limit = strtoull(argv[++i], NULL, 0);
+        }
+        else if(argv[i][0] != '-' && path == NULL)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            Usage();
+            return 2;
+        }
+    }
+    if(path == NULL)
+    {
+        Usage();
+        return 2;
+    }
+    if(LoadElf(path) != 0)
+    {
+        return 1;
+    }
+
+    IssReset(&cpu);
+    exitFunc = FindFunc("_exit");
+    while(res == ISS_OK && cpu.cycles < limit)
+    {
+        int fn = funcAt[cpu.r[ISS_PC]];
+
+        if(fn >= 0 && fn == exitFunc)
+        {
+            res = ISS_HALT;         // main returned
+            break;
+        }
+
+        // a function is entered when execution reaches its first
+        // instruction, by CALL or by a tail call branch. The reset entry
+        // point has no return address and is not timed.
+        if(fn >= 0 && cpu.instructions > 0 && depth < MAX_DEPTH)
+        {
+            stack[depth].func = fn;
+            stack[depth].sp = cpu.r[ISS_SP];
+            stack[depth].start = cpu.cycles;
+            depth++;
+            funcs[fn].calls++;
+        }
+
+        res = IssStep(&cpu);
+
+        // it has returned once its return address has been popped
+        while(depth > 0 && cpu.r[ISS_SP] > stack[depth - 1].sp)
+        {
+            depth--;
+            funcs[stack[depth].func].cycles += cpu.cycles - stack[depth].start;
+        }
+    }
+
+    if(res == ISS_ILLEGAL)
+    {
+        fprintf(stderr, "illegal instruction at 0x%04x\n", cpu.r[ISS_PC] - 2);
+        return 1;
+    }
+    if(res != ISS_HALT)
+    {
+        fprintf(stderr, "did not halt within %llu cycles\n", (unsigned long long)limit);
+        return 1;
+    }
+
+    qsort(funcs, numFuncs, sizeof(Func), ByAddress);
+    if(!csv)
+    {
+        printf("%llu cycles, %llu instructions, halted at 0x%04x\n",
+               (unsigned long long)cpu.cycles, (unsigned long long)cpu.instructions,
+               cpu.r[ISS_PC]);
+        printf("%-28s %6s %6s %8s %10s\n", "function", "addr", "bytes", "calls", "cycles/call");
+    }
+    for(i = 0; i < numFuncs; i++)
+    {
+        const Func * fn = &funcs[i];
+        double perCall = fn->calls ? (double)fn->cycles / fn->calls : 0;
+        if(fn->calls == 0)
+        {
+            continue;
+        }
+        if(csv)
+        {
+            printf("%s,%u,%llu,%.1f\n", fn->name, fn->size,
+                   (unsigned long long)fn->calls, perCall);
+        }
+        else
+        {
+            printf("%-28s 0x%04x %6u %8llu %10.1f\n", fn->name, fn->addr, fn->size,
+                   (unsigned long long)fn->calls, perCall);
+        }
+    }
+
+    free(funcs);
+    return 0;
+}
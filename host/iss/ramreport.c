@@ -0,0 +1,738 @@
+/*
+ *  ramreport.c
+ *  RAM budget of an msp430-elf image for the 1 KB of the MSP430F2274: the
+ *  static data the linker put in RAM, largest objects first, and the worst
+ *  case stack depth of every function, found from the code rather than by
+ *  running it. What is left over is what sample buffers may take.
+ *
+ *  Each function is followed along every branch from its entry, keeping
+ *  the stack offset: PUSH and SUB #n, SP grow it, pops and ADD #n, SP
+ *  shrink it, and CALL #f adds the return address and f's own depth. A
+ *  branch to another function (a tail call) adds that function's depth at
+ *  the current offset. Indirect calls, recursion and SP loaded from a
+ *  register cannot be bounded; such depths are lower bounds, marked +.
+ *  An indirect branch (a switch table) is taken to reach any code in the
+ *  function not otherwise reached, at the offset of the branch.
+ *
+ *  The worst case is main's depth plus the return address of the call
+ *  from the startup code, plus the deepest interrupt handler (functions
+ *  that end in RETI) and the 4 bytes the CPU pushes on entry. Handlers do
+ *  not nest, none of them sets GIE. Any msp430 ELF image works, the
+ *  cyclebench program or the IAR firmware linked to ELF.
+ *
+ *  Usage: ramreport [--csv] image.elf
+ *  Exit status 1 if static data and the worst case stack overflow RAM.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EM_MSP430       105
+#define SHT_SYMTAB      2
+#define SHT_NOBITS      8
+#define SHF_ALLOC       2
+#define STT_OBJECT      1
+#define STT_FUNC        2
+#define RAM_START       0x0200      // MSP430F2274, 1 KB
+#define RAM_SIZE        1024
+#define ISR_ENTRY       4           // PC and SR pushed by the CPU
+#define MAX_SHOWN       8           // largest objects listed
+#define MAX_WORK        4096        // pending branches per function
+
+// what an instruction does to the flow
+typedef enum
+{
+    I_NEXT,         // falls through
+    I_JUMP,         // JMP
+    I_JCC,          // conditional jump, both ways
+    I_CALL,         // CALL #f
+    I_CALLI,        // CALL through a register or memory
+    I_RET,          // RET
+    I_RETI,         // RETI
+    I_BR,           // BR #a, a jump or a tail call
+    I_BRI,          // write to PC from a register or memory
+    I_BAD           // not an MSP430 instruction
+} Kind;
+
+typedef struct
+{
+    Kind kind;
+    uint16_t len;
+    uint16_t target;
+    int grow;               // stack growth, bytes
+    int spLoaded;           // SP written other than by a constant
+} Insn;
+
+// function flags
+#define F_ISR           0x01    // ends in RETI
+#define F_CALLED        0x02    // called or branched to by another
+#define F_OPEN          0x04    // depth is a lower bound
+#define F_BUSY          0x08    // being analysed
+#define F_DONE          0x10
+
+typedef struct
+{
+    char name[48];
+    uint16_t addr;
+    uint16_t size;
+    int frame;              // own stack use, return address not counted
+    int depth;              // frame and the deepest callee
+    int next;               // callee on the deepest path, or -1
+    uint8_t flags;
+} Func;
+
+typedef struct
+{
+    char name[48];
+    char section[16];
+    uint16_t size;
+} Object;
+
+typedef struct
+{
+    uint16_t pc;
+    int off;
+} Work;
+
+static uint8_t mem[65536];      // code and constants
+static Func * funcs;
+static int numFuncs;
+static Object * objects;
+static int numObjects;
+static int16_t funcAt[65536];   // function index by entry address, or -1
+static uint32_t ramData;        // static RAM by kind of section
+static uint32_t ramBss;
+static uint32_t ramReserved;    // stack and heap the linker sets aside
+
+static uint32_t Get32(const uint8_t * p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t Get16(const uint8_t * p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint16_t Word(uint16_t addr)
+{
+    return mem[addr & 0xFFFE] | (mem[(addr & 0xFFFE) + 1] << 8);
+}
+
+static int InRam(uint32_t addr)
+{
+    return addr >= RAM_START && addr < RAM_START + RAM_SIZE;
+}
+
+static int ByAddress(const void * a, const void * b)
+{
+    return ((const Func *)a)->addr - ((const Func *)b)->addr;
+}
+
+static int BySize(const void * a, const void * b)
+{
+    return ((const Object *)b)->size - ((const Object *)a)->size;
+}
+
+static int LoadElf(const char * path)
+//-------------------------------------------------------------------------
+// Func:  Copy the allocated sections into memory, add up the ones in RAM
+//        and collect the function and RAM object symbols
+// Retn:  0 on success, -1 if the file is not an MSP430 image
+//-------------------------------------------------------------------------
+{
+    FILE * f = fopen(path, "rb");
+    uint8_t * img;
+    long len;
+    uint32_t shoff;
+    uint16_t shnum, shentsize, shstrndx;
+    const uint8_t * shstr;
+    int i;
+
+    if(f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    img = malloc(len);
+    if(img == NULL || fread(img, 1, len, f) != (size_t)len)
+    {
+        fclose(f);
+        free(img);
+        return -1;
+    }
+    fclose(f);
+
+    if(len < 52 || memcmp(img, "\177ELF", 4) != 0 || img[4] != 1 || img[5] != 1 ||
+       Get16(img + 18) != EM_MSP430)
+    {
+        fprintf(stderr, "%s: not a 32 bit little endian MSP430 ELF file\n", path);
+        free(img);
+        return -1;
+    }
+
+    shoff = Get32(img + 32);
+    shentsize = Get16(img + 46);
+    shnum = Get16(img + 48);
+    shstrndx = Get16(img + 50);
+    shstr = img + Get32(img + shoff + shstrndx * shentsize + 16);
+
+    // by section address, that is where the code runs and the data lives
+    for(i = 0; i < shnum; i++)
+    {
+        const uint8_t * sh = img + shoff + i * shentsize;
+        const char * name = (const char *)shstr + Get32(sh);
+        uint32_t type = Get32(sh + 4);
+        uint32_t addr = Get32(sh + 12);
+        uint32_t size = Get32(sh + 20);
+
+        if(!(Get32(sh + 8) & SHF_ALLOC) || size == 0 || addr + size > 0x10000)
+        {
+            continue;
+        }
+        if(InRam(addr))
+        {
+            if(strcmp(name, ".stack") == 0 || strcmp(name, "CSTACK") == 0 ||
+               strcmp(name, ".heap") == 0 || strcmp(name, "HEAP") == 0)
+            {
+                ramReserved += size;
+            }
+            else if(type == SHT_NOBITS)
+            {
+                ramBss += size;
+            }
+            else
+            {
+                ramData += size;
+            }
+        }
+        else if(type != SHT_NOBITS)
+        {
+            memcpy(mem + addr, img + Get32(sh + 16), size);
+        }
+    }
+
+    memset(funcAt, 0xFF, sizeof(funcAt));
+    for(i = 0; i < shnum; i++)
+    {
+        const uint8_t * sh = img + shoff + i * shentsize;
+        const uint8_t * strsh;
+        uint32_t symoff, symsize, entsize, stroff;
+        uint32_t j;
+
+        if(Get32(sh + 4) != SHT_SYMTAB)
+        {
+            continue;
+        }
+        symoff = Get32(sh + 16);
+        symsize = Get32(sh + 20);
+        entsize = Get32(sh + 36);
+        strsh = img + shoff + Get32(sh + 24) * shentsize;
+        stroff = Get32(strsh + 16);
+
+        funcs = calloc(symsize / entsize, sizeof(Func));
+        objects = calloc(symsize / entsize, sizeof(Object));
+        for(j = 0; j < symsize / entsize; j++)
+        {
+            const uint8_t * sym = img + symoff + j * entsize;
+            const char * name = (const char *)img + stroff + Get32(sym);
+            uint32_t value = Get32(sym + 4);
+            uint32_t size = Get32(sym + 8);
+            uint16_t shndx = Get16(sym + 14);
+
+            if((sym[12] & 0xF) == STT_OBJECT && InRam(value) && size > 0)
+            {
+                Object * ob = &objects[numObjects++];
+                snprintf(ob->name, sizeof(ob->name), "%s", name);
+                snprintf(ob->section, sizeof(ob->section), "%s", shndx < shnum ?
+                         (const char *)shstr + Get32(img + shoff + shndx * shentsize) : "");
+                ob->size = size;
+            }
+            if((sym[12] & 0xF) != STT_FUNC || value >= 0x10000 || funcAt[value] >= 0)
+            {
+                continue;
+            }
+            Func * fn = &funcs[numFuncs];
+            snprintf(fn->name, sizeof(fn->name), "%s", name);
+            fn->addr = value;
+            fn->size = size;
+            fn->next = -1;
+            funcAt[value] = numFuncs++;
+        }
+    }
+    free(img);
+
+    // a function without a size runs up to the next one
+    qsort(funcs, numFuncs, sizeof(Func), ByAddress);
+    for(i = 0; i < numFuncs; i++)
+    {
+        funcAt[funcs[i].addr] = i;
+        if(funcs[i].size == 0)
+        {
+            funcs[i].size = (i + 1 < numFuncs ? funcs[i + 1].addr : 0x10000) - funcs[i].addr;
+        }
+    }
+    qsort(objects, numObjects, sizeof(Object), BySize);
+    return 0;
+}
+
+static int SrcExt(int as, int reg)
+{
+    // x(Rn), EDE, &EDE and #N take an extension word, the constant
+    // generator R3 does not
+    return (as == 1 && reg != 3) || (as == 3 && reg == 0);
+}
+
+static int Constant(int as, int reg, uint16_t ext, int16_t * k)
+//-------------------------------------------------------------------------
+// Func:  Source operand value when it is a constant
+// Retn:  1 and the value in k, or 0 if the operand is not a constant
+//-------------------------------------------------------------------------
+{
+    static const int16_t r3[4] = {0, 1, 2, -1};
+
+    if(reg == 3)
+    {
+        *k = r3[as];
+        return 1;
+    }
+    if(reg == 2 && as >= 2)
+    {
+        *k = (as == 2) ? 4 : 8;
+        return 1;
+    }
+    if(reg == 0 && as == 3)
+    {
+        *k = (int16_t)ext;
+        return 1;
+    }
+    return 0;
+}
+
+static void Decode(uint16_t pc, Insn * in)
+//-------------------------------------------------------------------------
+// Func:  Length, flow and stack effect of the instruction at pc
+//-------------------------------------------------------------------------
+{
+    uint16_t w = Word(pc);
+
+    memset(in, 0, sizeof(*in));
+    in->kind = I_NEXT;
+    in->len = 2;
+
+    if((w & 0xE000) == 0x2000)                  // jumps
+    {
+        int off = w & 0x3FF;
+        if(off & 0x200)
+        {
+            off -= 0x400;
+        }
+        in->target = pc + 2 + 2 * off;
+        in->kind = ((w >> 10) & 7) == 7 ? I_JUMP : I_JCC;
+    }
+    else if((w & 0xFC00) == 0x1000)             // single operand
+    {
+        int op = (w >> 7) & 7;
+        int as = (w >> 4) & 3;
+        int reg = w & 0xF;
+
+        in->len += SrcExt(as, reg) ? 2 : 0;
+        if(as == 3 && reg == 1)
+        {
+            in->grow -= 2;                      // @SP+
+        }
+        if(op == 4)
+        {
+            in->grow += 2;                      // PUSH
+        }
+        else if(op == 5)
+        {
+            in->kind = (as == 3 && reg == 0) ? I_CALL : I_CALLI;
+            in->target = Word(pc + 2);
+        }
+        else if(op == 6)
+        {
+            in->kind = I_RETI;
+        }
+        else if(op == 7)
+        {
+            in->kind = I_BAD;
+        }
+        else if(as == 0 && reg == 1)
+        {
+            in->spLoaded = 1;                   // RRA SP and the like
+        }
+    }
+    else if(w >= 0x4000)                        // two operands
+    {
+        int op = w >> 12;
+        int src = (w >> 8) & 0xF;
+        int ad = (w >> 7) & 1;
+        int as = (w >> 4) & 3;
+        int dst = w & 0xF;
+        int writes = op != 0x9 && op != 0xB;    // CMP and BIT only read
+        uint16_t ext = Word(pc + 2);
+        int16_t k;
+
+        in->len += (SrcExt(as, src) ? 2 : 0) + (ad ? 2 : 0);
+        if(as == 3 && src == 1)
+        {
+            in->grow -= 2;                      // @SP+, POP
+        }
+        if(writes && ad == 0 && dst == 1)
+        {
+            if(op == 0x8 && Constant(as, src, ext, &k))
+            {
+                in->grow += k;                  // SUB #n, SP
+            }
+            else if(op == 0x5 && Constant(as, src, ext, &k))
+            {
+                in->grow -= k;                  // ADD #n, SP
+            }
+            else
+            {
+                in->spLoaded = 1;
+            }
+        }
+        if(writes && ad == 0 && dst == 0)
+        {
+            if(op == 0x4 && as == 3 && src == 1)
+            {
+                in->kind = I_RET;
+                in->grow = 0;                   // leaves with the address
+            }
+            else if(op == 0x4 && as == 3 && src == 0)
+            {
+                in->kind = I_BR;
+                in->target = ext;
+            }
+            else
+            {
+                in->kind = I_BRI;
+            }
+        }
+    }
+    else
+    {
+        in->kind = I_BAD;                       // CPUX, not on the F2274
+    }
+}
+
+static int Depth(int f);
+
+static void Reach(int f, int callee, int off)
+//-------------------------------------------------------------------------
+// Func:  Account for entering another function with off bytes on the stack
+//        (the return address included for a call)
+//-------------------------------------------------------------------------
+{
+    Func * fn = &funcs[f];
+
+    if(callee < 0)
+    {
+        fn->flags |= F_OPEN;                    // not a known function
+        return;
+    }
+    funcs[callee].flags |= F_CALLED;
+    if(funcs[callee].flags & F_BUSY)
+    {
+        fn->flags |= F_OPEN;                    // recursion
+        return;
+    }
+    if(off + Depth(callee) > fn->depth)
+    {
+        fn->depth = off + funcs[callee].depth;
+        fn->next = callee;
+    }
+    fn->flags |= funcs[callee].flags & F_OPEN;
+}
+
+static int Depth(int f)
+//-------------------------------------------------------------------------
+// Func:  Worst case stack depth of a function and its callees, working it
+//        out the first time
+// Retn:  bytes below the return address, a lower bound if F_OPEN is set
+//-------------------------------------------------------------------------
+{
+    Func * fn = &funcs[f];
+    uint32_t end = (uint32_t)fn->addr + fn->size;
+    int * offAt;                // stack offset reached at each word, -1 none
+    Work * work;
+    int numWork = 0;
+    int branchOff = -1;         // deepest offset of an indirect branch
+    int swept = 0;
+
+    if(fn->flags & F_DONE)
+    {
+        return fn->depth;
+    }
+    fn->flags |= F_BUSY;
+    offAt = malloc((fn->size / 2 + 1) * sizeof(int));
+    work = malloc(MAX_WORK * sizeof(Work));
+    memset(offAt, 0xFF, (fn->size / 2 + 1) * sizeof(int));
+    work[numWork].pc = fn->addr;
+    work[numWork++].off = 0;
+
+    while(numWork > 0 || (branchOff >= 0 && !swept))
+    {
+        Work w;
+        Insn in;
+        int after;
+
+        if(numWork == 0)
+        {
+            // the rest of the function is reached through the branch
+            uint32_t pc = fn->addr;
+            swept = 1;
+            while(pc < end && numWork < MAX_WORK)
+            {
+                Decode(pc, &in);
+                if(offAt[(pc - fn->addr) / 2] < 0)
+                {
+                    work[numWork].pc = pc;
+                    work[numWork++].off = branchOff;
+                }
+                pc += in.len;
+            }
+            continue;
+        }
+        w = work[--numWork];
+
+        if(w.pc < fn->addr || w.pc >= end)
+        {
+            Reach(f, funcAt[w.pc], w.off);      // jumped or ran into another
+            continue;
+        }
+        if(offAt[(w.pc - fn->addr) / 2] >= w.off)
+        {
+            continue;
+        }
+        if(w.off > RAM_SIZE)
+        {
+            fn->flags |= F_OPEN;                // pushes in a loop
+            continue;
+        }
+        offAt[(w.pc - fn->addr) / 2] = w.off;
+
+        Decode(w.pc, &in);
+        after = w.off + in.grow;
+        if(after > fn->frame)
+        {
+            fn->frame = after;
+        }
+        if(w.off > fn->frame)
+        {
+            fn->frame = w.off;
+        }
+        if(after > fn->depth)
+        {
+            fn->depth = after;
+        }
+        if(in.spLoaded || after < 0)
+        {
+            fn->flags |= F_OPEN;
+            after = (after < 0) ? 0 : after;
+        }
+
+        switch(in.kind)
+        {
+        case I_CALL:
+            Reach(f, funcAt[in.target], after + 2);
+            break;
+        case I_CALLI:
+            fn->flags |= F_OPEN;
+            break;
+        case I_RETI:
+            fn->flags |= F_ISR;
+            continue;
+        case I_RET:
+        case I_BAD:
+            continue;
+        case I_BRI:
+            if(after > branchOff)
+            {
+                branchOff = after;
+                swept = 0;
+            }
+            continue;
+        case I_JUMP:
+        case I_BR:
+            if(numWork < MAX_WORK)
+            {
+                work[numWork].pc = in.target;
+                work[numWork++].off = after;
+            }
+            continue;
+        case I_JCC:
+            if(numWork < MAX_WORK)
+            {
+                work[numWork].pc = in.target;
+                work[numWork++].off = after;
+            }
+            break;
+        case I_NEXT:
+            break;
+        }
+        if(numWork < MAX_WORK)
+        {
+            work[numWork].pc = w.pc + in.len;
+            work[numWork++].off = after;
+        }
+        else
+        {
+            fn->flags |= F_OPEN;
+        }
+    }
+
+    free(offAt);
+    free(work);
+    fn->flags = (fn->flags & ~F_BUSY) | F_DONE;
+    return fn->depth;
+}
+
+static void PrintPath(int f)
+{
+    printf("%s", funcs[f].name);
+    while(funcs[f].next >= 0 && funcs[f].next != f)
+    {
+        f = funcs[f].next;
+        printf(" > %s", funcs[f].name);
+    }
+    printf("\n");
+}
+
+static void Usage(void)
+{
+    fprintf(stderr,
+            "usage: ramreport [options] image.elf\n"
+            "  --csv          print name,addr,bytes,frame,depth,open lines\n");
+}
+
+int main(int argc, char ** argv)
+{
+    const char * path = NULL;
+    int csv = 0;
+    int mainFunc = -1;
+    int isr = -1;
+    int stack = 0;
+    int open = 0;
+    uint32_t used;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--csv") == 0)
+        {
+            csv = 1;
+        }
+        else if(argv[i][0] != '-' && path == NULL)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            Usage();
+            return 2;
+        }
+    }
+    if(path == NULL)
+    {
+        Usage();
+        return 2;
+    }
+    if(LoadElf(path) != 0)
+    {
+        return 1;
+    }
+
+    for(i = 0; i < numFuncs; i++)
+    {
+        Depth(i);
+    }
+    for(i = 0; i < numFuncs; i++)
+    {
+        if(strcmp(funcs[i].name, "main") == 0)
+        {
+            mainFunc = i;
+        }
+        if((funcs[i].flags & F_ISR) && (isr < 0 || funcs[i].depth > funcs[isr].depth))
+        {
+            isr = i;
+        }
+    }
+    if(mainFunc >= 0)
+    {
+        stack += 2 + funcs[mainFunc].depth;
+        open |= funcs[mainFunc].flags & F_OPEN;
+    }
+    if(isr >= 0)
+    {
+        stack += ISR_ENTRY + funcs[isr].depth;
+        open |= funcs[isr].flags & F_OPEN;
+    }
+    used = ramData + ramBss + stack;
+
+    if(csv)
+    {
+        for(i = 0; i < numFuncs; i++)
+        {
+            printf("%s,%u,%u,%d,%d,%d\n", funcs[i].name, funcs[i].addr, funcs[i].size,
+                   funcs[i].frame, funcs[i].depth, (funcs[i].flags & F_OPEN) != 0);
+        }
+        return used > RAM_SIZE;
+    }
+
+    printf("static RAM %lu bytes: initialized %lu, zeroed %lu\n",
+           (unsigned long)(ramData + ramBss), (unsigned long)ramData, (unsigned long)ramBss);
+    for(i = 0; i < numObjects && i < MAX_SHOWN; i++)
+    {
+        printf("  %-28s %5u  %s\n", objects[i].name, objects[i].size, objects[i].section);
+    }
+    if(mainFunc >= 0)
+    {
+        printf("stack from main %d%s bytes: ", 2 + funcs[mainFunc].depth,
+               (funcs[mainFunc].flags & F_OPEN) ? "+" : "");
+        PrintPath(mainFunc);
+    }
+    if(isr >= 0)
+    {
+        printf("deepest interrupt %d%s bytes: ", ISR_ENTRY + funcs[isr].depth,
+               (funcs[isr].flags & F_OPEN) ? "+" : "");
+        PrintPath(isr);
+    }
+    printf("worst case stack %d%s bytes", stack, open ? "+" : "");
+    if(ramReserved > 0)
+    {
+        printf(", the linker reserves %lu for stack and heap",
+               (unsigned long)ramReserved);
+    }
+    printf("\n");
+    if(used <= RAM_SIZE)
+    {
+        printf("free for buffers %lu of %d bytes\n", (unsigned long)(RAM_SIZE - used), RAM_SIZE);
+    }
+    else
+    {
+        printf("OVERFLOW: %lu bytes over the %d of RAM\n",
+               (unsigned long)(used - RAM_SIZE), RAM_SIZE);
+    }
+
+    printf("%-28s %6s %6s %6s %6s\n", "function", "addr", "bytes", "frame", "depth");
+    for(i = 0; i < numFuncs; i++)
+    {
+        printf("%-28s 0x%04x %6u %6d %5d%s\n", funcs[i].name, funcs[i].addr,
+               funcs[i].size, funcs[i].frame, funcs[i].depth,
+               (funcs[i].flags & F_OPEN) ? "+" : "");
+    }
+
+    free(funcs);
+    free(objects);
+    return used > RAM_SIZE;
+}
@@ -0,0 +1,618 @@
+/*
+ *  replay.c
+ *  Feed recorded accelerometer traces through the firmware estimator
+ *  (src/estimator) on a PC and compare the result with a double precision
+ *  reference and the measured ground truth distance. The samples take the
+ *  control loop's path: GravityProject onto the travel axis, AvgAddSample,
+ *  EstUpdate once per averaging period and NewDist every sample. Gravity
+ *  is measured over the first CAL_SAMPLES samples, where the robot stands
+ *  as it does at power on; leading 0,0,0 samples, from before the sensor
+ *  answered, are skipped.
+ *
+ *  Every trace runs with the accelerometer alone (EST_ACCEL). Traces with
+ *  encoder counts also run with the Kalman filter (EST_KALMAN), for its
+ *  error and cost, and traces with motor commands with the drive model
+ *  (EST_MODEL). The commands stand in for what main knows from its step
+ *  and speed controller: a stop command means BIAS_STOPPED (there is no
+ *  jolt flag in a trace), a drive command BIAS_STEADY once its offset has
+ *  stayed within one count for STEADY_WINDOWS periods as SpeedCtlSteady,
+ *  BIAS_DRIVING before. The leg starts, velocity and distance from 0, with
+ *  the first drive command. Without commands every period is BIAS_DRIVING
+ *  on a drive model at rest.
+ *
+ *  Trace formats:
+ *    csv - one sample per line, "x,y,z" raw counts, "x,y,z,enc" with the
+ *          wheel encoder count at that sample, or "x,y,z,enc,m1,m2" with
+ *          the motor command bytes in effect as well (hallsim --trace
+ *          writes these). Values may be the 12 bit register value
+ *          (0 - 4095) or already signed (-2048 - 2047). Lines starting with
+ *          '#' are comments, "# truth_m=<meters>" sets the ground truth for
+ *          that trace.
+ *    bin - consecutive little endian int16_t x,y,z triplets, same values as
+ *          the csv format. Selected with --bin or a ".bin" extension.
+ *
+ *  Usage: replay [--rate hz] [--truth m] [--bin] trace...
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - encoder counts and the Kalman filter
+ *             10/19/26 - the control loop's path: three axes through
+ *                        GravityProject and EstUpdate, motor commands and
+ *                        the drive model, no more --axis
+ */
+
+#include "estimator/estimator.h"
+#include "gravity/gravity.h"
+#include "mma8450q/mma8450q.h"
+#include "speedctl/speedctl.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define GRAVITY         9.80665     // m/s^2
+#define COUNTS_PER_G    ((double)ACCEL_COUNTS_PER_G)
+
+// size of one estimator distance unit in m, see config.h. The units are
+// defined by the sample period, here the trace's rather than TICK_HZ.
+#define DIST_UNIT(rate) (GRAVITY / COUNTS_PER_G * AVG_SAMPLES / ((rate) * (rate)))
+
+typedef struct
+{
+    int16_t * samples;      // raw x, y, z of each sample
+    int32_t * enc;          // encoder count at each sample, NULL if none
+    uint8_t * cmd;          // two motor command bytes each, NULL if none
+    size_t count;           // number of samples
+    double truth;           // ground truth distance in meters, <0 if unknown
+} Trace;
+
+typedef struct
+{
+    double firmware;        // firmware estimate converted to meters
+    double reference;       // double precision estimate in meters
+    double kalman;          // Kalman filter estimate in meters
+    double model;           // drive model estimate in meters
+    double nsPerSample;     // host time per sample
+    double tscPerSample;    // host cycles per sample, 0 if not available
+    double kalNsPerSample;  // host time per sample with the Kalman filter
+    unsigned long allocs;   // heap allocations made while estimating
+} Result;
+
+static unsigned long allocCount = 0;    // incremented by the malloc wrappers
+
+#ifdef REPLAY_WRAP_MALLOC
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t n, size_t size);
+void * __real_realloc(void * ptr, size_t size);
+
+void * __wrap_malloc(size_t size)
+{
+    allocCount++;
+    return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t n, size_t size)
+{
+    allocCount++;
+    return __real_calloc(n, size);
+}
+
+void * __wrap_realloc(void * ptr, size_t size)
+{
+    allocCount++;
+    return __real_realloc(ptr, size);
+}
+#endif
+
+static int Append(Trace * trace, size_t * cap, const int * xyz,
+                  const int32_t * enc, const int * cmd)
+//-------------------------------------------------------------------------
+// Func:  Append a sample to a trace, growing the buffers as needed
+// Args:  trace - trace to append to
+//        cap   - current capacity of the trace, in samples
+//        xyz   - raw x, y, z, signed or 12 bit
+//        enc   - encoder count, NULL if the trace has none
+//        cmd   - two motor command bytes, NULL if the trace has none
+// Retn:  0 on success, -1 if out of memory
+//-------------------------------------------------------------------------
+{
+    int i;
+
+    if(trace->count == *cap)
+    {
+        size_t newCap = (*cap == 0) ? 4096 : *cap * 2;
+        int16_t * p = realloc(trace->samples, newCap * 3 * sizeof(int16_t));
+        if(p == NULL)
+        {
+            return -1;
+        }
+        trace->samples = p;
+        if(enc != NULL)
+        {
+            int32_t * e = realloc(trace->enc, newCap * sizeof(int32_t));
+            if(e == NULL)
+            {
+                return -1;
+            }
+            trace->enc = e;
+        }
+        if(cmd != NULL)
+        {
+            uint8_t * c = realloc(trace->cmd, newCap * 2);
+            if(c == NULL)
+            {
+                return -1;
+            }
+            trace->cmd = c;
+        }
+        *cap = newCap;
+    }
+    if(enc != NULL)
+    {
+        trace->enc[trace->count] = *enc;
+    }
+    if(cmd != NULL)
+    {
+        trace->cmd[trace->count * 2] = (uint8_t)cmd[0];
+        trace->cmd[trace->count * 2 + 1] = (uint8_t)cmd[1];
+    }
+    for(i = 0; i < 3; i++)
+    {
+        trace->samples[trace->count * 3 + i] = xyz[i] & 0x0FFF; // back to
+    }                                                           // register form
+    trace->count++;
+    return 0;
+}
+
+static int LoadCsv(const char * path, Trace * trace)
+//-------------------------------------------------------------------------
+// Func:  Load a csv trace
+// Args:  path  - file to read
+//        trace - output trace
+// Retn:  0 on success, -1 on error
+//-------------------------------------------------------------------------
+{
+    FILE * f = fopen(path, "r");
+    if(f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    size_t cap = 0;
+    unsigned long lineNum = 0;
+    while(fgets(line, sizeof(line), f) != NULL)
+    {
+        lineNum++;
+        if(line[0] == '#')
+        {
+            const char * t = strstr(line, "truth_m=");
+            if(t != NULL)
+            {
+                trace->truth = atof(t + 8);
+            }
+            continue;
+        }
+
+        int v[3];
+        long e;
+        int c[2];
+        int n = sscanf(line, "%d , %d , %d , %ld , %d , %d",
+                       &v[0], &v[1], &v[2], &e, &c[0], &c[1]);
+        if(n < 3)
+        {
+            if(lineNum == 1)
+            {
+                continue;   // allow a header row
+            }
+            fprintf(stderr, "%s:%lu: expected x,y,z\n", path, lineNum);
+            fclose(f);
+            return -1;
+        }
+        if(n == 5 || (trace->count > 0 &&
+                      ((n >= 4) != (trace->enc != NULL) ||
+                       (n == 6) != (trace->cmd != NULL))))
+        {
+            fprintf(stderr, "%s:%lu: encoder or command columns on some "
+                    "lines only\n", path, lineNum);
+            fclose(f);
+            return -1;
+        }
+        int32_t enc = (int32_t)e;
+        if(Append(trace, &cap, v, n >= 4 ? &enc : NULL, n == 6 ? c : NULL) != 0)
+        {
+            fclose(f);
+            return -1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static int LoadBin(const char * path, Trace * trace)
+//-------------------------------------------------------------------------
+// Func:  Load a binary trace of little endian int16_t x,y,z triplets
+// Args:  path  - file to read
+//        trace - output trace
+// Retn:  0 on success, -1 on error
+//-------------------------------------------------------------------------
+{
+    FILE * f = fopen(path, "rb");
+    if(f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    uint8_t rec[6];
+    size_t cap = 0;
+    while(fread(rec, 1, sizeof(rec), f) == sizeof(rec))
+    {
+        int v[3];
+        int i;
+        for(i = 0; i < 3; i++)
+        {
+            v[i] = (int16_t)(rec[i * 2] | (rec[i * 2 + 1] << 8));
+        }
+        if(Append(trace, &cap, v, NULL, NULL) != 0)
+        {
+            fclose(f);
+            return -1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+static double NowNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static size_t Start(const Trace * trace, Gravity * grav)
+//-------------------------------------------------------------------------
+// Func:  Skip the samples from before the sensor answered and measure
+//        gravity over the next CAL_SAMPLES, as main does at power on
+// Args:  trace - samples to replay
+//        grav  - travel axis projection to set up
+// Retn:  first sample to replay, trace->count if the trace is too short
+//-------------------------------------------------------------------------
+{
+    const int16_t * s = trace->samples;
+    int32_t sums[3] = {0, 0, 0};
+    size_t first = 0;
+    size_t i;
+    int j;
+
+    while(first < trace->count &&
+          s[first * 3] == 0 && s[first * 3 + 1] == 0 && s[first * 3 + 2] == 0)
+    {
+        first++;
+    }
+    if(trace->count - first < CAL_SAMPLES)
+    {
+        return trace->count;
+    }
+    for(i = first; i < first + CAL_SAMPLES; i++)
+    {
+        for(j = 0; j < 3; j++)
+        {
+            sums[j] += SignExtend12(s[i * 3 + j]);
+        }
+    }
+    GravityInit(grav, sums, CAL_SHIFT);
+    return first;
+}
+
+static double Run(const Trace * trace, const Gravity * grav, size_t first,
+                  uint8_t mode)
+//-------------------------------------------------------------------------
+// Func:  Run a trace through the control loop's estimator
+// Args:  trace - samples to replay
+//        grav  - travel axis projection
+//        first - first sample, from Start
+//        mode  - EST_ACCEL, EST_MODEL or EST_KALMAN
+// Retn:  distance at the end, estimator units
+//-------------------------------------------------------------------------
+{
+    static const uint8_t stop[2] = {0, 0};
+    Estimator est;
+    int32_t model = 0;
+    uint8_t moving = 0;         // the last period had a drive command
+    uint8_t cmdRef = 0;         // SpeedCtlSteady's reference and count
+    uint8_t held = 0;
+    size_t i;
+
+    EstInit(&est, mode, trace->enc != NULL ? trace->enc[first] : 0);
+    for(i = first; i < trace->count; i++)
+    {
+        if(AvgAddSample(&est.avg, GravityProject(grav, &trace->samples[i * 3]), 0))
+        {
+            const uint8_t * sent = trace->cmd != NULL ? &trace->cmd[i * 2] : stop;
+            int32_t count = trace->enc != NULL ? trace->enc[i] : 0;
+            uint8_t driving = sent[0] != 0 || sent[1] != 0;
+            uint8_t biasMode = BIAS_DRIVING;
+
+            if(trace->cmd == NULL)
+            {
+                driving = 1;
+            }
+            else if(!driving)
+            {
+                biasMode = BIAS_STOPPED;
+                moving = 0;
+            }
+            else
+            {
+                uint8_t u = sent[0] > MOTOR1_STOP ? sent[0] - MOTOR1_STOP :
+                                                    MOTOR1_STOP - sent[0];
+                if(!moving)     // a leg starts here
+                {
+                    moving = 1;
+                    est.vel = 0;
+                    est.dist = 0;
+                    KalmanStart(&est.kal, count);
+                    cmdRef = 0;
+                    held = 0;
+                }
+                if(u + 1 >= cmdRef && u <= cmdRef + 1)
+                {
+                    if(held < 255)
+                    {
+                        held++;
+                    }
+                }
+                else
+                {
+                    cmdRef = u;
+                    held = 0;
+                }
+                biasMode = held >= STEADY_WINDOWS ? BIAS_STEADY : BIAS_DRIVING;
+            }
+            model = SpeedCtlModel(model, sent);
+            EstUpdate(&est, biasMode, count,
+                      sent[0] != 0 && sent[0] < MOTOR1_STOP ? -model : model,
+                      driving);
+        }
+        est.dist = NewDist(est.vel, est.dist, 0);
+    }
+    return est.dist;
+}
+
+static int Replay(const Trace * trace, double rate, Result * res)
+//-------------------------------------------------------------------------
+// Func:  Run a trace through the firmware estimator and the reference
+// Args:  trace - samples to replay
+//        rate  - sample rate of the trace in Hz
+//        res   - output results
+// Retn:  0 on success, -1 if the trace is too short to measure gravity
+//-------------------------------------------------------------------------
+{
+    Gravity grav;
+    size_t first = Start(trace, &grav);
+    size_t n = trace->count - first;
+    size_t i;
+
+    memset(res, 0, sizeof(*res));
+    if(n == 0)
+    {
+        return -1;
+    }
+
+    // firmware path with the accelerometer alone, timed
+    unsigned long allocStart = allocCount;
+    double start = NowNs();
+#ifdef HAVE_TSC
+    uint64_t tscStart = __rdtsc();
+#endif
+    int32_t dist = Run(trace, &grav, first, EST_ACCEL);
+#ifdef HAVE_TSC
+    uint64_t tscEnd = __rdtsc();
+    res->tscPerSample = (double)(tscEnd - tscStart) / n;
+#endif
+    double end = NowNs();
+    res->allocs = allocCount - allocStart;
+    res->nsPerSample = (end - start) / n;
+    res->firmware = dist * DIST_UNIT(rate);
+
+    // the same with the encoder correction, as main.c runs it by default
+    if(trace->enc != NULL)
+    {
+        start = NowNs();
+        dist = Run(trace, &grav, first, EST_KALMAN);
+        end = NowNs();
+        res->kalNsPerSample = (end - start) / n;
+        res->kalman = dist * DIST_UNIT(rate);
+    }
+    if(trace->cmd != NULL)
+    {
+        res->model = Run(trace, &grav, first, EST_MODEL) * DIST_UNIT(rate);
+    }
+
+    // reference, the projected samples at the true sample period,
+    // trapezoidal, over the whole trace
+    double dt = 1.0 / rate;
+    double v = 0;
+    double d = 0;
+    for(i = first; i < trace->count; i++)
+    {
+        double a = GravityProject(&grav, &trace->samples[i * 3]) *
+                   (GRAVITY / COUNTS_PER_G);
+        double vNext = v + a * dt;
+        d += (v + vNext) * 0.5 * dt;
+        v = vNext;
+    }
+    res->reference = d;
+    return 0;
+}
+
+static void Usage(void)
+{
+    fprintf(stderr,
+            "usage: replay [--rate hz] [--truth m] [--bin] trace...\n"
+            "  --rate   sample rate of the trace, default 300 (Timer A tick)\n"
+            "  --truth  ground truth distance in meters for traces without\n"
+            "           a '# truth_m=' line\n"
+            "  --bin    traces are binary int16 x,y,z triplets\n");
+}
+
+int main(int argc, char ** argv)
+{
+    double rate = 300.0;
+    double truth = -1.0;
+    int forceBin = 0;
+    int files = 0;
+    int failed = 0;
+    double sumAbsErr = 0;
+    double kalAbsErr = 0;
+    int withTruth = 0;
+    int withEnc = 0;
+    int i;
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+        {
+            rate = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--truth") == 0 && i + 1 < argc)
+        {
+            truth = atof(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--bin") == 0)
+        {
+            forceBin = 1;
+        }
+        else if(argv[i][0] == '-')
+        {
+            Usage();
+            return 2;
+        }
+    }
+    if(rate <= 0)
+    {
+        Usage();
+        return 2;
+    }
+
+    printf("%-24s %8s %10s %10s %10s %10s %10s %8s %8s %6s %10s %10s %8s "
+           "%10s %10s\n",
+           "trace", "samples", "truth_m", "fw_m", "ref_m", "fw_err", "ref_err",
+           "ns/smp", "cyc/smp", "allocs", "kf_m", "kf_err", "kf_ns",
+           "md_m", "md_err");
+
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--rate") == 0 || strcmp(argv[i], "--truth") == 0)
+        {
+            i++;
+            continue;
+        }
+        if(argv[i][0] == '-')
+        {
+            continue;
+        }
+
+        const char * path = argv[i];
+        size_t len = strlen(path);
+        int bin = forceBin || (len > 4 && strcmp(path + len - 4, ".bin") == 0);
+        Trace trace = {NULL, NULL, NULL, 0, truth};
+        Result res;
+
+        int err = (bin ? LoadBin(path, &trace) : LoadCsv(path, &trace));
+        if(err == 0 && Replay(&trace, rate, &res) != 0)
+        {
+            fprintf(stderr, "%s: fewer than %d samples to measure gravity\n",
+                    path, CAL_SAMPLES);
+            err = -1;
+        }
+        if(err != 0)
+        {
+            failed++;
+            free(trace.samples);
+            free(trace.enc);
+            free(trace.cmd);
+            continue;
+        }
+        files++;
+
+        printf("%-24s %8zu ", path, trace.count);
+        if(trace.truth >= 0)
+        {
+            printf("%10.3f %10.3f %10.3f %+10.3f %+10.3f",
+                   trace.truth, res.firmware, res.reference,
+                   res.firmware - trace.truth, res.reference - trace.truth);
+            sumAbsErr += (res.firmware > trace.truth) ?
+                         res.firmware - trace.truth : trace.truth - res.firmware;
+            withTruth++;
+        }
+        else
+        {
+            printf("%10s %10.3f %10.3f %10s %10s",
+                   "-", res.firmware, res.reference, "-", "-");
+        }
+        printf(" %8.1f %8.1f %6lu", res.nsPerSample, res.tscPerSample, res.allocs);
+        if(trace.enc == NULL)
+        {
+            printf(" %10s %10s %8s", "-", "-", "-");
+        }
+        else if(trace.truth >= 0)
+        {
+            printf(" %10.3f %+10.3f %8.1f", res.kalman, res.kalman - trace.truth,
+                   res.kalNsPerSample);
+            kalAbsErr += fabs(res.kalman - trace.truth);
+            withEnc++;
+        }
+        else
+        {
+            printf(" %10.3f %10s %8.1f", res.kalman, "-", res.kalNsPerSample);
+        }
+        if(trace.cmd == NULL)
+        {
+            printf(" %10s %10s\n", "-", "-");
+        }
+        else if(trace.truth >= 0)
+        {
+            printf(" %10.3f %+10.3f\n", res.model, res.model - trace.truth);
+        }
+        else
+        {
+            printf(" %10.3f %10s\n", res.model, "-");
+        }
+
+        free(trace.samples);
+        free(trace.enc);
+        free(trace.cmd);
+    }
+
+    if(files == 0 && failed == 0)
+    {
+        Usage();
+        return 2;
+    }
+
+    printf("\nestimator state: %zu bytes (Estimator), %zu of it the Kalman "
+           "filter\n", sizeof(Estimator), sizeof(Kalman));
+    if(withTruth > 0)
+    {
+        printf("mean |firmware error|: %.3f m over %d trace(s)\n",
+               sumAbsErr / withTruth, withTruth);
+    }
+    if(withEnc > 0)
+    {
+        printf("mean |Kalman error|: %.3f m over %d trace(s) with encoder counts\n",
+               kalAbsErr / withEnc, withEnc);
+    }
+
+    return failed ? 1 : 0;
+}
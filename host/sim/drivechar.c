@@ -0,0 +1,86 @@
+/*
+ *  drivechar.c
+ *  Drive characterization: for each forward motor command, start the drive
+ *  from rest, and record the steady speed and the time to reach 63% of it
+ *  (the drive time constant). This is the measurement profgen turns into
+ *  the firmware's profile tables. It runs against the rover model; the same
+ *  csv can be filled in from timed runs on the real robot instead.
+ *
+ *  Usage: drivechar [--vmax m/s] [--tau s] [--deadband f] > characterization.csv
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include "robot.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STEP        0.001       // s
+#define RUN_TIME    5.0         // s, long enough to settle
+#define MAX_CMD     63
+
+int main(int argc, char ** argv)
+{
+    RobotParams rp;
+    int cmd;
+    int i;
+
+    RobotDefaults(&rp);
+    for(i = 1; i + 1 < argc; i += 2)
+    {
+        if(strcmp(argv[i], "--vmax") == 0)          rp.vmax = atof(argv[i + 1]);
+        else if(strcmp(argv[i], "--tau") == 0)      rp.tau = atof(argv[i + 1]);
+        else if(strcmp(argv[i], "--deadband") == 0) rp.deadband = atof(argv[i + 1]);
+        else
+        {
+            break;
+        }
+    }
+    if(i < argc)
+    {
+        fprintf(stderr, "usage: drivechar [--vmax m/s] [--tau s] [--deadband f]\n");
+        return 2;
+    }
+    rp.vib = 0;
+
+    printf("# drive characterization, rover model vmax %.3f m/s tau %.3f s\n",
+           rp.vmax, rp.tau);
+    printf("command,speed_mm_s,tau_ms\n");
+    for(cmd = 0; cmd <= MAX_CMD; cmd++)
+    {
+        Robot r;
+        double t63 = 0;
+        double t;
+        double vFinal;
+        double v63;
+
+        RobotInit(&r, &rp, 1);
+        RobotCommand(&r, 64 + cmd);
+        RobotCommand(&r, 192 + cmd);
+        for(t = 0; t < RUN_TIME; t += STEP)
+        {
+            RobotStep(&r, STEP);
+        }
+        vFinal = r.vel;
+        v63 = vFinal * (1 - exp(-1));
+
+        // second run for the rise time, now that the final speed is known
+        RobotInit(&r, &rp, 1);
+        RobotCommand(&r, 64 + cmd);
+        RobotCommand(&r, 192 + cmd);
+        for(t = 0; t < RUN_TIME && v63 > 0; t += STEP)
+        {
+            RobotStep(&r, STEP);
+            if(r.vel >= v63)
+            {
+                t63 = t + STEP;
+                break;
+            }
+        }
+
+        printf("%d,%.0f,%.0f\n", cmd, vFinal * 1e3, t63 * 1e3);
+    }
+    return 0;
+}
@@ -0,0 +1,797 @@
+/*
+ *  hallsim.c
+ *  Closed loop simulation of a full shuttle run. The unmodified firmware
+ *  (main.c and the drivers, built against host/hal) drives the robot model
+ *  over the simulated UART, and reads the accelerometer model over the
+ *  simulated I2C bus. Reports where the robot came to rest against the
+ *  tolerances in the README: within 0.5 m of the finish line and within
+ *  1 m of the start line. With --nudge the run goes on: once the robot
+ *  has been back at the start for that long it is tapped, and has to set
+ *  off on the next shuttle. The wheel turns a quadrature encoder on Timer A's
+ *  capture inputs, its edges timed to the cycle, and the firmware's count
+ *  and speed are checked against it. --trace records the leg to the finish
+ *  line for replay: the sensor's x, y, z output, the wheel's encoder
+ *  count and the motor command bytes in effect at the tick rate, and where
+ *  the robot came to rest. The pack
+ *  voltage (--batt) sets the drive's speed and the level at the ADC10's
+ *  battery input. --sensors 2 puts a second accelerometer on the bus at
+ *  0x1D, with its own noise; the trace records the first. The sensors do
+ *  not answer on the bus for --sensor-boot after power on, and the boot
+ *  line reports when the firmware found them and sent its first drive
+ *  command, from its tick count. --hang takes the accelerometers off the
+ *  bus partway to the finish line, so the firmware hangs in an I2C wait,
+ *  and checks that the watchdog reset stops the robot. The duty table
+ *  shows the firmware's own account of its time awake and asleep in LPM1
+ *  and of its bus bytes for each step of the run, and checks the byte
+ *  totals against the simulated buses. --enc-dead stops the encoder
+ *  counting, and the firmware has to notice and stop on the drive model.
+ *
+ *  Usage: hallsim [options], see Usage() below
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - accelerometer interrupt pins on port 2
+ *             10/19/26 - finish line wait and dwell wake up latency
+ *             10/19/26 - standby and nudge to restart
+ *             10/19/26 - wheel encoder
+ *             10/19/26 - Kalman filter on or off, trace recording
+ *             10/19/26 - estimator choice
+ *             10/19/26 - battery voltage
+ *             10/19/26 - second accelerometer
+ *             10/19/26 - sensor power up time, boot metrics
+ *             10/19/26 - watchdog mode, bus hang
+ *             10/19/26 - duty cycle table
+ *             10/19/26 - LPM3 dwell and LPM4 standbys in the table
+ *             10/19/26 - dead encoder
+ *             10/19/26 - motor commands in the trace
+ *             10/19/26 - --hall moves the firmware's stops with the lines
+ */
+
+#include "msp430_sim.h"
+#include "config.h"
+#include "mma8450q_model.h"
+#include "mma8450q/mma8450q.h"
+#include "encoder/encoder.h"
+#include "estimator/estimator.h"
+#include "batt/batt.h"
+#include "wdog/wdog.h"
+#include "duty/duty.h"
+#include "robot.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define PHYS_STEP       250             // physics step, SMCLK cycles
+#define MOVING_SPEED    0.05            // m/s, robot counts as moving
+#define FWD_TOLERANCE   0.5             // m, from the README
+#define RET_TOLERANCE   1.0
+#define NUDGE_G         0.3             // tap on the chassis
+#define NUDGE_S         0.05
+#define HANG_WAIT       5.0             // s, to come to rest after a hang
+#define COUNT_M         (M_PI * WHEEL_DIA_MM * 1e-3 / ENC_COUNTS_REV)
+// estimator velocity units per m/s, see config.h
+#define VEL_PER_M_S     (1e6 * ACCEL_COUNTS_PER_G * TICK_HZ / \
+                         ((double)GRAVITY_UM_S2 * AVG_SAMPLES))
+
+// firmware entry point, main() renamed by the host build
+void FirmwareMain(void);
+
+// tuning globals in main.c
+extern int32_t fwdDist;
+extern int32_t revDist;
+extern int32_t cruiseVel;
+extern uint16_t dwellWake;
+extern int32_t odometer;
+extern int32_t wheelStopVel[2];
+extern uint8_t estMode;
+extern uint8_t battComp;
+extern uint8_t mmaCount;
+extern uint16_t bootTicks;
+extern uint16_t firstMotion;
+extern uint8_t encFault;
+extern uint8_t wdogMode;
+
+typedef enum
+{
+    LEG_START,      // calibrating, not moving yet
+    LEG_FWD,        // driving to the finish line
+    LEG_DWELL,      // stopped at the finish line
+    LEG_REV,        // backing up to the start line
+    LEG_STANDBY,    // back at the start, waiting for the nudge
+    LEG_DONE
+} Leg;
+
+typedef struct
+{
+    Robot robot;
+    MMAModel mma[MMA_MAX_DEVICES];  // at 0x1C and 0x1D
+    int sensors;            // accelerometers on the bus
+    uint64_t physNext;      // cycle count of the next physics step
+    double limit;           // give up after this many seconds
+    Leg leg;
+    double tMove;           // time the robot first moved
+    double stopCmdPos[2];   // position when each stop command was seen
+    double stopCmdVel[2];   // and speed
+    double restPos[2];      // position at rest after each leg
+    double restTime[2];
+    double tRev;            // time the robot backed off the finish line
+    double nudge;           // tap this long after the run, 0 for none
+    double tNudge;          // time of the tap
+    double tRestart;        // time the robot set off again
+    unsigned long irqMark;  // interrupt count a second before the tap
+    unsigned long idleIrqs; // interrupts in that second
+    double encPos;          // wheel position at the last encoder update, m
+    uint64_t encTime;       // and its cycle count
+    long encCount;          // encoder counts from the start line
+    double encDead;         // the encoder stops counting this long after
+                            // power on, negative for never
+    double tEncFault;       // time the firmware noticed, 0 until then
+    int32_t odoFwd;         // firmware's count at the finish line
+    int stopSeen;
+    FILE * trace;           // replay trace of the first leg, or NULL
+    uint8_t motor[2];       // command bytes in effect, for the trace
+    double traceNext;       // time of its next line
+    double hang;            // sensors lost this long into the forward
+                            // leg, 0 for never
+    double tHang;           // time they were lost
+    double hangPos;         // position and speed then
+    double hangVel;
+    double tReset;          // first watchdog reset after it, 0 for none
+    double tHangStop;       // first stop command after it, 0 for none
+    double hangRest;        // where the robot came to rest
+} Hall;
+
+static void UartTx(void * ctx, uint8_t data)
+{
+    Hall * h = ctx;
+    RobotCommand(&h->robot, data);
+    if(data == 0)
+    {
+        h->motor[0] = 0;
+        h->motor[1] = 0;
+    }
+    else
+    {
+        h->motor[data >= 128] = data;
+    }
+    if(data == 0 && h->tHang > 0 && h->tHangStop == 0)
+    {
+        h->tHangStop = h->robot.t;
+    }
+    if(data == 0 && (h->leg == LEG_FWD || h->leg == LEG_REV) && !h->stopSeen)
+    {
+        h->stopCmdPos[h->leg == LEG_REV] = h->robot.pos;
+        h->stopCmdVel[h->leg == LEG_REV] = h->robot.vel;
+        h->stopSeen = 1;
+    }
+}
+
+static void Hang(Hall * h)
+//-------------------------------------------------------------------------
+// Func:  Take the accelerometers off the bus --hang into the forward leg,
+//        then wait for the robot to come to rest
+//-------------------------------------------------------------------------
+{
+    Robot * r = &h->robot;
+    int i;
+
+    if(h->tHang == 0)
+    {
+        if(h->leg == LEG_FWD && r->t >= h->tMove + h->hang)
+        {
+            for(i = 0; i < h->sensors; i++)
+            {
+                SimDetachI2C(i ? MMA_ADDR_SA0_1 : MMA_ADDR_SA0_0);
+            }
+            h->tHang = r->t;
+            h->hangPos = r->pos;
+            h->hangVel = r->vel;
+        }
+        return;
+    }
+    if(h->tReset == 0 && SimGetStats()->wdtResets > 0)
+    {
+        h->tReset = r->t;
+    }
+    if(RobotStopCommanded(r) && r->vel == 0)
+    {
+        h->hangRest = r->pos;
+        SimExit(0);
+    }
+    if(r->t > h->tHang + HANG_WAIT)
+    {
+        h->hangRest = r->pos;
+        SimExit(1);
+    }
+}
+
+static void Mission(Hall * h)
+//-------------------------------------------------------------------------
+// Func:  Track which leg of the run the robot is on
+//-------------------------------------------------------------------------
+{
+    Robot * r = &h->robot;
+    int atRest = RobotStopCommanded(r) && r->vel == 0;
+
+    if(encFault && h->tEncFault == 0)
+    {
+        h->tEncFault = r->t;
+    }
+    if(h->hang > 0)
+    {
+        Hang(h);
+        if(h->tHang > 0)
+        {
+            return;         // the run ends there
+        }
+    }
+
+    switch(h->leg)
+    {
+        case LEG_START:
+            if(r->vel > MOVING_SPEED)
+            {
+                h->leg = LEG_FWD;
+                h->tMove = r->t;
+                h->stopSeen = 0;
+            }
+            break;
+        case LEG_FWD:
+            if(atRest)
+            {
+                h->restPos[0] = r->pos;
+                h->restTime[0] = r->t;
+                h->leg = LEG_DWELL;
+            }
+            break;
+        case LEG_DWELL:
+            if(r->vel == 0)
+            {
+                h->odoFwd = odometer;   // up to date while resting
+            }
+            if(r->vel < -MOVING_SPEED)
+            {
+                h->tRev = r->t;
+                h->leg = LEG_REV;
+                h->stopSeen = 0;
+            }
+            break;
+        case LEG_REV:
+            if(atRest)
+            {
+                h->restPos[1] = r->pos;
+                h->restTime[1] = r->t;
+                if(h->nudge <= 0)
+                {
+                    h->leg = LEG_DONE;
+                    SimExit(0);
+                }
+                h->leg = LEG_STANDBY;
+                h->irqMark = SimGetStats()->interrupts;
+            }
+            break;
+        case LEG_STANDBY:
+            if(r->vel > MOVING_SPEED)
+            {
+                h->tRestart = r->t;     // before the tap is a failure
+                h->leg = LEG_DONE;
+                SimExit(0);
+            }
+            if(h->tNudge == 0 && r->t < h->restTime[1] + h->nudge - 1)
+            {
+                h->irqMark = SimGetStats()->interrupts;
+            }
+            else if(h->tNudge == 0 && r->t >= h->restTime[1] + h->nudge)
+            {
+                h->idleIrqs = SimGetStats()->interrupts - h->irqMark;
+                h->tNudge = r->t;
+                RobotBump(r, NUDGE_G, NUDGE_S);
+            }
+            break;
+        default:
+            break;
+    }
+
+    if(r->t > h->limit)
+    {
+        SimExit(1);
+    }
+}
+
+static void Wheel(Hall * h, uint64_t cycles)
+//-------------------------------------------------------------------------
+// Func:  Encoder edges up to the given time, the wheel position taken from
+//        the last physics step at its speed and interpolated in between
+//-------------------------------------------------------------------------
+{
+    static const uint8_t gray[4] =
+        {0, ENC_A_P1, ENC_A_P1 | ENC_B_P1, ENC_B_P1};  // A leads forward
+    Robot * r = &h->robot;
+    double pos = r->pos + r->vel * ((double)cycles / SMCLK_HZ - r->t);
+    long target = (long)floor(pos / COUNT_M);
+
+    while(h->encCount != target && pos != h->encPos)
+    {
+        long next = h->encCount + (target > h->encCount ? 1 : -1);
+        double edge = (target > h->encCount ? next : h->encCount) * COUNT_M;
+        uint64_t t = h->encTime + (uint64_t)((cycles - h->encTime) *
+                                             (edge - h->encPos) / (pos - h->encPos));
+        h->encCount = next;
+        if(h->encDead < 0 || t < h->encDead * SMCLK_HZ)
+        {
+            SimSetInputsAt(1, ENC_A_P1 | ENC_B_P1, gray[next & 3], t);
+        }
+    }
+    h->encPos = pos;
+    h->encTime = cycles;
+}
+
+static void Trace(Hall * h)
+//-------------------------------------------------------------------------
+// Func:  Record the sensor output, encoder count and motor commands at the
+//        tick rate, in replay's csv format, until the robot rests at the
+//        finish line
+//-------------------------------------------------------------------------
+{
+    const uint8_t * regs = h->mma[0].regs;
+    int v[3];
+    int i;
+
+    if(h->leg > LEG_FWD)
+    {
+        fprintf(h->trace, "# truth_m=%.4f\n", h->restPos[0]);
+        fclose(h->trace);
+        h->trace = NULL;
+        return;
+    }
+    while(h->robot.t >= h->traceNext)
+    {
+        for(i = 0; i < 3; i++)
+        {
+            v[i] = regs[OUT_X_MSB + i * 2] << 4 | (regs[OUT_X_LSB + i * 2] & 0x0F);
+        }
+        fprintf(h->trace, "%d,%d,%d,%ld,%d,%d\n", v[0], v[1], v[2],
+                h->encCount, h->motor[0], h->motor[1]);
+        h->traceNext += 1.0 / TICK_HZ;
+    }
+}
+
+static void Advance(void * ctx, uint64_t cycles)
+//-------------------------------------------------------------------------
+// Func:  Run physics and accelerometer sampling up to the given time
+//-------------------------------------------------------------------------
+{
+    Hall * h = ctx;
+    uint8_t pins;
+    int i;
+    while(1)
+    {
+        MMAModel * mma = &h->mma[0];
+        uint64_t sample;
+        for(i = 1; i < h->sensors; i++)
+        {
+            if(h->mma[i].nextSample < mma->nextSample)
+            {
+                mma = &h->mma[i];
+            }
+        }
+        sample = mma->nextSample;
+        if(sample <= h->physNext && sample <= cycles)
+        {
+            double g[3];
+            uint32_t period = MMAModelPeriod(mma);
+            RobotSpecificForce(&h->robot, g);
+            MMAModelSample(mma, g);
+            mma->nextSample = period ? sample + period : UINT64_MAX;
+        }
+        else if(h->physNext <= cycles)
+        {
+            RobotStep(&h->robot, PHYS_STEP / (double)SMCLK_HZ);
+            Wheel(h, h->physNext);
+            h->physNext += PHYS_STEP;
+            Mission(h);
+            if(h->trace != NULL)
+            {
+                Trace(h);
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    Wheel(h, cycles);
+    pins = MMAModelIntPins(&h->mma[0]);    // the second one's are not wired
+    SimSetInputs(2, MMA_INT1_P2 | MMA_INT2_P2,
+                 ((pins & MMA_MODEL_INT1) ? MMA_INT1_P2 : 0) |
+                 ((pins & MMA_MODEL_INT2) ? MMA_INT2_P2 : 0));
+}
+
+static uint64_t NextInput(void * ctx)
+{
+    Hall * h = ctx;
+    return h->physNext;     // edges and interrupt pins change with physics
+}
+
+static int DutyReport(void)
+//-------------------------------------------------------------------------
+// Func:  Print the firmware's duty cycle accounts, boot first
+// Retn:  1 if the byte totals match the simulated buses and the dwell
+//        time the simulated LPM3 within 1 %, 0 if not. The run may end
+//        inside a transfer: the simulator counts I2C bytes as they move and
+//        the driver once the transfer is done (at most a 7 register read
+//        behind), the UART the other way round (one command).
+//-------------------------------------------------------------------------
+{
+    static const char * names[DUTY_PHASES] =
+        {"rest at start", "forward", "rest at finish", "reverse",
+         "rest at end", "boot"};
+    static const uint8_t order[DUTY_PHASES] = {DUTY_BOOT, 0, 1, 2, 3, 4};
+    const Duty * d = DutyTable();
+    const SimStats * st = SimGetStats();
+    double ms = 1e3 * (1 << DUTY_SHIFT) / SMCLK_HZ;     // per count
+    double active = 0;
+    double sleep = 0;
+    double lpm3 = 0;
+    unsigned long standbys = 0;
+    unsigned long i2c = 0;
+    unsigned long uart = 0;
+    int match;
+    int i;
+
+    printf("%-14s %9s %9s %9s %5s %7s %8s %7s\n", "phase", "awake_ms",
+           "lpm1_ms", "lpm3_ms", "lpm4", "awake%", "i2c_B", "uart_B");
+    for(i = 0; i < DUTY_PHASES; i++)
+    {
+        const Duty * p = &d[order[i]];
+        double total = (double)p->active + p->sleep + p->lpm3;
+        printf("%-14s %9.1f %9.1f %9.1f %5u %7.1f %8lu %7lu\n",
+               names[order[i]], p->active * ms, p->sleep * ms, p->lpm3 * ms,
+               p->standbys, total > 0 ? 100.0 * p->active / total : 0.0,
+               (unsigned long)p->i2cBytes, (unsigned long)p->uartBytes);
+        active += p->active;
+        sleep += p->sleep;
+        lpm3 += p->lpm3;
+        standbys += p->standbys;
+        i2c += p->i2cBytes;
+        uart += p->uartBytes;
+    }
+    printf("%-14s %9.1f %9.1f %9.1f %5lu %7.1f %8lu %7lu\n", "run",
+           active * ms, sleep * ms, lpm3 * ms, standbys,
+           active + sleep + lpm3 > 0 ?
+           100.0 * active / (active + sleep + lpm3) : 0.0, i2c, uart);
+    lpm3 *= ms * 1e-3 * SMCLK_HZ;                       // SMCLK cycles
+    printf("awake%% leaves out the LPM4 standbys, %.2f s in this run\n",
+           st->lpm4Cycles / (double)SMCLK_HZ);
+    match = st->i2cBytes >= i2c && st->i2cBytes - i2c <= 8 &&
+            uart >= st->uartBytes && uart - st->uartBytes <= 2 &&
+            fabs(st->lpm3Cycles - lpm3) <= 0.01 * lpm3;
+    printf("seen by the simulator: I2C %lu B, UART %lu B, LPM3 %.1f ms %s\n",
+           st->i2cBytes, st->uartBytes, st->lpm3Cycles * 1e3 / SMCLK_HZ,
+           match ? "(match)" : "MISMATCH");
+    return match;
+}
+
+static void Usage(void)
+{
+    fprintf(stderr,
+            "usage: hallsim [options]\n"
+            "  --hall m       distance between the lines, default 12. Moves the\n"
+            "                 firmware's stops by as much, unless --fwd-dist or\n"
+            "                 --rev-dist set them\n"
+            "  --seed n       noise seed, default 1\n"
+            "  --noise g      accelerometer noise, g rms, default 0.005\n"
+            "  --vib g        vibration noise at full speed, g rms, default 0.01\n"
+            "  --pitch g      floor pitch seen on x, g, default 0\n"
+            "  --pitch-sd g   random extra pitch drawn per seed, default 0\n"
+            "  --mount deg    sensor tilted nose up on the chassis, default 0\n"
+            "  --drift g/s    x bias drift, default 0\n"
+            "  --vmax m/s     speed at full command, default 1.5\n"
+            "  --tau s        drive time constant, default 0.4\n"
+            "  --brake s      stopping time constant, default 0.15\n"
+            "  --batt V       battery voltage, default 7.4 (nominal)\n"
+            "  --limit s      give up after this long, default 180\n"
+            "  --vlo hz       MCU VLO frequency, 4000 to 20000, default 12000\n"
+            "  --sensors n    accelerometers on the bus, 1 or 2, default 1\n"
+            "  --sensor-boot ms  accelerometer power up time, default 2\n"
+            "  --nudge s      tap the robot this long after the run (at least\n"
+            "                 1 s) and expect it to set off again, default off\n"
+            "  --hang s       take the accelerometers off the bus this long\n"
+            "                 into the forward leg and expect the watchdog to\n"
+            "                 stop the robot, default off\n"
+            "  --enc-dead s   the encoder stops counting this long after power\n"
+            "                 on, 0 for a dead one, and the firmware has to\n"
+            "                 notice, default off\n"
+            "firmware tuning, defaults from main.c:\n"
+            "  --fwd-dist mm  forward stopping distance (fwdDist)\n"
+            "  --rev-dist mm  reverse stopping distance (revDist)\n"
+            "  --cruise mm/s  cruise speed (cruiseVel)\n"
+            "  --est e        estimator (estMode): accel, the accelerometer\n"
+            "                 alone, model, with the drive model, or kalman,\n"
+            "                 with the wheel encoder (default)\n"
+            "  --no-batt-comp send the motor commands unscaled (battComp)\n"
+            "  --wdt w        watchdog (wdogMode): supervise, reset a stalled\n"
+            "                 loop (default), interval, time the battery\n"
+            "                 sampling instead, or off\n"
+            "  --trace file   record the leg to the finish line for replay\n"
+            "  --csv          print one machine readable line\n");
+}
+
+int main(int argc, char ** argv)
+{
+    static Hall h;
+    RobotParams rp;
+    double hall = FWD_STOP_MM / 1000.0;    // the firmware's own stop
+    int fwdSet = 0;
+    int revSet = 0;
+    double noise = 0.005;
+    double pitchSd = 0;
+    uint64_t seed = 1;
+    double vlo = 12000;
+    double sensorBoot = 2;
+    int csv = 0;
+    int i;
+
+    RobotDefaults(&rp);
+    memset(&h, 0, sizeof(h));
+    h.limit = 180;
+    h.sensors = 1;
+    h.encDead = -1;
+
+    for(i = 1; i < argc; i++)
+    {
+        const char * a = argv[i];
+        const char * v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if(strcmp(a, "--csv") == 0)
+        {
+            csv = 1;
+            continue;
+        }
+        if(strcmp(a, "--no-batt-comp") == 0)
+        {
+            battComp = 0;
+            continue;
+        }
+        if(v == NULL)
+        {
+            Usage();
+            return 2;
+        }
+        if(strcmp(a, "--hall") == 0)            hall = atof(v);
+        else if(strcmp(a, "--seed") == 0)       seed = strtoull(v, NULL, 0);
+        else if(strcmp(a, "--noise") == 0)      noise = atof(v);
+        else if(strcmp(a, "--vib") == 0)        rp.vib = atof(v);
+        else if(strcmp(a, "--pitch") == 0)      rp.pitch = atof(v);
+        else if(strcmp(a, "--drift") == 0)      rp.drift = atof(v);
+        else if(strcmp(a, "--vmax") == 0)       rp.vmax = atof(v);
+        else if(strcmp(a, "--tau") == 0)        rp.tau = atof(v);
+        else if(strcmp(a, "--brake") == 0)      rp.tauBrake = atof(v);
+        else if(strcmp(a, "--batt") == 0)       rp.batt = atof(v);
+        else if(strcmp(a, "--limit") == 0)      h.limit = atof(v);
+        else if(strcmp(a, "--vlo") == 0)        vlo = atof(v);
+        else if(strcmp(a, "--nudge") == 0)      h.nudge = atof(v);
+        else if(strcmp(a, "--hang") == 0)       h.hang = atof(v);
+        else if(strcmp(a, "--enc-dead") == 0)   h.encDead = atof(v);
+        else if(strcmp(a, "--sensors") == 0)    h.sensors = atoi(v);
+        else if(strcmp(a, "--sensor-boot") == 0) sensorBoot = atof(v);
+        else if(strcmp(a, "--pitch-sd") == 0)   pitchSd = atof(v);
+        else if(strcmp(a, "--mount") == 0)      rp.mount = atof(v) * M_PI / 180;
+        else if(strcmp(a, "--fwd-dist") == 0)
+        {
+            fwdDist = DIST_FROM_MM(atol(v));
+            fwdSet = 1;
+        }
+        else if(strcmp(a, "--rev-dist") == 0)
+        {
+            revDist = -DIST_FROM_MM(atol(v));
+            revSet = 1;
+        }
+        else if(strcmp(a, "--cruise") == 0)     cruiseVel = VEL_FROM_MM_S(atol(v));
+        else if(strcmp(a, "--est") == 0)
+        {
+            if(strcmp(v, "accel") == 0)         estMode = EST_ACCEL;
+            else if(strcmp(v, "model") == 0)    estMode = EST_MODEL;
+            else if(strcmp(v, "kalman") == 0)   estMode = EST_KALMAN;
+            else
+            {
+                Usage();
+                return 2;
+            }
+        }
+        else if(strcmp(a, "--wdt") == 0)
+        {
+            if(strcmp(v, "supervise") == 0)     wdogMode = WDOG_SUPERVISE;
+            else if(strcmp(v, "interval") == 0) wdogMode = WDOG_INTERVAL;
+            else if(strcmp(v, "off") == 0)      wdogMode = WDOG_OFF;
+            else
+            {
+                Usage();
+                return 2;
+            }
+        }
+        else if(strcmp(a, "--trace") == 0)
+        {
+            h.trace = fopen(v, "w");
+            if(h.trace == NULL)
+            {
+                perror(v);
+                return 2;
+            }
+            fprintf(h.trace, "# hallsim seed %llu\n", (unsigned long long)seed);
+        }
+        else
+        {
+            Usage();
+            return 2;
+        }
+        i++;
+    }
+    if(h.sensors < 1 || h.sensors > MMA_MAX_DEVICES ||
+       hall <= 0 || hall * 1000 >= HALL_MAX_MM)
+    {
+        Usage();
+        return 2;
+    }
+    // the hall is scored against its own lines, so the stops move with them
+    long moved = lround(hall * 1000) - FWD_STOP_MM;
+    if(!fwdSet)
+    {
+        fwdDist = DIST_FROM_MM(FWD_STOP_MM + moved);
+    }
+    if(!revSet)
+    {
+        revDist = -DIST_FROM_MM(REV_STOP_MM + moved);
+    }
+
+    {
+        SimI2CDevice dev;
+        SimWorld world = {Advance, UartTx, &h, NextInput};
+
+        SimRng rng;
+        RngSeed(&rng, ~seed);
+        rp.pitch += pitchSd * RngGauss(&rng);
+
+        SimReset();
+        SimSetVlo(vlo);
+        SimSetAnalog(3, rp.batt / BATT_DIVIDER);    // A3, through the divider
+        RobotInit(&h.robot, &rp, seed * 2 + 1);
+        for(i = 0; i < h.sensors; i++)
+        {
+            MMAModelInit(&h.mma[i], noise, seed * 2 + (uint64_t)i * 0x9E3779B9u);
+            MMAModelDevice(&h.mma[i], &dev);
+            dev.addr = i ? MMA_ADDR_SA0_1 : MMA_ADDR_SA0_0;
+            dev.readyAt = (uint64_t)(sensorBoot * 1e-3 * SMCLK_HZ);
+            SimAttachI2C(&dev);
+        }
+        SimSetWorld(&world);
+        h.physNext = PHYS_STEP;
+    }
+
+    int timedOut = SimRun(FirmwareMain);
+
+    if(h.hang > 0)
+    {
+        double stopMs = 1e3 * (h.tHangStop - h.tHang);
+        int pass = !timedOut && h.tHang > 0 && h.tReset > 0 && h.tHangStop > 0;
+        if(csv)
+        {
+            printf("%llu,%.1f,%.4f,%d\n", (unsigned long long)seed,
+                   pass ? stopMs : NAN, h.hangRest - h.hangPos, pass);
+        }
+        else if(h.tHang == 0)
+        {
+            printf("hang: the robot never got %.2f s into the forward leg FAIL\n",
+                   h.hang);
+        }
+        else
+        {
+            printf("hang: sensors off the bus at %.2f s, %.3f m at %.2f m/s\n",
+                   h.tHang, h.hangPos, h.hangVel);
+            printf("watchdog resets %lu, first %.0f ms after, stop command "
+                   "%.0f ms after, %s %.3f m on %s\n",
+                   SimGetStats()->wdtResets,
+                   h.tReset > 0 ? 1e3 * (h.tReset - h.tHang) : NAN,
+                   h.tHangStop > 0 ? stopMs : NAN,
+                   timedOut ? "still moving" : "at rest",
+                   h.hangRest - h.hangPos, pass ? "PASS" : "FAIL");
+        }
+        return pass ? 0 : 1;
+    }
+
+    double fwdErr = h.restPos[0] - hall;
+    double retErr = h.restPos[1];
+    double fwdCoast = h.restPos[0] - h.stopCmdPos[0];
+    double retCoast = h.restPos[1] - h.stopCmdPos[1];
+    double finish = h.restTime[1] - h.tMove;
+    int restarted = h.nudge <= 0 || h.tNudge > 0;
+    int encNoticed = h.encDead < 0 || estMode != EST_KALMAN || h.tEncFault > 0;
+    int pass = !timedOut && restarted && encNoticed &&
+               fabs(fwdErr) <= FWD_TOLERANCE && fabs(retErr) <= RET_TOLERANCE;
+
+    if(csv)
+    {
+        printf("%llu,%.4f,%.4f,%.3f,%.4f,%.4f,%d\n",
+               (unsigned long long)seed, timedOut ? NAN : fwdErr,
+               timedOut ? NAN : retErr, timedOut ? NAN : finish,
+               fwdCoast, retCoast, pass);
+        return pass ? 0 : 1;
+    }
+
+    if(timedOut)
+    {
+        printf("run did not finish within %.0f s (reached leg %d, at %.3f m)\n",
+               h.limit, (int)h.leg, h.robot.pos);
+        return 1;
+    }
+
+    printf("hallway %.2f m, seed %llu, noise %.4f g\n",
+           hall, (unsigned long long)seed, noise);
+    printf("%-14s %9s %9s %9s %9s %6s\n",
+           "leg", "rest_m", "error_m", "coast_m", "tol_m", "result");
+    printf("%-14s %9.3f %+9.3f %9.3f %9.2f %6s\n", "finish line",
+           h.restPos[0], fwdErr, fwdCoast, FWD_TOLERANCE,
+           fabs(fwdErr) <= FWD_TOLERANCE ? "PASS" : "FAIL");
+    printf("%-14s %9.3f %+9.3f %9.3f %9.2f %6s\n", "start line",
+           h.restPos[1], retErr, retCoast, RET_TOLERANCE,
+           fabs(retErr) <= RET_TOLERANCE ? "PASS" : "FAIL");
+    printf("brake time (coast / speed at stop): %.0f ms forward, %.0f ms reverse\n",
+           1e3 * fwdCoast / h.stopCmdVel[0], 1e3 * retCoast / h.stopCmdVel[1]);
+    printf("boot: sensors sampling at %.0f ms, first drive command at %.0f ms "
+           "(moving at %.0f ms)\n", bootTicks * 1e3 / TICK_HZ,
+           firstMotion * 1e3 / TICK_HZ, h.tMove * 1e3);
+    printf("time from first motion to finish: %.2f s\n", finish);
+    printf("wait at the finish line %.2f s, dwell wake up to first sample %u us\n",
+           h.tRev - h.restTime[0], dwellWake);
+    printf("accelerometers %u, samples %lu, motor commands %lu, simulated %.2f s\n",
+           mmaCount, h.mma[0].samples, h.robot.commands,
+           SimCycles() / (double)SMCLK_HZ);
+    printf("I2C bytes %lu, interrupts %lu, watchdog %s, %lu resets\n",
+           SimGetStats()->i2cBytes, SimGetStats()->interrupts,
+           wdogMode == WDOG_SUPERVISE ? "supervising" :
+           wdogMode == WDOG_INTERVAL ? "interval timer" : "off",
+           SimGetStats()->wdtResets);
+    printf("battery %.2f V, read %.2f V, %lu conversions, commands %s\n",
+           rp.batt, BattMv() * 1e-3, SimGetStats()->adcConversions,
+           battComp ? "scaled" : "unscaled");
+    printf("encoder: %ld counts (wheel %ld), %u errors, %.3f m out "
+           "(wheel %.3f), %.3f m net\n",
+           (long)EncoderDistance(), h.encCount, EncoderErrors(),
+           h.odoFwd * ENC_UM_PER_COUNT * 1e-6, h.restPos[0],
+           EncoderDistance() * ENC_UM_PER_COUNT * 1e-6);
+    printf("encoder speed at the stop commands: %.3f m/s forward (true %.3f), "
+           "%.3f m/s reverse (true %.3f)\n",
+           wheelStopVel[0] / VEL_PER_M_S, h.stopCmdVel[0],
+           wheelStopVel[1] / VEL_PER_M_S, h.stopCmdVel[1]);
+    if(h.encDead >= 0 && estMode == EST_KALMAN)
+    {
+        printf("encoder dead from %.2f s: ", h.encDead);
+        if(encNoticed)
+        {
+            printf("check failed at %.2f s, on the drive model from there\n",
+                   h.tEncFault);
+        }
+        else
+        {
+            printf("never noticed FAIL\n");
+        }
+    }
+    if(h.nudge > 0 && !restarted)
+    {
+        printf("standby: set off again %.2f s after the run, before the tap FAIL\n",
+               h.tRestart - h.restTime[1]);
+    }
+    else if(h.nudge > 0)
+    {
+        printf("standby: %lu interrupts in the second before the tap, "
+               "moving %.0f ms after it\n",
+               h.idleIrqs, 1e3 * (h.tRestart - h.tNudge));
+    }
+    pass &= DutyReport();
+
+    return pass ? 0 : 1;
+}
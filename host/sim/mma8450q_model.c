@@ -0,0 +1,407 @@
+/*
+ *  mma8450q_model.c
+ *  Register level model of the MMA8450Q accelerometer, see mma8450q_model.h.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - transient and motion engines, interrupt pins
+ *             10/19/26 - auto-sleep
+ */
+
+#include "mma8450q_model.h"
+#include "mma8450q/mma8450q.h"
+#include "config.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define THS_G       (1 / 16.0)      // threshold resolution
+
+static void UpdateSource(MMAModel * mma)
+//-------------------------------------------------------------------------
+// Func:  INT_SOURCE from the event flags
+//-------------------------------------------------------------------------
+{
+    uint8_t src = 0;
+    if(mma->regs[TRANSIENT_SRC] & TRANS_EA)
+    {
+        src |= INT_TRANS;
+    }
+    if(mma->regs[FF_MT_SRC_1] & FF_MT_EA)
+    {
+        src |= INT_FF_MT_1;
+    }
+    if(mma->regs[FF_MT_SRC_2] & FF_MT_EA)
+    {
+        src |= INT_FF_MT_2;
+    }
+    if(mma->regs[MMA_STATUS] & ZYXDR)
+    {
+        src |= INT_DRDY;
+    }
+    if(mma->aslpEvent)
+    {
+        src |= INT_ASLP;
+    }
+    mma->regs[INT_SOURCE] = src;
+}
+
+static int Debounce(uint8_t * count, int cond, uint8_t ths, uint8_t target)
+//-------------------------------------------------------------------------
+// Func:  Run an engine's debounce counter for one sample
+// Retn:  1 if the event is active
+//-------------------------------------------------------------------------
+{
+    if(cond)
+    {
+        if(*count < 255)
+        {
+            (*count)++;
+        }
+    }
+    else if(ths & DBCNTM)
+    {
+        *count = 0;
+    }
+    else if(*count > 0)
+    {
+        (*count)--;
+    }
+    return cond && *count >= target;
+}
+
+static void SetEvent(uint8_t * src, uint8_t flags, int active, int latch)
+//-------------------------------------------------------------------------
+// Func:  Update an engine's source register, flags include the EA bit
+//-------------------------------------------------------------------------
+{
+    if(active)
+    {
+        *src = latch ? (*src | flags) : flags;
+    }
+    else if(!latch)
+    {
+        *src = 0;
+    }
+}
+
+static int Transient(MMAModel * mma, const double v[3])
+//-------------------------------------------------------------------------
+// Func:  Transient engine, v is the output sample in g
+// Retn:  1 if the event is active on this sample
+//-------------------------------------------------------------------------
+{
+    uint8_t cfg = mma->regs[TRANSIENT_CFG];
+    uint8_t ths = mma->regs[TRANSIENT_THS];
+    double odr = SMCLK_HZ / (double)MMAModelPeriod(mma);
+    double fc = odr / 25 / (1 << (mma->regs[HP_FILTER_CUTOFF] & 0x03));
+    double alpha = 1 - exp(-2 * M_PI * fc / odr);
+    uint8_t flags = 0;
+    uint8_t i;
+
+    for(i = 0; i < 3; i++)
+    {
+        double hp;
+        if(!mma->hpReady)
+        {
+            mma->hpLow[i] = v[i];
+        }
+        hp = v[i] - mma->hpLow[i];
+        mma->hpLow[i] += alpha * hp;
+        if(cfg & TRANS_HPF_BYP)
+        {
+            hp = v[i];
+        }
+        if((cfg & (TRANS_XTEFE << i)) && fabs(hp) > (ths & THS_MASK) * THS_G)
+        {
+            flags |= (TRANS_XTE << (2 * i)) | ((hp < 0) ? TRANS_XTP << (2 * i) : 0);
+        }
+    }
+    mma->hpReady = 1;
+
+    if(cfg & (TRANS_XTEFE | TRANS_YTEFE | TRANS_ZTEFE))
+    {
+        int active = Debounce(&mma->transCount, flags != 0, ths,
+                              mma->regs[TRANSIENT_COUNT]);
+        SetEvent(&mma->regs[TRANSIENT_SRC], flags | TRANS_EA, active,
+                 cfg & TRANS_ELE);
+        return active;
+    }
+    return 0;
+}
+
+static int Motion(MMAModel * mma, uint8_t engine, const double v[3])
+//-------------------------------------------------------------------------
+// Func:  Freefall/motion engine 0 or 1, v is the output sample in g
+// Retn:  1 if the event is active on this sample
+//-------------------------------------------------------------------------
+{
+    uint8_t base = engine ? FF_MT_CGF_2 : FF_MT_CGF_1;
+    uint8_t cfg = mma->regs[base];
+    uint8_t ths = mma->regs[base + (FF_MT_THS_1 - FF_MT_CGF_1)];
+    uint8_t axes = cfg & (FF_MT_XEFE | FF_MT_YEFE | FF_MT_ZEFE);
+    uint8_t above = 0;
+    uint8_t flags = 0;
+    uint8_t i;
+    int cond;
+    int active;
+
+    if(axes == 0)
+    {
+        return 0;
+    }
+    for(i = 0; i < 3; i++)
+    {
+        if((axes & (FF_MT_XEFE << i)) && fabs(v[i]) > (ths & THS_MASK) * THS_G)
+        {
+            above |= FF_MT_XEFE << i;
+            flags |= (FF_MT_XHE << (2 * i)) | ((v[i] < 0) ? FF_MT_XHP << (2 * i) : 0);
+        }
+    }
+    // motion: any enabled axis above, freefall: all of them below
+    cond = (cfg & FF_MT_OAE) ? above != 0 : above == 0;
+    active = Debounce(&mma->ffmtCount[engine], cond, ths,
+                      mma->regs[base + (FF_MT_COUNT_1 - FF_MT_CGF_1)]);
+    SetEvent(&mma->regs[base + (FF_MT_SRC_1 - FF_MT_CGF_1)], flags | FF_MT_EA,
+             active, cfg & FF_MT_ELE);
+    return active;
+}
+
+static void AutoSleep(MMAModel * mma, uint8_t events)
+//-------------------------------------------------------------------------
+// Func:  Auto-sleep state after a sample
+// Args:  events - INT_ bits of the engines active on the sample
+//-------------------------------------------------------------------------
+{
+    // a wake source is enabled in CTRL_REG4 and CTRL_REG3, whose WAKE_ bits
+    // sit one above the matching INT_ bits
+    uint8_t wake = ((events & mma->regs[CTRL_REG4]) << 1) & mma->regs[CTRL_REG3];
+    uint64_t quiet = (uint64_t)mma->regs[ASLP_COUNT] * ASLP_COUNT_MS * (SMCLK_HZ / 1000);
+
+    if(!(mma->regs[CTRL_REG2] & SLPE))
+    {
+        mma->asleep = 0;
+        mma->quietSince = SimCycles();
+    }
+    else if(wake)
+    {
+        mma->quietSince = SimCycles();
+        if(mma->asleep)
+        {
+            mma->asleep = 0;
+            mma->aslpEvent = 1;
+        }
+    }
+    else if(!mma->asleep && SimCycles() - mma->quietSince >= quiet)
+    {
+        mma->asleep = 1;
+        mma->aslpEvent = 1;
+    }
+    mma->regs[SYSMOD] = mma->asleep ? SYSMOD_SLEEP : SYSMOD_WAKE;
+}
+
+
+static void Start(void * ctx, int read)
+{
+    MMAModel * mma = ctx;
+    if(!read)
+    {
+        mma->addrNext = 1;  // first byte of a write is the register address
+    }
+}
+
+static void Write(void * ctx, uint8_t data)
+{
+    MMAModel * mma = ctx;
+    if(mma->addrNext)
+    {
+        mma->ptr = data & 0x3F;
+        mma->addrNext = 0;
+        return;
+    }
+
+    switch(mma->ptr)
+    {
+        case MMA_STATUS:
+        case WHO_AM_I:
+        case SYSMOD:
+        case INT_SOURCE:
+        case TRANSIENT_SRC:
+        case FF_MT_SRC_1:
+        case FF_MT_SRC_2:
+            break;          // read only
+        case CTRL_REG1:
+        {
+            uint8_t wasActive = mma->regs[CTRL_REG1] & (FS1_BIT | FS0_BIT);
+            mma->regs[CTRL_REG1] = data;
+            if(!wasActive && (data & (FS1_BIT | FS0_BIT)))
+            {
+                // first sample one output period after going active
+                mma->nextSample = SimCycles() + MMAModelPeriod(mma);
+                mma->hpReady = 0;
+                mma->quietSince = SimCycles();
+            }
+            mma->regs[SYSMOD] = (data & (FS1_BIT | FS0_BIT)) ? SYSMOD_WAKE : SYSMOD_STANDBY;
+            mma->asleep = 0;
+            break;
+        }
+        default:
+            mma->regs[mma->ptr] = data;
+            break;
+    }
+    mma->ptr = (mma->ptr + 1) & 0x3F;
+}
+
+static uint8_t Read(void * ctx)
+{
+    MMAModel * mma = ctx;
+    uint8_t data = mma->regs[mma->ptr];
+    switch(mma->ptr)
+    {
+        case OUT_Z_MSB:
+            mma->regs[MMA_STATUS] &= ~(ZYXDR | ZDR | YDR | XDR);
+            break;
+        case SYSMOD:            // reading clears the sleep/wake interrupt
+            mma->aslpEvent = 0;
+            break;
+        case TRANSIENT_SRC:     // reading releases a latched event
+            if(mma->regs[TRANSIENT_CFG] & TRANS_ELE)
+            {
+                mma->regs[TRANSIENT_SRC] = 0;
+            }
+            break;
+        case FF_MT_SRC_1:
+        case FF_MT_SRC_2:
+            if(mma->regs[mma->ptr - (FF_MT_SRC_1 - FF_MT_CGF_1)] & FF_MT_ELE)
+            {
+                mma->regs[mma->ptr] = 0;
+            }
+            break;
+        default:
+            break;
+    }
+    UpdateSource(mma);
+    mma->ptr = (mma->ptr + 1) & 0x3F;
+    return data;
+}
+
+void MMAModelInit(MMAModel * mma, double noiseG, uint64_t seed)
+//-------------------------------------------------------------------------
+// Func:  Power on reset
+// Args:  mma    - model state
+//        noiseG - output noise in g rms
+//        seed   - noise generator seed
+//-------------------------------------------------------------------------
+{
+    memset(mma, 0, sizeof(*mma));
+    mma->regs[WHO_AM_I] = MMA_MODEL_WHO_AM_I;
+    mma->noise = noiseG;
+    mma->nextSample = UINT64_MAX;
+    RngSeed(&mma->rng, seed);
+}
+
+void MMAModelDevice(MMAModel * mma, SimI2CDevice * dev)
+//-------------------------------------------------------------------------
+// Func:  Fill in the I2C device description for SimAttachI2C
+//-------------------------------------------------------------------------
+{
+    dev->addr = MMA_MODEL_ADDR;
+    dev->readyAt = 0;
+    dev->start = Start;
+    dev->write = Write;
+    dev->read = Read;
+    dev->stop = NULL;
+    dev->ctx = mma;
+}
+
+uint32_t MMAModelPeriod(const MMAModel * mma)
+//-------------------------------------------------------------------------
+// Func:  Output data period for the current CTRL_REG1 setting
+// Retn:  period in SMCLK cycles, 0 in standby
+//-------------------------------------------------------------------------
+{
+    static const double rates[8] = {400, 200, 100, 50, 12.5, 1.5625, 1.5625, 1.5625};
+    static const double sleepRates[4] = {50, 25, 12.5, 1.5625};
+    uint8_t ctrl = mma->regs[CTRL_REG1];
+    if(!(ctrl & (FS1_BIT | FS0_BIT)))
+    {
+        return 0;
+    }
+    if(mma->asleep)
+    {
+        return (uint32_t)(SMCLK_HZ / sleepRates[ctrl >> 6]);
+    }
+    return (uint32_t)(SMCLK_HZ / rates[(ctrl >> 2) & 0x07]);
+}
+
+void MMAModelSample(MMAModel * mma, const double g[3])
+//-------------------------------------------------------------------------
+// Func:  Produce a new output sample
+// Args:  mma - model state
+//        g   - specific force on each axis in g
+//-------------------------------------------------------------------------
+{
+    static const double countsPerG[4] = {0, 1024, 512, 256};
+    static const uint8_t offReg[3] = {OFF_X, OFF_Y, OFF_Z};
+    double cpg = countsPerG[mma->regs[CTRL_REG1] & (FS1_BIT | FS0_BIT)];
+    double out[3];
+    uint8_t events;
+    uint8_t i;
+
+    if(cpg == 0)
+    {
+        return;
+    }
+
+    for(i = 0; i < 3; i++)
+    {
+        double v = g[i] + mma->noise * RngGauss(&mma->rng);
+        v += (int8_t)mma->regs[offReg[i]] / 256.0;
+        long counts = lround(v * cpg);
+        if(counts > 2047)
+        {
+            counts = 2047;
+        }
+        if(counts < -2048)
+        {
+            counts = -2048;
+        }
+        mma->regs[OUT_X_LSB + i * 2] = counts & 0x0F;
+        mma->regs[OUT_X_MSB + i * 2] = (counts >> 4) & 0xFF;
+        out[i] = counts / cpg;
+    }
+
+    mma->regs[MMA_STATUS] |= ZYXDR | ZDR | YDR | XDR;
+    events = Transient(mma, out) ? INT_TRANS : 0;
+    events |= Motion(mma, 0, out) ? INT_FF_MT_1 : 0;
+    events |= Motion(mma, 1, out) ? INT_FF_MT_2 : 0;
+    AutoSleep(mma, events);
+    UpdateSource(mma);
+    mma->samples++;
+}
+
+uint8_t MMAModelIntPins(const MMAModel * mma)
+//-------------------------------------------------------------------------
+// Func:  Levels of the interrupt pins. Enabled sources (CTRL_REG4) go to
+//        INT1 or INT2 by CTRL_REG5, active low unless IPOL is set.
+// Retn:  MMA_MODEL_INT1 and MMA_MODEL_INT2 set for pins that are high
+//-------------------------------------------------------------------------
+{
+    uint8_t active = mma->regs[INT_SOURCE] & mma->regs[CTRL_REG4];
+    uint8_t asserted = 0;
+    if(active & mma->regs[CTRL_REG5])
+    {
+        asserted |= MMA_MODEL_INT1;
+    }
+    if(active & ~mma->regs[CTRL_REG5])
+    {
+        asserted |= MMA_MODEL_INT2;
+    }
+    if(mma->regs[CTRL_REG3] & IPOL)
+    {
+        return asserted;
+    }
+    return asserted ^ (MMA_MODEL_INT1 | MMA_MODEL_INT2);
+}
@@ -0,0 +1,65 @@
+/*
+ *  mma8450q_model.h
+ *  Register level model of the MMA8450Q accelerometer on the simulated I2C
+ *  bus. Covers what the firmware uses: CTRL_REG1 mode, range and data rate,
+ *  12 bit XYZ output with STATUS data ready, OFF_X/Y/Z offsets and WHO_AM_I.
+ *
+ *  Output is quantized to the selected full scale range (1024, 512 or 256
+ *  counts/g) and clipped to 12 bits. The offset registers are taken to have
+ *  the 8g resolution, 1/256 g per count (AN3916). The firmware leaves
+ *  them at 0.
+ *
+ *  The transient and freefall/motion engines run on each output sample,
+ *  with their debounce counters, event latches and interrupt routing to the
+ *  INT1/INT2 pins (MMAModelIntPins). The transient high pass filter is first
+ *  order, cut off at ODR / 25 for SEL_0 and half that for each step up,
+ *  16 Hz to 2 Hz at 400 Hz.
+ *
+ *  Auto-sleep (CTRL_REG2 SLPE) drops to the ASLP_RATE after ASLP_COUNT of
+ *  samples without an event from a source enabled in both CTRL_REG3 and
+ *  CTRL_REG4, and such an event brings it back. SYSMOD follows, INT_ASLP
+ *  flags each change until SYSMOD is read.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - transient and motion engines, interrupt pins
+ *             10/19/26 - auto-sleep
+ *             10/19/26 - the firmware no longer writes the offsets
+ */
+
+#ifndef MMA8450Q_MODEL_H_
+#define MMA8450Q_MODEL_H_
+
+#include "msp430_sim.h"
+#include "sim_rng.h"
+#include <stdint.h>
+
+#define MMA_MODEL_ADDR      0x1C
+#define MMA_MODEL_WHO_AM_I  0xC6
+#define MMA_MODEL_INT1      0x01    // MMAModelIntPins bits
+#define MMA_MODEL_INT2      0x02
+
+typedef struct
+{
+    uint8_t regs[0x40];     // register file
+    uint8_t ptr;            // register address for next read/write
+    uint8_t addrNext;       // next written byte is the register address
+    double noise;           // output noise, g rms
+    SimRng rng;
+    uint64_t nextSample;    // cycle count of the next output sample
+    unsigned long samples;  // samples produced so far
+    double hpLow[3];        // transient filter, low pass part, g
+    uint8_t hpReady;        // hpLow holds a sample since going active
+    uint8_t transCount;     // debounce counters
+    uint8_t ffmtCount[2];
+    uint8_t asleep;         // auto-sleep at the ASLP_RATE
+    uint8_t aslpEvent;      // sleep/wake change not yet seen in SYSMOD
+    uint64_t quietSince;    // cycle count of the last wake source event
+} MMAModel;
+
+void MMAModelInit(MMAModel * mma, double noiseG, uint64_t seed);
+void MMAModelDevice(MMAModel * mma, SimI2CDevice * dev);
+uint32_t MMAModelPeriod(const MMAModel * mma);
+void MMAModelSample(MMAModel * mma, const double g[3]);
+uint8_t MMAModelIntPins(const MMAModel * mma);
+
+#endif
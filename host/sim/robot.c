@@ -0,0 +1,130 @@
+/*
+ *  robot.c
+ *  Model of the rover and Sabertooth motor controller, see robot.h.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - sensor mounting tilt
+ *             10/19/26 - bumps on the chassis
+ *             10/19/26 - battery voltage
+ */
+
+#include "robot.h"
+#include <math.h>
+#include <string.h>
+
+#define REST_SPEED  0.005   // m/s, below this a stopped drive holds still
+
+void RobotDefaults(RobotParams * p)
+//-------------------------------------------------------------------------
+// Func:  Rough figures for the 4WD1 rover on the LiPo pack
+//-------------------------------------------------------------------------
+{
+    p->vmax = 1.5;
+    p->tau = 0.4;
+    p->tauBrake = 0.15;
+    p->deadband = 0.05;
+    p->pitch = 0;
+    p->drift = 0;
+    p->vib = 0.01;
+    p->mount = 0;
+    p->batt = ROBOT_NOMINAL_V;
+}
+
+void RobotInit(Robot * robot, const RobotParams * p, uint64_t seed)
+{
+    memset(robot, 0, sizeof(*robot));
+    robot->p = *p;
+    RngSeed(&robot->rng, seed);
+}
+
+void RobotCommand(Robot * robot, uint8_t data)
+//-------------------------------------------------------------------------
+// Func:  Handle one byte of Sabertooth simplified serial
+//-------------------------------------------------------------------------
+{
+    if(data == 0)
+    {
+        robot->cmd[0] = 0;
+        robot->cmd[1] = 0;
+    }
+    else if(data < 128)
+    {
+        robot->cmd[0] = (data - 64) / 63.0;
+    }
+    else
+    {
+        robot->cmd[1] = (data - 192) / 63.0;
+    }
+    robot->commands++;
+}
+
+void RobotStep(Robot * robot, double dt)
+//-------------------------------------------------------------------------
+// Func:  Advance the drive by dt seconds. The Sabertooth's output is a
+//        duty cycle of the pack voltage, so full speed follows the pack
+//-------------------------------------------------------------------------
+{
+    double vOld = robot->vel;
+    double vmax = robot->p.vmax * robot->p.batt / ROBOT_NOMINAL_V;
+    uint8_t i;
+
+    for(i = 0; i < 2; i++)
+    {
+        double c = robot->cmd[i];
+        double target = (fabs(c) < robot->p.deadband) ? 0 : c * vmax;
+        double tau = (target == 0) ? robot->p.tauBrake : robot->p.tau;
+        robot->side[i] += (target - robot->side[i]) * (1 - exp(-dt / tau));
+        if(target == 0 && fabs(robot->side[i]) < REST_SPEED)
+        {
+            robot->side[i] = 0;
+        }
+    }
+
+    robot->vel = (robot->side[0] + robot->side[1]) / 2;
+    robot->acc = (robot->vel - vOld) / dt;
+    robot->pos += (robot->vel + vOld) / 2 * dt;
+    robot->t += dt;
+}
+
+void RobotSpecificForce(Robot * robot, double g[3])
+//-------------------------------------------------------------------------
+// Func:  What an accelerometer on the chassis would measure, in g. x points
+//        forward, z up
+//-------------------------------------------------------------------------
+{
+    double vib = robot->p.vib * fabs(robot->vel) / robot->p.vmax;
+    double x = robot->acc / GRAVITY + robot->p.pitch + robot->p.drift * robot->t;
+    double z = 1;
+
+    if(robot->t < robot->bumpEnd)
+    {
+        x += robot->bump;
+    }
+    // chassis frame to the tilted sensor
+    g[0] = x * cos(robot->p.mount) + z * sin(robot->p.mount);
+    g[1] = 0;
+    g[2] = z * cos(robot->p.mount) - x * sin(robot->p.mount);
+    if(vib > 0)
+    {
+        uint8_t i;
+        for(i = 0; i < 3; i++)
+        {
+            g[i] += vib * RngGauss(&robot->rng);
+        }
+    }
+}
+
+int RobotStopCommanded(const Robot * robot)
+{
+    return (robot->cmd[0] == 0 && robot->cmd[1] == 0);
+}
+
+void RobotBump(Robot * robot, double g, double s)
+//-------------------------------------------------------------------------
+// Func:  Tap the chassis: the accelerometer feels g along x for s seconds,
+//        too short and light to move the robot
+//-------------------------------------------------------------------------
+{
+    robot->bump = g;
+    robot->bumpEnd = robot->t + s;
+}
@@ -0,0 +1,60 @@
+/*
+ *  robot.h
+ *  Model of the rover driven by the Sabertooth 2x10 in simplified serial
+ *  mode: one byte per motor, 1-127 for motor 1 and 128-255 for motor 2 with
+ *  64/192 as stop, 0 stops both. Each side follows its command with a first
+ *  order lag, the chassis moves at the average of the two sides along a
+ *  straight hallway.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - sensor mounting tilt
+ *             10/19/26 - bumps on the chassis
+ *             10/19/26 - battery voltage
+ */
+
+#ifndef ROBOT_H_
+#define ROBOT_H_
+
+#include "sim_rng.h"
+#include <stdint.h>
+
+#define GRAVITY 9.80665     // m/s^2
+#define ROBOT_NOMINAL_V 7.4 // pack voltage vmax is given at
+
+typedef struct
+{
+    double vmax;        // speed at full command, m/s
+    double tau;         // drive time constant, s
+    double tauBrake;    // time constant with motors stopped, s
+    double deadband;    // fraction of full command that does not move
+    double pitch;       // constant x axis gravity component, g
+    double drift;       // x axis bias drift, g/s
+    double vib;         // vibration noise on x at vmax, g rms
+    double mount;       // sensor tilted nose up on the chassis, rad
+    double batt;        // pack voltage, V
+} RobotParams;
+
+typedef struct
+{
+    RobotParams p;
+    double cmd[2];      // motor commands, -1 to 1
+    double side[2];     // side speeds, m/s
+    double pos;         // distance from start line, m
+    double vel;         // m/s
+    double acc;         // m/s^2
+    double t;           // s
+    double bump;        // jolt on x from outside, g, does not move the robot
+    double bumpEnd;     // until this time
+    SimRng rng;
+    unsigned long commands;
+} Robot;
+
+void RobotDefaults(RobotParams * p);
+void RobotInit(Robot * robot, const RobotParams * p, uint64_t seed);
+void RobotCommand(Robot * robot, uint8_t data);
+void RobotStep(Robot * robot, double dt);
+void RobotSpecificForce(Robot * robot, double g[3]);
+int RobotStopCommanded(const Robot * robot);
+void RobotBump(Robot * robot, double g, double s);
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ *  sim_rng.h
+ *  Small seeded random number generator for the host simulations, so runs
+ *  are repeatable and independent of the C library.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#ifndef SIM_RNG_H_
+#define SIM_RNG_H_
+
+#include <math.h>
+#include <stdint.h>
+
+typedef struct
+{
+    uint64_t s;
+} SimRng;
+
+static inline void RngSeed(SimRng * rng, uint64_t seed)
+{
+    rng->s = seed * 0x9E3779B97F4A7C15ull + 1;
+}
+
+static inline uint64_t RngNext(SimRng * rng)
+{
+    // splitmix64
+    uint64_t z = (rng->s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline double RngUniform(SimRng * rng)
+{
+    return (RngNext(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline double RngGauss(SimRng * rng)
+{
+    // Box-Muller, one value per call is plenty fast here
+    double u = RngUniform(rng);
+    double v = RngUniform(rng);
+    if(u < 1e-300)
+    {
+        u = 1e-300;
+    }
+    return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+}
+
+#endif
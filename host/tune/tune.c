@@ -0,0 +1,467 @@
+/*
+ *  tune.c
+ *  Parameter sweep for the tuned constants in main.c (fwdDist and revDist
+ *  in mm, and the cruise speed in mm/s). Every combination in the
+ *  requested ranges is run through hallsim a number of times with different
+ *  noise seeds, spread over all cores, and the configurations are ranked by
+ *  their stop error distribution and time to finish.
+ *
+ *  Each simulation is a separate hallsim process, since the firmware keeps
+ *  its state in globals and statics.
+ *
+ *  Usage: tune [options] [-- hallsim options], see Usage() below
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "config.h"
+
+#define FWD_TOLERANCE   0.5     // m, from the README
+#define RET_TOLERANCE   1.0
+#define MAX_SIM_ARGS    64
+
+extern char ** environ;
+
+typedef enum
+{
+    P_FWD_DIST,
+    P_REV_DIST,
+    P_CRUISE,
+    NUM_PARAMS
+} Param;
+
+static const char * const paramFlag[NUM_PARAMS] =
+{
+    "--fwd-dist", "--rev-dist", "--cruise"
+};
+
+static const char * const paramName[NUM_PARAMS] =
+{
+    "fwdDist", "revDist", "cruise"
+};
+
+typedef struct
+{
+    long start;
+    long stop;
+    long step;
+} Range;
+
+typedef struct
+{
+    double fwdErr;          // NAN if the run did not finish
+    double retErr;
+    double finish;
+} RunResult;
+
+typedef struct
+{
+    long value[NUM_PARAMS];
+    double passRate;
+    double fwdMean, fwdP90;     // of |error|
+    double retMean, retP90;
+    double finishMean;
+    double score;               // worst p90 error relative to tolerance
+    int timeouts;
+} ConfigStats;
+
+static Range ranges[NUM_PARAMS] =
+{
+    {FWD_STOP_MM, FWD_STOP_MM, 1},
+    {REV_STOP_MM, REV_STOP_MM, 1},
+    {CRUISE_MM_S, CRUISE_MM_S, 1}
+};
+
+static const char * simPath;
+static char * extraArgs[MAX_SIM_ARGS];
+static int extraCount;
+static int runs = 20;
+static long numConfigs;
+static RunResult * results;     // numConfigs * runs
+static long nextJob;
+static pthread_mutex_t jobLock = PTHREAD_MUTEX_INITIALIZER;
+
+static int ParseRange(const char * s, Range * r)
+//-------------------------------------------------------------------------
+// Func:  Parse "value", "start:stop" or "start:stop:step"
+//-------------------------------------------------------------------------
+{
+    char * end;
+    r->start = strtol(s, &end, 0);
+    r->stop = r->start;
+    r->step = 1;
+    if(*end == ':')
+    {
+        r->stop = strtol(end + 1, &end, 0);
+        if(*end == ':')
+        {
+            r->step = strtol(end + 1, &end, 0);
+        }
+    }
+    if(*end != '\0' || r->step <= 0 || r->stop < r->start)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static long RangeCount(const Range * r)
+{
+    return (r->stop - r->start) / r->step + 1;
+}
+
+static void ConfigValues(long config, long value[NUM_PARAMS])
+//-------------------------------------------------------------------------
+// Func:  Decode a configuration index into parameter values
+//-------------------------------------------------------------------------
+{
+    int p;
+    for(p = 0; p < NUM_PARAMS; p++)
+    {
+        long n = RangeCount(&ranges[p]);
+        value[p] = ranges[p].start + (config % n) * ranges[p].step;
+        config /= n;
+    }
+}
+
+static int RunSim(long config, int seed, RunResult * res)
+//-------------------------------------------------------------------------
+// Func:  Run one hallsim process and parse its csv line
+// Retn:  0 on success, -1 if the simulator could not be run
+//-------------------------------------------------------------------------
+{
+    char values[NUM_PARAMS][24];
+    char seedStr[16];
+    char * argv[MAX_SIM_ARGS + 2 * NUM_PARAMS + 8];
+    long value[NUM_PARAMS];
+    int argc = 0;
+    int p;
+    int fds[2];
+    pid_t pid;
+    posix_spawn_file_actions_t fa;
+
+    ConfigValues(config, value);
+    argv[argc++] = (char *)simPath;
+    argv[argc++] = "--csv";
+    snprintf(seedStr, sizeof(seedStr), "%d", seed);
+    argv[argc++] = "--seed";
+    argv[argc++] = seedStr;
+    for(p = 0; p < NUM_PARAMS; p++)
+    {
+        snprintf(values[p], sizeof(values[p]), "%ld", value[p]);
+        argv[argc++] = (char *)paramFlag[p];
+        argv[argc++] = values[p];
+    }
+    for(p = 0; p < extraCount; p++)
+    {
+        argv[argc++] = extraArgs[p];
+    }
+    argv[argc] = NULL;
+
+    if(pipe(fds) != 0)
+    {
+        return -1;
+    }
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&fa, fds[0]);
+    posix_spawn_file_actions_addclose(&fa, fds[1]);
+    int err = posix_spawn(&pid, simPath, &fa, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    close(fds[1]);
+    if(err != 0)
+    {
+        close(fds[0]);
+        errno = err;
+        return -1;
+    }
+
+    char line[256];
+    size_t len = 0;
+    ssize_t n;
+    while(len < sizeof(line) - 1 &&
+          (n = read(fds[0], line + len, sizeof(line) - 1 - len)) > 0)
+    {
+        len += n;
+    }
+    line[len] = '\0';
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+
+    double fwdCoast, retCoast;
+    int s, pass;
+    if(sscanf(line, "%d,%lf,%lf,%lf,%lf,%lf,%d", &s, &res->fwdErr, &res->retErr,
+              &res->finish, &fwdCoast, &retCoast, &pass) != 7)
+    {
+        res->fwdErr = NAN;
+        res->retErr = NAN;
+        res->finish = NAN;
+    }
+    return 0;
+}
+
+static void * Worker(void * arg)
+{
+    long total = numConfigs * runs;
+    (void)arg;
+    while(1)
+    {
+        pthread_mutex_lock(&jobLock);
+        long job = nextJob++;
+        pthread_mutex_unlock(&jobLock);
+        if(job >= total)
+        {
+            break;
+        }
+
+        long config = job / runs;
+        int seed = (int)(job % runs) + 1;
+        if(RunSim(config, seed, &results[job]) != 0)
+        {
+            perror(simPath);
+            exit(1);
+        }
+
+        if(job % 200 == 199)
+        {
+            fprintf(stderr, "\r%ld / %ld runs", job + 1, total);
+        }
+    }
+    return NULL;
+}
+
+static int CompareDouble(const void * a, const void * b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double P90(double * v, int n)
+{
+    if(n == 0)
+    {
+        return INFINITY;
+    }
+    qsort(v, n, sizeof(double), CompareDouble);
+    return v[(n * 9 + 9) / 10 - 1];
+}
+
+static void Summarize(long config, ConfigStats * st)
+//-------------------------------------------------------------------------
+// Func:  Reduce the runs of one configuration to its ranking statistics
+//-------------------------------------------------------------------------
+{
+    double fwd[runs];
+    double ret[runs];
+    int done = 0;
+    int pass = 0;
+    int i;
+
+    ConfigValues(config, st->value);
+    st->fwdMean = st->retMean = st->finishMean = 0;
+    for(i = 0; i < runs; i++)
+    {
+        const RunResult * r = &results[config * runs + i];
+        if(isnan(r->fwdErr) || isnan(r->retErr))
+        {
+            continue;
+        }
+        fwd[done] = fabs(r->fwdErr);
+        ret[done] = fabs(r->retErr);
+        st->fwdMean += fwd[done];
+        st->retMean += ret[done];
+        st->finishMean += r->finish;
+        if(fwd[done] <= FWD_TOLERANCE && ret[done] <= RET_TOLERANCE)
+        {
+            pass++;
+        }
+        done++;
+    }
+
+    st->timeouts = runs - done;
+    st->passRate = (double)pass / runs;
+    if(done > 0)
+    {
+        st->fwdMean /= done;
+        st->retMean /= done;
+        st->finishMean /= done;
+    }
+    st->fwdP90 = P90(fwd, done);
+    st->retP90 = P90(ret, done);
+    st->score = fmax(st->fwdP90 / FWD_TOLERANCE, st->retP90 / RET_TOLERANCE);
+    if(st->timeouts > 0)
+    {
+        st->score = INFINITY;
+    }
+}
+
+static int CompareStats(const void * a, const void * b)
+//-------------------------------------------------------------------------
+// Func:  Rank by pass rate, then tail error, then time to finish
+//-------------------------------------------------------------------------
+{
+    const ConfigStats * x = a;
+    const ConfigStats * y = b;
+    if(x->passRate != y->passRate)
+    {
+        return (x->passRate < y->passRate) ? 1 : -1;
+    }
+    if(x->score != y->score)
+    {
+        return (x->score > y->score) ? 1 : -1;
+    }
+    return CompareDouble(&x->finishMean, &y->finishMean);
+}
+
+static void Usage(void)
+{
+    fprintf(stderr,
+            "usage: tune [options] [-- hallsim options]\n"
+            "ranges are value, start:stop or start:stop:step\n"
+            "  --fwd-dist r    forward stopping distance, mm, default FWD_STOP_MM\n"
+            "  --rev-dist r    reverse stopping distance, mm, default REV_STOP_MM\n"
+            "  --cruise r      cruise speed, mm/s, default CRUISE_MM_S\n"
+            "  --runs n        noise seeds per configuration, default 20\n"
+            "  --jobs n        worker threads, default all cores\n"
+            "  --top n         configurations to list, default 10\n"
+            "  --sim path      hallsim executable, default next to tune\n");
+}
+
+int main(int argc, char ** argv)
+{
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    long top = 10;
+    char defaultSim[PATH_MAX];
+    int i, p;
+
+    for(i = 1; i < argc; i++)
+    {
+        const char * a = argv[i];
+        if(strcmp(a, "--") == 0)
+        {
+            for(i++; i < argc && extraCount < MAX_SIM_ARGS; i++)
+            {
+                extraArgs[extraCount++] = argv[i];
+            }
+            break;
+        }
+        if(i + 1 >= argc)
+        {
+            Usage();
+            return 2;
+        }
+        const char * v = argv[++i];
+
+        for(p = 0; p < NUM_PARAMS; p++)
+        {
+            if(strcmp(a, paramFlag[p]) == 0)
+            {
+                break;
+            }
+        }
+        if(p < NUM_PARAMS)
+        {
+            if(ParseRange(v, &ranges[p]) != 0)
+            {
+                fprintf(stderr, "bad range for %s: %s\n", a, v);
+                return 2;
+            }
+        }
+        else if(strcmp(a, "--runs") == 0)   runs = atoi(v);
+        else if(strcmp(a, "--jobs") == 0)   jobs = atol(v);
+        else if(strcmp(a, "--top") == 0)    top = atol(v);
+        else if(strcmp(a, "--sim") == 0)    simPath = v;
+        else
+        {
+            Usage();
+            return 2;
+        }
+    }
+    if(runs < 1 || jobs < 1)
+    {
+        Usage();
+        return 2;
+    }
+
+    if(simPath == NULL)
+    {
+        ssize_t n = readlink("/proc/self/exe", defaultSim, sizeof(defaultSim) - 16);
+        char * slash;
+        if(n <= 0)
+        {
+            fprintf(stderr, "cannot locate hallsim, use --sim\n");
+            return 2;
+        }
+        defaultSim[n] = '\0';
+        slash = strrchr(defaultSim, '/');
+        strcpy(slash ? slash + 1 : defaultSim, "hallsim");
+        simPath = defaultSim;
+    }
+
+    numConfigs = 1;
+    for(p = 0; p < NUM_PARAMS; p++)
+    {
+        numConfigs *= RangeCount(&ranges[p]);
+    }
+    results = calloc(numConfigs * runs, sizeof(RunResult));
+    ConfigStats * stats = calloc(numConfigs, sizeof(ConfigStats));
+    pthread_t * threads = calloc(jobs, sizeof(pthread_t));
+    if(results == NULL || stats == NULL || threads == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    fprintf(stderr, "%ld configurations x %d runs on %ld threads\n",
+            numConfigs, runs, jobs);
+    for(i = 0; i < jobs; i++)
+    {
+        pthread_create(&threads[i], NULL, Worker, NULL);
+    }
+    for(i = 0; i < jobs; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    fprintf(stderr, "\n");
+
+    long c;
+    for(c = 0; c < numConfigs; c++)
+    {
+        Summarize(c, &stats[c]);
+    }
+    qsort(stats, numConfigs, sizeof(ConfigStats), CompareStats);
+
+    for(p = 0; p < NUM_PARAMS; p++)
+    {
+        printf("%10s ", paramName[p]);
+    }
+    printf("%6s %8s %8s %8s %8s %8s %5s\n",
+           "pass", "fwd_avg", "fwd_p90", "ret_avg", "ret_p90", "finish", "t/o");
+    for(c = 0; c < numConfigs && c < top; c++)
+    {
+        const ConfigStats * st = &stats[c];
+        for(p = 0; p < NUM_PARAMS; p++)
+        {
+            printf("%10ld ", st->value[p]);
+        }
+        printf("%5.0f%% %8.3f %8.3f %8.3f %8.3f %8.2f %5d\n",
+               st->passRate * 100, st->fwdMean, st->fwdP90, st->retMean,
+               st->retP90, st->finishMean, st->timeouts);
+    }
+
+    free(threads);
+    free(stats);
+    free(results);
+    return 0;
+}
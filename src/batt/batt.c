@@ -0,0 +1,177 @@
+/*
+ *  batt.c
+ *  Battery voltage, see batt.h.
+ *
+ *  The ADC10 repeats single conversions of A3, one per rising edge of
+ *  Timer A OUT0 (SHS_2, CONSEQ_2) or per ADC10SC (SHS_0), and the data
+ *  transfer controller
+ *  writes them to a block of BATT_SAMPLES words. It starts over at the
+ *  top of the block by itself (ADC10CT), and sets ADC10IFG once per block.
+ *  The interrupt only adds the block up; the filter and the one division
+ *  for the scale run in the loop, and only after a new block.
+ *
+ *  The Sabertooth drives the motors at a duty cycle of the battery, so
+ *  speed is proportional to command times pack voltage. Scaling the
+ *  command offset by BATT_NOMINAL_MV over the voltage keeps the speeds of
+ *  the drive characterization as the pack runs down.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - BattMv multiplies with shifts and adds
+ *             10/19/26 - conversions started by BattConvert
+ */
+
+#include "batt.h"
+#include "../hal/hal.h"
+#include "../fixmath/fixmath.h"
+#include "stdint.h"
+
+CONFIG_ASSERT(batt_mv_const, 2500L * BATT_DIVIDER < 65536L);
+
+#define BATT_A3     0x08        // ADC10AE0 bit of A3, P2.3
+
+static volatile uint16_t samples[BATT_SAMPLES];     // written by the DTC
+static volatile uint16_t blockSum;  // sum of the last block
+static volatile uint8_t fresh;      // a block came in since BattScale
+static uint16_t level;              // filtered block sum, 0 before the first
+static uint16_t scale = BATT_SCALE_ONE;
+static uint16_t source = SHS_2; // sample and hold source
+
+void BattInit(uint8_t trigger)
+//-------------------------------------------------------------------------
+// Func:  Set up the battery input and its trigger, and start sampling.
+//        Called before Timer A runs the loop tick.
+// Args:  trigger - BATT_ON_TICK, Timer A OUT0, or BATT_ON_CALL, BattConvert
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    ADC10AE0 |= BATT_A3;        // analog input, digital buffer off
+    if(trigger == BATT_ON_TICK)
+    {
+        TACCTL0 = OUTMOD_4;     // OUT0 toggles at TACCR0, a conversion
+        source = SHS_2;         // every other tick
+    }
+    else
+    {
+        TACCTL0 = 0;            // Timer A is left to the tick and encoder
+        source = SHS_0;
+    }
+    level = 0;
+    scale = BATT_SCALE_ONE;
+    fresh = 0;
+    BattStart();
+}
+
+void BattStart(void)
+//-------------------------------------------------------------------------
+// Func:  Turn the ADC10 and its reference on and convert on each trigger
+//        into a new block. The reference settles in 30 us, well before
+//        the first trigger a tick later.
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    ADC10CTL1 = INCH_3 | source | ADC10SSEL_0 | CONSEQ_2;
+    ADC10DTC0 = ADC10CT;        // continuous transfers, block after block
+    ADC10DTC1 = BATT_SAMPLES;
+    ADC10SA = RAM_ADDR(samples, sizeof(samples));   // starts the block
+    ADC10CTL0 = SREF_1 | ADC10SHT_3 | REFON | REF2_5V | ADC10ON | ADC10IE;
+    ADC10CTL0 |= ENC;
+}
+
+void BattStop(void)
+//-------------------------------------------------------------------------
+// Func:  Stop converting and turn the ADC10 and reference off. A block in
+//        progress is dropped.
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    ADC10CTL0 &= ~ENC;
+    ADC10CTL0 = 0;
+}
+
+void BattConvert(void)
+//-------------------------------------------------------------------------
+// Func:  Start a conversion, with BATT_ON_CALL. Called from the watchdog
+//        interval interrupt.
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    ADC10CTL0 |= ADC10SC;
+}
+
+void BattBlock(void)
+//-------------------------------------------------------------------------
+// Func:  Add up the block the DTC has just filled. Called from the ADC10
+//        interrupt, which has cleared ADC10IFG. The next conversion into
+//        the first word is a trigger away.
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint16_t sum = 0;
+    uint8_t i;
+
+    for(i = 0; i < BATT_SAMPLES; i++)
+    {
+        sum += samples[i];
+    }
+    blockSum = sum;
+    fresh = 1;
+}
+
+uint16_t BattScale(void)
+//-------------------------------------------------------------------------
+// Func:  Scale for the motor command offsets, BATT_NOMINAL_MV over the
+//        battery voltage. After a new block the voltage filter takes a
+//        step and the scale is recomputed, with a 32 bit division. The
+//        voltage is clamped to BATT_LOW_MV..BATT_HIGH_MV, and without a
+//        plausible reading the scale is 1.
+// Args:  none
+// Retn:  scale, Q8 (BATT_SCALE_ONE is 1)
+//-------------------------------------------------------------------------
+{
+    uint16_t lvl;
+
+    if(!fresh)
+    {
+        return scale;
+    }
+    fresh = 0;
+    if(level == 0)
+    {
+        level = blockSum;       // first block, start the filter there
+    }
+    else
+    {
+        level += (int16_t)(blockSum - level) >> BATT_FILTER_SHIFT;
+    }
+
+    lvl = level;
+    if(lvl < BATT_SUM_FROM_MV(BATT_ABSENT_MV))
+    {
+        scale = BATT_SCALE_ONE;
+        return scale;
+    }
+    if(lvl < BATT_SUM_FROM_MV(BATT_LOW_MV))
+    {
+        lvl = BATT_SUM_FROM_MV(BATT_LOW_MV);
+    }
+    else if(lvl > BATT_SUM_FROM_MV(BATT_HIGH_MV))
+    {
+        lvl = BATT_SUM_FROM_MV(BATT_HIGH_MV);
+    }
+    scale = (uint16_t)(((uint32_t)BATT_SUM_FROM_MV(BATT_NOMINAL_MV) << 8) / lvl);
+    return scale;
+}
+
+uint16_t BattMv(void)
+//-------------------------------------------------------------------------
+// Func:  Filtered battery voltage, as of the last BattScale
+// Args:  none
+// Retn:  millivolts, 0 before the first block
+//-------------------------------------------------------------------------
+{
+    return (uint16_t)(FIX_MULU_CONST(level, 2500L * BATT_DIVIDER) >> (10 + BATT_SHIFT));
+}
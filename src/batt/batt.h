@@ -0,0 +1,38 @@
+/*
+ *  batt.h
+ *  Battery voltage, sampled in the background by the ADC10. The pack goes
+ *  through a BATT_DIVIDER divider to A3 (P2.3) and is converted against
+ *  the internal 2.5 V reference. Timer A's OUT0 toggles each loop tick and
+ *  triggers a conversion on every rising edge (BATT_ON_TICK), or the
+ *  watchdog interval interrupt starts one with BattConvert (BATT_ON_CALL),
+ *  and the data transfer controller stores the results, so the CPU only
+ *  runs the ADC10 interrupt once per block of BATT_SAMPLES conversions.
+ *
+ *  The ADC10 interrupt calls BattBlock. PowerDwell and PowerStandby stop
+ *  the sampling (BattStop, BattStart) so the reference is off while
+ *  asleep.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - conversions started by BattConvert
+ */
+
+#ifndef BATT_H_
+#define BATT_H_
+
+#include "../config.h"
+#include "stdint.h"
+
+#define BATT_SCALE_ONE  256         // BattScale for the nominal voltage
+
+#define BATT_ON_TICK    0           // convert on Timer A OUT0
+#define BATT_ON_CALL    1           // convert on each BattConvert
+
+void BattInit(uint8_t trigger);
+void BattConvert(void);
+void BattStart(void);
+void BattStop(void);
+void BattBlock(void);
+uint16_t BattScale(void);
+uint16_t BattMv(void);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ *  boot.c
+ *  Power on sequence, see boot.h.
+ *
+ *  An accelerometer that is still powering up does not acknowledge its
+ *  address, so MMA8450Init returns 0 without touching it and is simply
+ *  tried again a poll interval later. Both sensors share the supply, the
+ *  second one is looked for once the first has answered. Each is then
+ *  given a loop tick at a time until SYSMOD reports it sampling.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - sleeps marked for the duty cycle accounts
+ */
+
+#include "boot.h"
+#include "../hal/hal.h"
+#include "../duty/duty.h"
+#include "stdint.h"
+
+void BootSleep(uint16_t ticks)
+//-------------------------------------------------------------------------
+// Func:  Sleep in LPM1 for a number of loop ticks, the CPU is off and
+//        SMCLK keeps Timer A running. The first tick may come early.
+// Args:  ticks - Timer A overflows to wait for
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    while(ticks != 0)
+    {
+        DutySleep();
+        __bis_SR_register(LPM1_bits | GIE); // until the next tick
+        DutyWake(DUTY_BOOT);
+        ticks--;
+    }
+}
+
+uint8_t BootSensors(MMA8450 * mma)
+//-------------------------------------------------------------------------
+// Func:  Wait for the accelerometer at MMA_ADDR_SA0_0 to answer, polling
+//        every BOOT_POLL_MS, and initialize it and the optional one at
+//        MMA_ADDR_SA0_1. Returns once they sample at the active rate.
+//        Waits for ever without the first.
+// Args:  mma - MMA_MAX_DEVICES device contexts
+// Retn:  sensors found, 1 or 2
+//-------------------------------------------------------------------------
+{
+    uint8_t count;
+    uint8_t i;
+
+    MMA8450InitBus();
+    while(!MMA8450Init(&mma[0], MMA_ADDR_SA0_0))
+    {
+        BootSleep(BOOT_POLL_TICKS);
+    }
+    count = 1 + MMA8450Init(&mma[1], MMA_ADDR_SA0_1);
+
+    for(i = 0; i < count; i++)
+    {
+        while(MMA8450ReadSysmod(&mma[i]) != SYSMOD_WAKE)
+        {
+            BootSleep(1);
+        }
+    }
+    return count;
+}
@@ -0,0 +1,25 @@
+/*
+ *  boot.h
+ *  Power on sequence. main starts the clocks, the UART, the battery
+ *  sampling and the Timer A loop tick first, while the accelerometers are
+ *  still powering up, then BootSensors polls for them and returns as soon
+ *  as they answer and sample. The waits are loop ticks asleep in LPM1
+ *  (BootSleep), so the Timer A interrupt must clear LPM1_bits on exit.
+ *  They go to the DUTY_BOOT phase of the duty cycle accounts, which main
+ *  starts first.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - duty cycle accounts
+ */
+
+#ifndef BOOT_H_
+#define BOOT_H_
+
+#include "../config.h"
+#include "../mma8450q/mma8450q.h"
+#include "stdint.h"
+
+void BootSleep(uint16_t ticks);
+uint8_t BootSensors(MMA8450 * mma);
+
+#endif
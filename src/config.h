@@ -0,0 +1,240 @@
+/*
+ *  config.h
+ *  Timing and scaling configuration. Everything the firmware needs to know
+ *  about time and units is derived here at compile time from the clock,
+ *  the control loop tick rate and the accelerometer settings, so changing
+ *  one of them keeps the rest consistent. The derived values are integer
+ *  constant expressions, the sample loop only adds and shifts.
+ *
+ *  Estimator units (see estimator.c):
+ *      acceleration    1 count = 1 g / ACCEL_COUNTS_PER_G
+ *      velocity        1 unit  = 1 count held for one averaging period
+ *      distance        1 unit  = 1 velocity unit held for one tick
+ *  so a velocity update is vel += accel, and a distance update is
+ *  dist += vel once per tick, or dist += vel << AVG_SHIFT once per
+ *  averaging period.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - rest and bias estimation settings
+ *             10/19/26 - slow rate for cruise and rest
+ *             10/19/26 - jolts detected by the accelerometer
+ *             10/19/26 - low power dwell at the finish line
+ *             10/19/26 - standby between runs
+ *             10/19/26 - wheel encoder
+ *             10/19/26 - Kalman filter noise model
+ *             10/19/26 - complementary filter crossover
+ *             10/19/26 - battery voltage and command compensation
+ *             10/19/26 - boot poll interval
+ *             10/19/26 - watchdog timeout and interval
+ *             10/19/26 - duty cycle timer
+ *             10/19/26 - encoder plausibility check
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include "stdint.h"
+
+// independent settings
+#define SMCLK_HZ        1000000L    // DCO calibrated to 1 MHz
+#define TICK_HZ         300L        // control loop rate, Timer A
+#define ACCEL_ODR_HZ    400         // MMA8450Q output data rate
+#define ACCEL_FS_G      2           // MMA8450Q full scale range, +/-g
+#define AVG_SHIFT       3           // log2 of samples per velocity update
+#define SLOW_SHIFT      2           // log2 of the tick decimation while
+                                    // cruising or at rest
+#define SLOW_ODR_HZ     100         // MMA8450Q output data rate then
+#define FWD_STOP_MM     12000L      // where to come to rest, from the start
+#define REV_STOP_MM     12000L      // and from the finish line
+#define BRAKE_MS        155L        // stopping distance / speed, calibrated
+                                    // from hallsim's coast and stop speed
+#define REST_MS         600L        // time at rest at each end, learning
+                                    // the accelerometer bias
+#define REST_MAX_MS     3000L       // give up waiting for rest after this
+#define DWELL_MS        3000L       // asleep at the finish line before the
+                                    // rest, timed by the VLO
+#define DWELL_CAL_SHIFT 6           // VLO measured over DWELL_MS >> this
+#define BOOT_POLL_MS    5L          // between WHO_AM_I polls at power on
+#define SLEEP_ODR_HZ    50          // MMA8450Q auto-sleep rate in standby
+#define SLEEP_AFTER_MS  640L        // and the quiet time before it sleeps
+#define STILL_MS        100L        // quiet this long counts as at rest
+#define STILL_JOLT_MG   63          // quiet: no high pass filtered change
+#define STILL_JOLT_SAMPLES  2       // above this for this many samples
+#define STILL_ACCEL_MM_S2   80L     // and bias corrected acceleration below
+#define STEADY_MS       1600L       // motor command held this long (4 drive
+                                    // time constants) counts as steady speed
+#define BIAS_REST_SHIFT     4       // bias filter time constants, 2^n
+#define BIAS_STEADY_SHIFT   7       // averaging periods
+#define CRUISE_MM_S     1300L       // speed profile, see speedctl.c, must
+                                    // be under the drive's speed at
+                                    // SPEED_CMD_MAX (profgen checks)
+#define APPROACH_MM_S   400L
+#define ACCEL_MM_S2     1000L
+#define SPEED_APPROACH_SHIFT    8   // taper time constant 2^8 ticks, 0.85s
+#define SPEED_KP_SHIFT  7           // PI gains, 1 / 2^n commands per unit
+#define SPEED_KI_SHIFT  10
+#define SPEED_CMD_MAX   58          // full command, less room for the 5
+                                    // count trim on motor 2 in reverse
+#define ENC_LINES       24          // wheel encoder lines per revolution
+#define WHEEL_DIA_MM    120L        // of the wheel the encoder turns with
+#define ENC_STOP_MS     200L        // no encoder edge this long, stopped
+#define ENC_FAULT_MM    30L         // the drive model this far on a drive
+                                    // command without an encoder count,
+                                    // the encoder has failed
+#define CF_SHIFT        4           // complementary filter crossover, 2^n
+                                    // averaging periods: the drive model
+                                    // below, the accelerometer above
+#define KAL_ACCEL_MM_S2 50L         // Kalman filter noise model (kalgen):
+                                    // acceleration noise and vibration, rms
+                                    // per averaging period
+#define KAL_ENC_UM      2000L       // encoder distance noise, quantization
+                                    // and wheel slip, rms
+#define KAL_DRIFT_MM_S2 2L          // accelerometer bias drift, rms over 1 s
+#define BATT_NOMINAL_MV 7400L       // 2S LiPo voltage the drive
+                                    // characterization was taken at
+#define BATT_LOW_MV     6400L       // commands are scaled for the pack
+#define BATT_HIGH_MV    8400L       // voltage within this range
+#define BATT_ABSENT_MV  3000L       // below this there is no reading, the
+                                    // commands are sent unscaled
+#define BATT_DIVIDER    4L          // battery to A3 (P2.3) divider ratio
+#define BATT_SHIFT      4           // log2 of conversions per block, one
+                                    // every other tick or WDOG_TICK_ACLK
+#define BATT_FILTER_SHIFT   2       // voltage filter time constant, 2^n
+                                    // blocks
+#define WDOG_CYCLES     32768L      // watchdog timeout, SMCLK cycles:
+                                    // 32768, 8192, 512 or 64
+#define WDOG_TICK_ACLK  512L        // interval mode period, ACLK (VLO)
+                                    // cycles, from the same choices
+#define DUTY_SHIFT      3           // awake and asleep times counted at
+                                    // SMCLK / 2^n, Timer B
+#define HALL_MAX_MM     50000L      // longest run the units must hold
+#define SPEED_MAX_MM_S  5000L       // fastest speed the units must hold
+
+// standard gravity, um/s^2
+#define GRAVITY_UM_S2   9806650LL
+
+// Timer A in up mode counts 0..TACCR0, rounded to the nearest period
+#define TICK_TACCR0     ((SMCLK_HZ + TICK_HZ / 2) / TICK_HZ - 1)
+#define SLOW_TACCR0     (((SMCLK_HZ << SLOW_SHIFT) + TICK_HZ / 2) / TICK_HZ - 1)
+
+// 12 bit output, 1024 counts/g at +/-2g
+#define ACCEL_COUNTS_PER_G  (2048 / ACCEL_FS_G)
+
+#define AVG_SAMPLES     (1 << AVG_SHIFT)    // samples per velocity update
+
+// physical values to estimator units, for constant arguments only
+#define VEL_FROM_MM_S(v)    ((int32_t)((v) * 1000LL * ACCEL_COUNTS_PER_G * \
+                             TICK_HZ / (GRAVITY_UM_S2 * AVG_SAMPLES)))
+#define DIST_FROM_MM(d)     ((int32_t)((d) * 1000LL * ACCEL_COUNTS_PER_G * \
+                             TICK_HZ * TICK_HZ / (GRAVITY_UM_S2 * AVG_SAMPLES)))
+
+// speed profile in estimator units. The acceleration ramp itself is in the
+// tables profgen generates from ACCEL_MM_S2 and CRUISE_MM_S.
+#define SPEED_CRUISE_VEL    VEL_FROM_MM_S(CRUISE_MM_S)
+#define SPEED_APPROACH_VEL  VEL_FROM_MM_S(APPROACH_MM_S)
+
+// times in averaging periods (velocity updates)
+#define AVG_PERIODS(ms)     ((ms) * TICK_HZ / (1000L * AVG_SAMPLES))
+#define REST_WINDOWS    AVG_PERIODS(REST_MS)
+#define REST_MAX_WINDOWS    AVG_PERIODS(REST_MAX_MS)
+#define STILL_WINDOWS   AVG_PERIODS(STILL_MS)
+#define STEADY_WINDOWS  AVG_PERIODS(STEADY_MS)
+
+// loop ticks
+#define TICKS(ms)           (((ms) * TICK_HZ + 999) / 1000)
+#define BOOT_POLL_TICKS     TICKS(BOOT_POLL_MS)
+
+// VLO calibration window in SMCLK cycles. Timer A counts ACLK (VLO) over it,
+// and the dwell is that count << DWELL_CAL_SHIFT, at ACLK / 8 << (shift - 3).
+#define DWELL_CAL_CYCLES    ((SMCLK_HZ * DWELL_MS / 1000) >> DWELL_CAL_SHIFT)
+#define VLO_MAX_HZ      20000L      // fastest VLO in the datasheet
+
+// wheel encoder, every edge of both channels counts, 4 per line
+#define ENC_COUNTS_REV      (4 * ENC_LINES)
+#define ENC_UM_PER_COUNT    (WHEEL_DIA_MM * 3141593L / 1000 / ENC_COUNTS_REV)
+// encoder speed in velocity units is ENC_VEL_CYCLES / SMCLK cycles per line
+#define ENC_VEL_CYCLES      VEL_FROM_MM_S(ENC_UM_PER_COUNT * 4LL * SMCLK_HZ / 1000)
+#define ENC_STOP_CYCLES     (SMCLK_HZ * ENC_STOP_MS / 1000)
+// as drive model speeds summed once per averaging period
+#define ENC_FAULT_TRAVEL    (DIST_FROM_MM(ENC_FAULT_MM) >> AVG_SHIFT)
+// distance units per encoder count, rounded
+#define ENC_DIST_PER_COUNT  ((int32_t)(((int64_t)ENC_UM_PER_COUNT * ACCEL_COUNTS_PER_G * \
+                             TICK_HZ * TICK_HZ + GRAVITY_UM_S2 * AVG_SAMPLES / 2) / \
+                             (GRAVITY_UM_S2 * AVG_SAMPLES)))
+
+// stillness threshold per averaging period, on the sum of AVG_SAMPLES samples
+#define STILL_SUM       ((int32_t)(STILL_ACCEL_MM_S2 * 1000LL * ACCEL_COUNTS_PER_G * \
+                                   AVG_SAMPLES / GRAVITY_UM_S2))
+
+// battery voltage as the sum of a block of ADC10 codes against the 2.5 V
+// reference
+#define BATT_SAMPLES        (1 << BATT_SHIFT)
+#define BATT_SUM_FROM_MV(mv)    ((int32_t)((mv) * (1024L << BATT_SHIFT) / \
+                                 (2500L * BATT_DIVIDER)))
+
+// brake time in ticks, Q8, see BrakeDist()
+#define BRAKE_TICKS_Q8      ((int32_t)(BRAKE_MS * TICK_HZ * 256 / 1000))
+
+// compile time checks, a negative array size fails the build
+#define CONFIG_ASSERT(name, cond)   typedef char config_assert_##name[(cond) ? 1 : -1]
+
+CONFIG_ASSERT(taccr0_fits, TICK_TACCR0 > 0 && TICK_TACCR0 <= 0xFFFF);
+CONFIG_ASSERT(fresh_sample_each_tick, ACCEL_ODR_HZ >= TICK_HZ);
+// slow ticks still see a new sample each, and a whole number of them makes
+// up an averaging period
+CONFIG_ASSERT(slow_taccr0_fits, SLOW_TACCR0 <= 0xFFFF);
+CONFIG_ASSERT(fresh_sample_each_slow_tick, (SLOW_ODR_HZ << SLOW_SHIFT) >= TICK_HZ);
+CONFIG_ASSERT(slow_ticks_per_avg, SLOW_SHIFT <= AVG_SHIFT);
+CONFIG_ASSERT(valid_full_scale, ACCEL_FS_G == 2 || ACCEL_FS_G == 4 || ACCEL_FS_G == 8);
+// the running sum of 12 bit samples is an int16_t
+CONFIG_ASSERT(avg_sum_fits, 2048L * AVG_SAMPLES <= 32768L);
+// the velocity update adds at most one full scale average
+CONFIG_ASSERT(vel_fits, VEL_FROM_MM_S(SPEED_MAX_MM_S) < 0x7FFFFFFFL - 2048);
+// one distance update can add vel << AVG_SHIFT
+CONFIG_ASSERT(dist_fits, DIST_FROM_MM(HALL_MAX_MM) <
+              0x7FFFFFFFL - ((int64_t)VEL_FROM_MM_S(SPEED_MAX_MM_S) << AVG_SHIFT));
+// resolution: a millimetre must be at least one distance unit
+CONFIG_ASSERT(dist_resolution, DIST_FROM_MM(1) >= 1);
+CONFIG_ASSERT(stops_in_range, FWD_STOP_MM < HALL_MAX_MM && REV_STOP_MM < HALL_MAX_MM);
+CONFIG_ASSERT(cruise_in_range, CRUISE_MM_S <= SPEED_MAX_MM_S && APPROACH_MM_S <= CRUISE_MM_S);
+// rest and steady counters are uint8_t and saturate at 255
+CONFIG_ASSERT(rest_windows, STILL_WINDOWS >= 1 && STILL_WINDOWS + REST_WINDOWS < 255 &&
+              REST_MAX_WINDOWS < 255 && REST_WINDOWS < REST_MAX_WINDOWS);
+// the MMA8450Q transient threshold is 7 bits of 1/16 g, its count 8 bits
+CONFIG_ASSERT(jolt_fits, STILL_JOLT_MG >= 32 && STILL_JOLT_MG < 7969 &&
+              STILL_JOLT_SAMPLES >= 1 && STILL_JOLT_SAMPLES <= 255);
+// the dwell count at ACLK / 8 fits TACCR0 with the fastest VLO
+CONFIG_ASSERT(dwell_fits, DWELL_CAL_SHIFT >= 3 &&
+              (VLO_MAX_HZ * DWELL_MS / 1000) >> 3 < 0xFFFF);
+// the encoder count is an int16_t read every averaging period, its speed
+// a 32 bit division
+CONFIG_ASSERT(enc_fits, ENC_UM_PER_COUNT >= 100 && ENC_STOP_CYCLES < 0x3FFFFFFFL &&
+              ENC_VEL_CYCLES < 0x7FFFFFFFL &&
+              (int64_t)SPEED_MAX_MM_S * 1000 * AVG_SAMPLES / TICK_HZ <
+              32767L * ENC_UM_PER_COUNT);
+// a working encoder counts several times over that distance
+CONFIG_ASSERT(enc_fault, ENC_FAULT_MM * 1000 >= 4 * ENC_UM_PER_COUNT);
+CONFIG_ASSERT(steady_windows, STEADY_WINDOWS >= 1 && STEADY_WINDOWS < 255);
+// the bias is kept in sample sums << BIAS_STEADY_SHIFT, in an int32_t
+CONFIG_ASSERT(bias_fits, BIAS_REST_SHIFT <= BIAS_STEADY_SHIFT &&
+              (2048L * AVG_SAMPLES << BIAS_STEADY_SHIFT) < 0x3FFFFFFFL);
+// a block sums into a uint16_t, a full battery stays below the reference
+// and the Q8 scale of a motor command offset fits 16 bits
+CONFIG_ASSERT(batt_fits, BATT_SHIFT >= 0 && BATT_SHIFT <= 6 &&
+              BATT_HIGH_MV < 2500L * BATT_DIVIDER &&
+              BATT_ABSENT_MV < BATT_LOW_MV && BATT_LOW_MV < BATT_NOMINAL_MV &&
+              BATT_NOMINAL_MV < BATT_HIGH_MV &&
+              63L * 256 * BATT_NOMINAL_MV / BATT_LOW_MV <= 0xFFFF);
+// the slowest loop tick, with as long again for the work in it, is kicked
+// well within the watchdog timeout
+CONFIG_ASSERT(wdog_fits, (WDOG_CYCLES == 32768L || WDOG_CYCLES == 8192L ||
+                          WDOG_CYCLES == 512L || WDOG_CYCLES == 64L) &&
+              (WDOG_TICK_ACLK == 32768L || WDOG_TICK_ACLK == 8192L ||
+               WDOG_TICK_ACLK == 512L || WDOG_TICK_ACLK == 64L) &&
+              2 * (SLOW_TACCR0 + 1) <= WDOG_CYCLES);
+// Timer B's input divider
+CONFIG_ASSERT(duty_fits, DUTY_SHIFT >= 0 && DUTY_SHIFT <= 3);
+// the brake distance product is an int32_t
+CONFIG_ASSERT(brake_fits, (int64_t)VEL_FROM_MM_S(SPEED_MAX_MM_S) * BRAKE_TICKS_Q8 < 0x7FFFFFFFL);
+
+#endif
@@ -0,0 +1,155 @@
+/*
+ *  duty.c
+ *  Awake and asleep time per phase, see duty.h.
+ *
+ *  Timer B runs in continuous mode from the same clock as the CPU, so TBR
+ *  reads without the majority vote an asynchronous clock needs. Each mark
+ *  adds the 16 bit difference since the last one, so no span between two
+ *  marks may reach 2^16 counts (0.52 s at SMCLK / 8), and the byte counts
+ *  of the drivers are taken up the same way. A mark is a few dozen cycles.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - LPM3 dwell time and LPM4 standbys kept per phase
+ */
+
+#include "duty.h"
+#include "../hal/hal.h"
+#include "../i2c/i2c.h"
+#include "../uart/uart.h"
+#include "stdint.h"
+
+static Duty table[DUTY_PHASES];
+static uint8_t phase;           // phase the time since the mark goes to
+static uint16_t mark;           // TBR at the last mark
+static uint16_t i2cMark;        // driver byte counts then
+static uint16_t uartMark;
+
+static void Account(uint8_t asleep)
+//-------------------------------------------------------------------------
+// Func:  Add the time and bytes since the last mark to the current phase
+//        and mark again
+// Args:  asleep - 1 if the CPU was in LPM1 since the mark, 0 if awake
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    Duty * d = &table[phase];
+    uint16_t t = TBR;
+    uint16_t i2c = I2CBytes();
+    uint16_t uart = UARTBytes();
+
+    if(asleep)
+    {
+        d->sleep += (uint16_t)(t - mark);
+    }
+    else
+    {
+        d->active += (uint16_t)(t - mark);
+    }
+    d->i2cBytes += (uint16_t)(i2c - i2cMark);
+    d->uartBytes += (uint16_t)(uart - uartMark);
+    mark = t;
+    i2cMark = i2c;
+    uartMark = uart;
+}
+
+void DutyInit(uint8_t phase0)
+//-------------------------------------------------------------------------
+// Func:  Start Timer B and clear the table, the CPU is awake from here.
+//        Bytes sent before, the first stop command, count from power on.
+// Args:  phase0 - phase the time goes to until the first DutyWake
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint8_t i;
+
+    for(i = 0; i < DUTY_PHASES; i++)
+    {
+        table[i].active = 0;
+        table[i].sleep = 0;
+        table[i].lpm3 = 0;
+        table[i].standbys = 0;
+        table[i].i2cBytes = 0;
+        table[i].uartBytes = 0;
+    }
+    TBCTL = TBSSEL_2 | (DUTY_SHIFT << 6) | MC_2 | TBCLR;   // SMCLK / ID_n,
+                                                            // continuous
+    phase = phase0;
+    mark = 0;
+    i2cMark = 0;                // bytes since power on go to the first phase
+    uartMark = 0;
+}
+
+void DutySleep(void)
+//-------------------------------------------------------------------------
+// Func:  Mark going to sleep, right before LPM1
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    Account(0);
+}
+
+void DutyWake(uint8_t next)
+//-------------------------------------------------------------------------
+// Func:  Mark waking up, right after LPM1
+// Args:  next - phase the time goes to from here
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    Account(1);
+    phase = next;
+}
+
+void DutyPhase(uint8_t next)
+//-------------------------------------------------------------------------
+// Func:  Mark a change of phase while awake
+// Args:  next - phase the time goes to from here
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    Account(0);
+    phase = next;
+}
+
+void DutyPause(void)
+//-------------------------------------------------------------------------
+// Func:  Mark the start of the dwell or the standby, right before LPM3 or
+//        LPM4
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    Account(0);
+}
+
+void DutyResume(uint32_t lpm3)
+//-------------------------------------------------------------------------
+// Func:  Mark its end, right after. Timer B's counts since DutyPause are
+//        dropped, the wake up interrupt only, and the bytes go to the
+//        current phase with the next mark.
+// Args:  lpm3 - Timer B counts spent in the LPM3 dwell, DUTY_DWELL, or 0
+//               for an LPM4 standby, which counts one standby
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    if(lpm3 != 0)
+    {
+        table[phase].lpm3 += lpm3;
+    }
+    else
+    {
+        table[phase].standbys++;
+    }
+    mark = TBR;
+}
+
+const Duty * DutyTable(void)
+//-------------------------------------------------------------------------
+// Func:  The accounts so far
+// Args:  none
+// Retn:  DUTY_PHASES entries, times in Timer B counts of 2^DUTY_SHIFT
+//        SMCLK cycles
+//-------------------------------------------------------------------------
+{
+    return table;
+}
@@ -0,0 +1,53 @@
+/*
+ *  duty.h
+ *  Where the CPU's time goes: awake and asleep in LPM1 for each phase of
+ *  the run, timed by Timer B running free from SMCLK / 2^DUTY_SHIFT, along
+ *  with the I2C and UART bytes moved. The phases are main's steps 0 to 4
+ *  and DUTY_BOOT for power on up to the control loop.
+ *
+ *  main marks each sleep (DutySleep) and wake up (DutyWake), and the time
+ *  in between goes to the phase of that moment. Interrupts that leave the
+ *  CPU asleep (encoder edges, ADC10 blocks) count as asleep, the one that
+ *  wakes it as awake from the wake up on. The LPM3 dwell and the LPM4
+ *  standby stop SMCLK and Timer B with it, so PowerDwell and PowerStandby
+ *  mark them (DutyPause, DutyResume) and their time is kept apart: the
+ *  dwell is as long as its VLO calibration makes it, DWELL_MS, and goes
+ *  to lpm3. Nothing runs to time the standby, it only counts in standbys.
+ *  main moves to the rest at the finish (DutyPhase) before the dwell.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - LPM3 dwell time and LPM4 standbys kept per phase
+ */
+
+#ifndef DUTY_H_
+#define DUTY_H_
+
+#include "../config.h"
+#include "stdint.h"
+
+#define DUTY_BOOT       5           // phase before the control loop
+#define DUTY_PHASES     6
+
+// the dwell in Timer B counts, DWELL_MS by the VLO calibration
+#define DUTY_DWELL      (((uint32_t)DWELL_CAL_CYCLES << DWELL_CAL_SHIFT) \
+                         >> DUTY_SHIFT)
+
+typedef struct
+{
+    uint32_t active;        // Timer B counts awake
+    uint32_t sleep;         // and in LPM1
+    uint32_t lpm3;          // and in the LPM3 dwell, DUTY_DWELL each
+    uint16_t standbys;      // LPM4 standbys, not timed
+    uint32_t i2cBytes;      // data bytes on the I2C bus
+    uint32_t uartBytes;     // bytes sent to the motor controller
+} Duty;
+
+void DutyInit(uint8_t phase);
+void DutySleep(void);
+void DutyWake(uint8_t phase);
+void DutyPhase(uint8_t phase);
+void DutyPause(void);
+void DutyResume(uint32_t lpm3);
+const Duty * DutyTable(void);
+
+#endif
@@ -0,0 +1,247 @@
+/*
+ *  encoder.c
+ *  Quadrature wheel encoder, see encoder.h.
+ *
+ *  Each capture reads the levels of both channels (CCI) and decodes the
+ *  change from the last levels with a table: a step forward or back, none
+ *  when the other channel's capture has already counted it, or a skip when
+ *  both channels changed because an edge was missed. A skip counts two
+ *  steps in the last direction and an error.
+ *
+ *  The speed is timed over a whole line, between two edges of the same
+ *  channel and level, so neither the duty cycle nor the phase between the
+ *  channels matters. After a reversal there is no speed until a line has
+ *  passed in the new direction.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include "encoder.h"
+#include "../hal/hal.h"
+#include "stdint.h"
+
+#define ENC_SKIP    2           // both channels changed
+#define ENC_RUN     5           // edges in one direction that span a line
+
+typedef struct
+{
+    uint32_t base;          // SMCLK cycles at the last Timer A overflow
+    uint32_t last;          // time of the last step
+    uint32_t edge[4];       // time of the last edge, per channel and level
+    uint32_t period;        // SMCLK cycles per line, 0 if not known
+    int32_t distance;       // counts, see EncoderDistance
+    int16_t count;          // counts, wraps
+    int16_t seen;           // count at the last EncoderDistance
+    uint16_t errors;        // missed edges and capture overflows
+    uint8_t state;          // last levels, A in bit 1, B in bit 0
+    uint8_t run;            // edges timed in one direction, up to ENC_RUN
+    int8_t dir;             // direction of the last step, 0 if none yet
+} Encoder;
+
+static volatile Encoder enc;
+
+// step for each change of levels, indexed by old state << 2 | new state.
+// Forward is A leading: 00, 10, 11, 01
+static const int8_t steps[16] =
+{
+           0,       -1,        1, ENC_SKIP,
+           1,        0, ENC_SKIP,       -1,
+          -1, ENC_SKIP,        0,        1,
+    ENC_SKIP,        1,       -1,        0
+};
+
+static uint8_t EncoderLevels(void)
+//-------------------------------------------------------------------------
+// Func:  Read the levels of both channels
+// Args:  none
+// Retn:  A in bit 1, B in bit 0
+//-------------------------------------------------------------------------
+{
+    return ((TACCTL1 & CCI) ? 2 : 0) | ((TACCTL2 & CCI) ? 1 : 0);
+}
+
+void EncoderInit(void)
+//-------------------------------------------------------------------------
+// Func:  Capture both edges of both channels, count from zero. Called
+//        before interrupts are enabled, Timer A may already be running.
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    P1DIR &= ~(ENC_A_P1 | ENC_B_P1);
+    P1SEL |= ENC_A_P1 | ENC_B_P1;   // timer function, CCI1A and CCI2A
+    TACCTL1 = CM_3 | CCIS_0 | SCS | CAP | CCIE;
+    TACCTL2 = CM_3 | CCIS_0 | SCS | CAP | CCIE;
+
+    enc.count = 0;
+    enc.seen = 0;
+    enc.distance = 0;
+    enc.errors = 0;
+    enc.period = 0;
+    enc.run = 0;
+    enc.dir = 0;
+    enc.state = EncoderLevels();
+}
+
+void EncoderEdge(uint8_t channel)
+//-------------------------------------------------------------------------
+// Func:  Count a captured edge and time the line it ends. Called from the
+//        Timer A interrupt, the TAIV read has cleared the capture flag.
+// Args:  channel - ENC_A for TAIV_TACCR1, ENC_B for TAIV_TACCR2
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint16_t cap;
+    uint32_t t;
+    uint8_t state;
+    uint8_t edge;
+    int8_t step;
+
+    if(channel == ENC_A)
+    {
+        cap = TACCR1;
+        if(TACCTL1 & COV)           // an edge came before the last capture
+        {                           // was read
+            TACCTL1 &= ~COV;
+            enc.errors++;
+            enc.run = 0;
+        }
+    }
+    else
+    {
+        cap = TACCR2;
+        if(TACCTL2 & COV)
+        {
+            TACCTL2 &= ~COV;
+            enc.errors++;
+            enc.run = 0;
+        }
+    }
+    t = enc.base + cap;
+    if((TACTL & TAIFG) && cap < (TACCR0 >> 1))
+    {
+        t += TACCR0 + 1;            // captured after an overflow EncoderTick
+    }                               // has not counted yet
+
+    state = EncoderLevels();
+    step = steps[(enc.state << 2) | state];
+    enc.state = state;
+    if(step == 0)
+    {
+        return;                     // counted with the other channel
+    }
+    if(step == ENC_SKIP)
+    {
+        step = enc.dir << 1;        // missed an edge, assume the same
+        enc.errors++;               // direction, and a line is not timed
+        enc.run = 0;                // from the missing edge
+        if(step == 0)
+        {
+            return;
+        }
+    }
+    else if(enc.dir != step)
+    {
+        enc.dir = step;             // reversed, or the first step, no speed
+        enc.period = 0;             // until a line has passed
+        enc.run = 0;
+    }
+    enc.count += step;
+    enc.last = t;
+
+    // time the line from the last edge of this channel at this level
+    edge = (channel << 1) | ((channel == ENC_A ? state >> 1 : state) & 1);
+    if(enc.run < ENC_RUN)
+    {
+        enc.run++;
+    }
+    if(enc.run == ENC_RUN)
+    {
+        enc.period = t - enc.edge[edge];
+    }
+    enc.edge[edge] = t;
+}
+
+void EncoderTick(void)
+//-------------------------------------------------------------------------
+// Func:  Extend the edge times past a Timer A overflow. Called from the
+//        Timer A interrupt for TAIV_TAIFG.
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    enc.base += TACCR0 + 1;
+}
+
+void EncoderResync(void)
+//-------------------------------------------------------------------------
+// Func:  Forget the speed after Timer A has been stopped or run from
+//        another clock (PowerDwell, PowerStandby), so no edge is timed
+//        across it. The count is kept.
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    __disable_interrupt();
+    enc.period = 0;
+    enc.run = 0;
+    enc.dir = 0;
+    enc.state = EncoderLevels();
+    __enable_interrupt();
+}
+
+int32_t EncoderDistance(void)
+//-------------------------------------------------------------------------
+// Func:  Distance since EncoderInit. The interrupt keeps a 16 bit count,
+//        this adds its change since the last call to a 32 bit one, so it
+//        has to be called at least every 32767 counts.
+// Args:  none
+// Retn:  distance in counts, ENC_UM_PER_COUNT each, forward positive
+//-------------------------------------------------------------------------
+{
+    int16_t count = enc.count;      // a single word, read atomically
+    enc.distance += (int16_t)((uint16_t)count - (uint16_t)enc.seen);
+    enc.seen = count;
+    return enc.distance;
+}
+
+int32_t EncoderSpeed(void)
+//-------------------------------------------------------------------------
+// Func:  Wheel speed from the time of the last line. Without an edge for
+//        longer than a quarter line the speed is at most one count in that
+//        time, and after ENC_STOP_MS it is 0. Takes a 32 bit division.
+// Args:  none
+// Retn:  speed in estimator velocity units, forward positive
+//-------------------------------------------------------------------------
+{
+    uint32_t period;
+    int32_t idle;
+    int8_t dir;
+
+    __disable_interrupt();          // consistent with the edge interrupt
+    period = enc.period;
+    idle = (int32_t)(enc.base - enc.last);
+    dir = enc.dir;
+    __enable_interrupt();
+
+    if(period == 0 || idle > ENC_STOP_CYCLES)
+    {
+        return 0;
+    }
+    if(idle > 0 && ((uint32_t)idle << 2) > period)
+    {
+        period = (uint32_t)idle << 2;   // slowing down
+    }
+    return dir > 0 ? (int32_t)(ENC_VEL_CYCLES / period) :
+                     -(int32_t)(ENC_VEL_CYCLES / period);
+}
+
+uint16_t EncoderErrors(void)
+//-------------------------------------------------------------------------
+// Func:  Missed edges and capture overflows since EncoderInit
+// Args:  none
+// Retn:  error count, wraps
+//-------------------------------------------------------------------------
+{
+    return enc.errors;
+}
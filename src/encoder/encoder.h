@@ -0,0 +1,37 @@
+/*
+ *  encoder.h
+ *  Quadrature wheel encoder on the Timer A capture inputs: channel A on
+ *  CCI1A (P1.2, also the board's push button, which is not used) and
+ *  channel B on CCI2A (P1.3). Both edges of both channels are captured, so
+ *  there are four counts per encoder line. Timer A keeps running the
+ *  control loop tick, the overflows extend it to a 32 bit SMCLK cycle count
+ *  that times the edges.
+ *
+ *  The Timer A interrupt calls EncoderEdge for TAIV_TACCR1/TAIV_TACCR2 and
+ *  EncoderTick for TAIV_TAIFG.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#ifndef ENCODER_H_
+#define ENCODER_H_
+
+#include "../config.h"
+#include "stdint.h"
+
+// encoder channels, port 1 pins
+#define ENC_A_P1    0x04        // P1.2, CCI1A
+#define ENC_B_P1    0x08        // P1.3, CCI2A
+
+#define ENC_A       0           // channel argument of EncoderEdge
+#define ENC_B       1
+
+void EncoderInit(void);
+void EncoderEdge(uint8_t channel);
+void EncoderTick(void);
+void EncoderResync(void);
+int32_t EncoderDistance(void);
+int32_t EncoderSpeed(void);
+uint16_t EncoderErrors(void);
+
+#endif
@@ -0,0 +1,356 @@
+/*
+ *  estimator.c
+ *  Velocity and distance estimation from averaged accelerometer samples. This
+ *  module does not touch any registers so it can also be built and run on a
+ *  PC against recorded traces (see host/replay).
+ *
+ *  Version 1: 10/19/26 - moved NewVel/NewDist and sample averaging out of
+ *                        main.c
+ *             10/19/26 - units and averaging from config.h, no multiply or
+ *                        divide
+ *             10/19/26 - added BrakeDist for the predictive stop
+ *             10/19/26 - online bias estimation and stillness detection
+ *             10/19/26 - samples can stand for several ticks
+ *             10/19/26 - sample to sample activity left to the sensor's
+ *                        transient engine
+ *             10/19/26 - steady state Kalman filter with the wheel encoder
+ *             10/19/26 - complementary filter with the drive model
+ *             10/19/26 - constant multiplies from fixmath
+ *             10/19/26 - encoder plausibility check, KalmanCheck
+ *             10/19/26 - control loop's update in EstUpdate, shared with
+ *                        host/replay
+ */
+
+#include "estimator.h"
+#include "../fixmath/fixmath.h"
+#include "../speedctl/speedctl.h"
+#include "stdint.h"
+
+// the gains are right shifts, the bias one past its fraction bits
+CONFIG_ASSERT(kal_shifts, KAL_D_SHIFT >= 1 && KAL_V_SHIFT >= 1 &&
+              KAL_B_SHIFT > KAL_BIAS_FRAC && CF_SHIFT >= 1);
+// FIX_MUL_CONST factors
+CONFIG_ASSERT(est_consts, BRAKE_TICKS_Q8 < 65536L && ENC_DIST_PER_COUNT < 65536L);
+
+// x * 2^-n rounded to nearest, without the truncation bias of a plain shift
+#define SHIFT_ROUND(x, n)     (((x) + (1L << ((n) - 1))) >> (n))
+
+int16_t SignExtend12(int16_t raw)
+//-------------------------------------------------------------------------
+// Func:  Convert a 12 bit two's complement reading to a 16 bit signed value
+// Args:  raw - 12 bit value as returned by MMA8450ReadXYZ
+// Retn:  signed value, -2048 to 2047
+//-------------------------------------------------------------------------
+{
+    return (raw > 0x07FF) ? (raw - 4096) : raw;
+}
+
+uint8_t AvgAddSample(SampleAvg * avg, int16_t raw, uint8_t shift)
+//-------------------------------------------------------------------------
+// Func:  Add a raw sample to the running sum
+// Args:  avg   - averaging state
+//        raw   - 12 bit value as returned by MMA8450ReadXYZ, or already
+//                sign extended (GravityProject), SignExtend12 leaves those
+//        shift - log2 of the ticks the sample stands for, 0 at the full
+//                rate or SLOW_SHIFT, so the sum stays in the same units
+// Retn:  1 if AVG_SAMPLES ticks have been summed and AvgTake should be
+//        called, 0 otherwise
+//-------------------------------------------------------------------------
+{
+    int16_t x = SignExtend12(raw);  // convert to 16 bit signed
+
+    // shift the unsigned value, left shifting a negative int is undefined
+    avg->sum += (int16_t)((uint16_t)x << shift);
+    avg->count += 1 << shift;       // increment tick counter
+    return (avg->count >= AVG_SAMPLES);
+}
+
+int16_t AvgTake(SampleAvg * avg)
+//-------------------------------------------------------------------------
+// Func:  Get the average of the summed samples and reset the running sum
+// Args:  avg - averaging state
+// Retn:  average of the samples
+//-------------------------------------------------------------------------
+{
+    int16_t mean = avg->sum >> AVG_SHIFT;   // divide by 8 to get average
+    //mean &= ~0x0003;                        // get rid of 2 LSBs for noise
+    avg->sum = 0;
+    avg->count = 0;
+    return mean;
+}
+
+int16_t BiasCorrect(BiasEst * est, SampleAvg * avg, uint8_t mode)
+//-------------------------------------------------------------------------
+// Func:  Take the summed samples like AvgTake, less the bias estimate, and
+//        update the estimate when the true acceleration is known to be 0:
+//        at rest, or while the drive holds a steady speed. With the motors
+//        stopped the robot counts as at rest once the corrected
+//        acceleration has stayed below STILL_SUM for STILL_WINDOWS periods;
+//        est->still then reaches STILL_WINDOWS and the caller should zero
+//        the velocity. Jolts are the sensor's to detect (transient engine),
+//        the caller passes BIAS_DRIVING for a period that had one.
+//        The fraction of a count left over is carried to the next period,
+//        so the returned averages have no truncation bias.
+// Args:  est  - bias estimate, zeroed before the first call
+//        avg  - averaging state, AvgAddSample has returned 1
+//        mode - BIAS_DRIVING, BIAS_STEADY or BIAS_STOPPED
+// Retn:  bias corrected average acceleration, counts
+//-------------------------------------------------------------------------
+{
+    // sum and bias in sample sums << BIAS_STEADY_SHIFT
+    int32_t sum = (int32_t)((uint32_t)(int32_t)avg->sum << BIAS_STEADY_SHIFT);
+    int32_t err = sum - est->bias;
+    int16_t mean;
+
+    AvgTake(avg);
+
+    if(mode == BIAS_STOPPED &&
+       err < (STILL_SUM << BIAS_STEADY_SHIFT) &&
+       err > -(STILL_SUM << BIAS_STEADY_SHIFT))
+    {
+        if(est->still < 255)
+        {
+            est->still++;
+        }
+    }
+    else
+    {
+        est->still = 0;
+    }
+
+    if(est->still >= STILL_WINDOWS)
+    {
+        est->bias += err >> BIAS_REST_SHIFT;
+        err = sum - est->bias;
+    }
+    else if(mode == BIAS_STEADY)
+    {
+        est->bias += err >> BIAS_STEADY_SHIFT;
+        err = sum - est->bias;
+    }
+
+    // whole counts of the average, the rest stays in carry
+    est->carry += err;
+    mean = (int16_t)(est->carry >> (BIAS_STEADY_SHIFT + AVG_SHIFT));
+    est->carry &= (1L << (BIAS_STEADY_SHIFT + AVG_SHIFT)) - 1;
+    return mean;
+}
+
+int32_t NewVel(int32_t accel, int32_t vInit)
+//-------------------------------------------------------------------------
+// Func:  Integrate one averaged acceleration into the velocity
+// Args:  accel  - average acceleration over the last AVG_SAMPLES ticks
+//        vInit  - initial velocity (previously returned newVel)
+// Retn:  newVel - new velocity, in counts per averaging period (config.h)
+//-------------------------------------------------------------------------
+{
+    return vInit + accel;   // the averaging period is the velocity unit
+}
+
+int32_t NewDist(int32_t vel, int32_t currDist, uint8_t shift)
+//-------------------------------------------------------------------------
+// Func:  Calculate total distance travelled given velocity and time
+// Args:  vel      - velocity (previously returned newVel)
+//        currDist - current distance travelled in units
+//        shift    - log2 of the elapsed ticks, 0 for one tick or
+//                   AVG_SHIFT for one averaging period
+// Retn:  newDist  - new distance in units (config.h)
+//-------------------------------------------------------------------------
+{
+    // shift the unsigned value, left shifting a negative int is undefined
+    int32_t dDist = (int32_t)((uint32_t)vel << shift);
+    return dDist + currDist;
+}
+
+int32_t BrakeDist(int32_t vel)
+//-------------------------------------------------------------------------
+// Func:  Predict how far the robot travels after a stop command. The drive
+//        is modelled as slowing exponentially with time constant BRAKE_MS
+//        (which also absorbs the UART and tick latency), so the distance
+//        is proportional to the speed. Runs every tick, the constant
+//        multiply is shifts and adds.
+// Args:  vel - current velocity
+// Retn:  distance to rest in distance units, same sign as vel
+//-------------------------------------------------------------------------
+{
+    return FIX_MUL_CONST(vel, BRAKE_TICKS_Q8) >> 8;
+}
+
+int32_t CompVel(int16_t accel, int32_t vInit, int32_t model)
+//-------------------------------------------------------------------------
+// Func:  Integrate one averaged acceleration into the velocity like
+//        NewVel, and pull the result toward the drive model's speed by
+//        2^-CF_SHIFT. Changes faster than the crossover, 2^CF_SHIFT
+//        averaging periods, come from the accelerometer, slower ones and
+//        any drift from the model.
+// Args:  accel - bias corrected average acceleration (BiasCorrect)
+//        vInit - velocity before the update
+//        model - speed the motor commands lead to (SpeedCtlModel), signed
+// Retn:  new velocity
+//-------------------------------------------------------------------------
+{
+    int32_t vel = vInit + accel;
+    return vel + SHIFT_ROUND(model - vel, CF_SHIFT);
+}
+
+void KalmanInit(Kalman * kf, int32_t count)
+//-------------------------------------------------------------------------
+// Func:  Start the Kalman filter with no bias known and the encoder
+//        taken to work
+// Args:  kf    - filter state
+//        count - encoder count now (EncoderDistance)
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    kf->bias = 0;
+    kf->carry = 0;
+    kf->idle = 0;
+    kf->fault = 0;
+    KalmanStart(kf, count);
+}
+
+void KalmanStart(Kalman * kf, int32_t count)
+//-------------------------------------------------------------------------
+// Func:  Measure the distance from here, where the caller zeroes it. The
+//        bias estimate is kept.
+// Args:  kf    - filter state
+//        count - encoder count now (EncoderDistance)
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    kf->meas = 0;
+    kf->count = count;
+    kf->innov = 0;
+}
+
+uint8_t KalmanCheck(Kalman * kf, int32_t count, int32_t model)
+//-------------------------------------------------------------------------
+// Func:  Check the encoder is plausible, once per averaging period before
+//        KalmanMeasure. It has to count before the drive model covers
+//        ENC_FAULT_MM, otherwise it is dead, stalled or slipping. A flat
+//        measurement would pull the distance back and the robot would
+//        never stop, so the filter is left off from then on, until
+//        KalmanInit. At cruise speed that takes three periods.
+// Args:  kf    - filter state
+//        count - encoder count now (EncoderDistance)
+//        model - drive model speed magnitude (SpeedCtlModel) while a drive
+//                command is in effect, 0 after a stop command: the wheels
+//                stop well within the model's lag
+// Retn:  1 while the encoder can be used, 0 once it has failed
+//-------------------------------------------------------------------------
+{
+    if(count != kf->count)
+    {
+        kf->idle = 0;
+    }
+    else
+    {
+        kf->idle += model;
+    }
+    if(kf->idle >= ENC_FAULT_TRAVEL)
+    {
+        kf->fault = 1;
+    }
+    return !kf->fault;
+}
+
+int32_t KalmanMeasure(Kalman * kf, int32_t count, int32_t dist)
+//-------------------------------------------------------------------------
+// Func:  Correct the distance with the encoder, once per averaging period
+//        before KalmanVel. The gains are the filter's steady state ones,
+//        precomputed by kalgen (kalgain.h), so the update is a few shifts
+//        and adds, and so is the encoder count's constant multiply.
+// Args:  kf    - filter state
+//        count - encoder count now (EncoderDistance)
+//        dist  - distance estimate now
+// Retn:  corrected distance
+//-------------------------------------------------------------------------
+{
+    kf->meas += FIX_MUL_CONST(count - kf->count, ENC_DIST_PER_COUNT);
+    kf->count = count;
+
+    kf->innov = kf->meas - dist;
+    kf->bias -= SHIFT_ROUND(kf->innov, KAL_B_SHIFT - KAL_BIAS_FRAC);
+    return dist + SHIFT_ROUND(kf->innov, KAL_D_SHIFT);
+}
+
+int32_t KalmanVel(Kalman * kf, int16_t accel, int32_t vInit)
+//-------------------------------------------------------------------------
+// Func:  Integrate one averaged acceleration into the velocity like
+//        NewVel, less the residual bias, with the correction from the last
+//        KalmanMeasure. The fraction of a count of bias left over is
+//        carried to the next period.
+// Args:  kf    - filter state
+//        accel - bias corrected average acceleration (BiasCorrect)
+//        vInit - velocity before the update
+// Retn:  new velocity
+//-------------------------------------------------------------------------
+{
+    kf->carry += (int32_t)((uint32_t)(int32_t)accel << KAL_BIAS_FRAC) - kf->bias;
+    vInit += (kf->carry >> KAL_BIAS_FRAC) + SHIFT_ROUND(kf->innov, KAL_V_SHIFT);
+    kf->carry &= (1L << KAL_BIAS_FRAC) - 1;
+    return vInit;
+}
+
+void EstInit(Estimator * est, uint8_t mode, int32_t count)
+//-------------------------------------------------------------------------
+// Func:  Start the estimate at rest, with no bias known
+// Args:  est   - estimator state
+//        mode  - EST_ACCEL, EST_MODEL or EST_KALMAN
+//        count - encoder count now (EncoderDistance)
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    est->avg.sum = 0;
+    est->avg.count = 0;
+    est->bias.bias = 0;
+    est->bias.carry = 0;
+    est->bias.still = 0;
+    KalmanInit(&est->kal, count);
+    est->vel = 0;
+    est->dist = 0;
+    est->mode = mode;
+    est->encFault = 0;
+}
+
+void EstUpdate(Estimator * est, uint8_t biasMode, int32_t count,
+               int32_t model, uint8_t driving)
+//-------------------------------------------------------------------------
+// Func:  Update the velocity once per averaging period, when AvgAddSample
+//        on est->avg returns 1: the bias corrected average goes through
+//        the selected estimator, the Kalman filter only while KalmanCheck
+//        passes and the drive model's filter after, then the velocity is
+//        limited to the drive's top speed and held at zero at rest. main
+//        and host/replay both run it.
+// Args:  est      - estimator state
+//        biasMode - BIAS_DRIVING, BIAS_STEADY or BIAS_STOPPED
+//        count    - encoder count now (EncoderDistance)
+//        model    - drive model speed along the leg (SpeedCtlModel),
+//                   negative backing up
+//        driving  - 1 while a drive command is in effect, 0 after a stop
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    int16_t accel = BiasCorrect(&est->bias, &est->avg, biasMode);
+
+    if(est->mode == EST_KALMAN &&
+       KalmanCheck(&est->kal, count, driving ? (model < 0 ? -model : model) : 0))
+    {
+        est->dist = KalmanMeasure(&est->kal, count, est->dist);
+        est->vel = KalmanVel(&est->kal, accel, est->vel);
+    }
+    else if(est->mode != EST_ACCEL)     // the drive model, also when the
+    {                                   // encoder has failed
+        est->encFault = (est->mode == EST_KALMAN);
+        est->vel = CompVel(accel, est->vel, model);
+    }
+    else
+    {
+        est->vel = NewVel(accel, est->vel);
+    }
+    est->vel = SpeedCtlLimit(est->vel);
+    if(est->bias.still >= STILL_WINDOWS)
+    {
+        est->vel = 0;                   // at rest, zero velocity update
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ *  estimator.h
+ *  Velocity and distance estimation from averaged accelerometer samples. This
+ *  module does not touch any registers so it can also be built and run on a
+ *  PC against recorded traces (see host/replay).
+ *
+ *  Version 1: 10/19/26 - moved NewVel/NewDist and sample averaging out of
+ *                        main.c
+ *             10/19/26 - units and averaging from config.h, no multiply or
+ *                        divide
+ *             10/19/26 - added BrakeDist for the predictive stop
+ *             10/19/26 - online bias estimation and stillness detection
+ *             10/19/26 - samples can stand for several ticks
+ *             10/19/26 - sample to sample activity left to the sensor's
+ *                        transient engine
+ *             10/19/26 - steady state Kalman filter with the wheel encoder
+ *             10/19/26 - complementary filter with the drive model
+ *             10/19/26 - constant multiplies from fixmath
+ *             10/19/26 - encoder plausibility check, KalmanCheck
+ *             10/19/26 - control loop's update in EstUpdate, shared with
+ *                        host/replay
+ */
+
+#ifndef ESTIMATOR_H_
+#define ESTIMATOR_H_
+
+#include "../config.h"
+#include "kalgain.h"
+#include "stdint.h"
+
+// running sum of raw samples, reduced to an average every AVG_SAMPLES
+typedef struct
+{
+    int16_t sum;        // sum of sign extended samples
+    uint8_t count;      // number of ticks in sum
+} SampleAvg;
+
+// what the drive is doing, for BiasCorrect
+#define BIAS_DRIVING    0   // accelerating, nothing is known
+#define BIAS_STEADY     1   // holding a steady speed, acceleration is 0
+#define BIAS_STOPPED    2   // motors stopped, may still be coasting, no
+                            // jolt seen by the sensor
+
+// accelerometer bias estimate and stillness detection
+typedef struct
+{
+    int32_t bias;       // bias, sample sums << BIAS_STEADY_SHIFT
+    int32_t carry;      // corrected acceleration not yet returned
+    uint8_t still;      // consecutive quiet averaging periods, saturates
+} BiasEst;
+
+// how the velocity and distance are estimated
+#define EST_ACCEL       0   // accelerometer alone, NewVel
+#define EST_MODEL       1   // complementary filter with the drive model,
+                            // CompVel
+#define EST_KALMAN      2   // Kalman filter with the wheel encoder,
+                            // KalmanMeasure and KalmanVel
+
+// fraction bits of the Kalman filter's bias
+#define KAL_BIAS_FRAC   8
+
+// Kalman filter correcting the velocity and distance with the wheel encoder
+typedef struct
+{
+    int32_t meas;       // encoder distance since KalmanStart, distance units
+    int32_t count;      // encoder count at the last measurement
+    int32_t innov;      // last measurement less the estimate, distance units
+    int32_t bias;       // residual accelerometer bias, counts << KAL_BIAS_FRAC
+    int32_t carry;      // bias not yet taken off the velocity
+    int32_t idle;       // drive model travel since the last count,
+                        // speeds summed per period
+    uint8_t fault;      // the encoder failed KalmanCheck
+} Kalman;
+
+// the control loop's estimate along the travel axis
+typedef struct
+{
+    SampleAvg avg;      // samples of the averaging period
+    BiasEst bias;       // accelerometer bias and stillness
+    Kalman kal;         // encoder correction, EST_KALMAN
+    int32_t vel;        // velocity
+    int32_t dist;       // distance along the leg, NewDist every tick
+    uint8_t mode;       // EST_ACCEL, EST_MODEL or EST_KALMAN
+    uint8_t encFault;   // the encoder failed, on the drive model since
+} Estimator;
+
+int16_t SignExtend12(int16_t raw);
+uint8_t AvgAddSample(SampleAvg * avg, int16_t raw, uint8_t shift);
+int16_t AvgTake(SampleAvg * avg);
+int16_t BiasCorrect(BiasEst * est, SampleAvg * avg, uint8_t mode);
+int32_t NewVel(int32_t accel, int32_t vInit);
+int32_t NewDist(int32_t vel, int32_t currDist, uint8_t shift);
+int32_t BrakeDist(int32_t vel);
+int32_t CompVel(int16_t accel, int32_t vInit, int32_t model);
+void KalmanInit(Kalman * kf, int32_t count);
+void KalmanStart(Kalman * kf, int32_t count);
+uint8_t KalmanCheck(Kalman * kf, int32_t count, int32_t model);
+int32_t KalmanMeasure(Kalman * kf, int32_t count, int32_t dist);
+int32_t KalmanVel(Kalman * kf, int16_t accel, int32_t vInit);
+void EstInit(Estimator * est, uint8_t mode, int32_t count);
+void EstUpdate(Estimator * est, uint8_t biasMode, int32_t count,
+               int32_t model, uint8_t driving);
+
+#endif
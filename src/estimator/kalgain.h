@@ -0,0 +1,20 @@
+/*
+ *  kalgain.h
+ *  Steady state Kalman gains, generated by host/gen/kalgen.c from the
+ *  noise model in config.h. Do not edit, rebuild the kalman-gains target
+ *  instead.
+ *
+ *  Optimal gains 0.1773, 0.645/s, 0.15/s^2, rounded 0.2500, 0.586/s, 0.17/s^2.
+ *  Steady state error, rms: distance 0.88 mm, velocity 4.5 mm/s and
+ *  bias 4.2 mm/s^2 (optimal 0.84 mm, 4.3 mm/s, 4.2 mm/s^2).
+ */
+
+#ifndef KALGAIN_H_
+#define KALGAIN_H_
+
+// gains 2^-n per distance unit of innovation
+#define KAL_D_SHIFT     2       // distance units
+#define KAL_V_SHIFT     9       // velocity units
+#define KAL_B_SHIFT     16      // accelerometer counts, subtracted
+
+#endif
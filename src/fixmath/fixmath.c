@@ -0,0 +1,179 @@
+/*
+ *  fixmath.c
+ *  Integer and fixed point arithmetic without a multiplier, see fixmath.h.
+ *
+ *  The multiplies work on magnitudes and fix the sign afterwards, so the
+ *  shift and add loop only runs for the bits the smaller magnitude has.
+ *  Products are rounded half away from zero, and the one product that
+ *  does not fit, -1 times -1, saturates.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include "fixmath.h"
+#include "stdint.h"
+
+uint32_t FixMulU16(uint16_t a, uint16_t b)
+//-------------------------------------------------------------------------
+// Func:  16 by 16 bit unsigned multiply, one shift and add per bit of the
+//        smaller operand up to its last set bit
+// Args:  a, b - factors
+// Retn:  a * b
+//-------------------------------------------------------------------------
+{
+    uint32_t x;
+    uint32_t p = 0;
+
+    if(a < b)                       // loop over the shorter one
+    {
+        x = b;
+        b = a;
+    }
+    else
+    {
+        x = a;
+    }
+    while(b != 0)
+    {
+        if(b & 1)
+        {
+            p += x;
+        }
+        x <<= 1;
+        b >>= 1;
+    }
+    return p;
+}
+
+int16_t FixAddQ15(int16_t a, int16_t b)
+//-------------------------------------------------------------------------
+// Func:  Add, saturating at Q15_MIN and Q15_MAX
+// Args:  a, b - addends
+// Retn:  a + b, saturated
+//-------------------------------------------------------------------------
+{
+    int16_t s = (int16_t)((uint16_t)a + (uint16_t)b);
+
+    if(((a ^ s) & (b ^ s)) < 0)     // both addends differ in sign from
+    {                               // the sum, it wrapped
+        s = (a < 0) ? Q15_MIN : Q15_MAX;
+    }
+    return s;
+}
+
+int32_t FixAddQ31(int32_t a, int32_t b)
+//-------------------------------------------------------------------------
+// Func:  Add, saturating at Q31_MIN and Q31_MAX
+// Args:  a, b - addends
+// Retn:  a + b, saturated
+//-------------------------------------------------------------------------
+{
+    int32_t s = (int32_t)((uint32_t)a + (uint32_t)b);
+
+    if(((a ^ s) & (b ^ s)) < 0)
+    {
+        s = (a < 0) ? Q31_MIN : Q31_MAX;
+    }
+    return s;
+}
+
+int16_t FixMulQ15(int16_t a, int16_t b)
+//-------------------------------------------------------------------------
+// Func:  Q15 multiply, rounded half away from zero, saturating
+// Args:  a, b - Q15 factors
+// Retn:  a * b, Q15
+//-------------------------------------------------------------------------
+{
+    uint16_t ua = (a < 0) ? 0U - (uint16_t)a : (uint16_t)a;
+    uint16_t ub = (b < 0) ? 0U - (uint16_t)b : (uint16_t)b;
+    uint32_t p = (FixMulU16(ua, ub) + 0x4000) >> 15;
+
+    if((a ^ b) < 0)
+    {
+        return (int16_t)(0U - (uint16_t)p);     // at most 2^15, fits
+    }
+    return (p > Q15_MAX) ? Q15_MAX : (int16_t)p;
+}
+
+int32_t FixMulQ31(int32_t a, int32_t b)
+//-------------------------------------------------------------------------
+// Func:  Q31 multiply, rounded half away from zero, saturating. The 62
+//        bit product of the magnitudes is put together from four 16 bit
+//        ones.
+// Args:  a, b - Q31 factors
+// Retn:  a * b, Q31
+//-------------------------------------------------------------------------
+{
+    uint32_t ua = (a < 0) ? 0UL - (uint32_t)a : (uint32_t)a;
+    uint32_t ub = (b < 0) ? 0UL - (uint32_t)b : (uint32_t)b;
+    uint32_t ll = FixMulU16((uint16_t)ua, (uint16_t)ub);
+    uint32_t lh = FixMulU16((uint16_t)ua, (uint16_t)(ub >> 16));
+    uint32_t hl = FixMulU16((uint16_t)(ua >> 16), (uint16_t)ub);
+    uint32_t hi = FixMulU16((uint16_t)(ua >> 16), (uint16_t)(ub >> 16));
+    uint32_t mid = (ll >> 16) + (lh & 0xFFFF) + (hl & 0xFFFF);
+    uint32_t lo = (ll & 0xFFFF) | (mid << 16);
+    uint32_t p;
+
+    hi += (lh >> 16) + (hl >> 16) + (mid >> 16);
+    lo += 0x40000000UL;             // round at bit 30
+    if(lo < 0x40000000UL)
+    {
+        hi++;
+    }
+    p = (hi << 1) | (lo >> 31);     // bits 31 to 62
+
+    if((a ^ b) < 0)
+    {
+        return (int32_t)(0UL - p);  // at most 2^31, fits
+    }
+    return (p > Q31_MAX) ? Q31_MAX : (int32_t)p;
+}
+
+uint16_t FixISqrt(uint32_t v)
+//-------------------------------------------------------------------------
+// Func:  Integer square root, bit by bit with shifts and subtracts
+// Args:  v - value
+// Retn:  floor(sqrt(v))
+//-------------------------------------------------------------------------
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while(bit > v)
+    {
+        bit >>= 2;
+    }
+    while(bit != 0)
+    {
+        if(v >= root + bit)
+        {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint16_t)root;
+}
+
+uint16_t FixMag3(const int16_t * v)
+//-------------------------------------------------------------------------
+// Func:  Length of a vector, such as a sign extended accelerometer
+//        reading. Three squares of at most 2^30 fit in 32 bits.
+// Args:  v - 3 element vector
+// Retn:  floor(|v|)
+//-------------------------------------------------------------------------
+{
+    uint32_t sum = 0;
+    uint8_t i;
+
+    for(i = 0; i < 3; i++)
+    {
+        uint16_t m = (v[i] < 0) ? 0U - (uint16_t)v[i] : (uint16_t)v[i];
+        sum += FixMulU16(m, m);
+    }
+    return FixISqrt(sum);
+}
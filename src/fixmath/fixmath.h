@@ -0,0 +1,85 @@
+/*
+ *  fixmath.h
+ *  Integer and fixed point arithmetic without a multiplier. The F2274 has
+ *  none, so a * b goes to the compiler's shift and add library routine,
+ *  which loops over all 32 bits of a long operand whatever its value.
+ *
+ *  Multiplying and dividing by a constant are macros that the compiler
+ *  folds into a fixed sequence of shifts and adds, one shift per bit of
+ *  the constant and one add per set bit. The operands are evaluated
+ *  several times and must not have side effects. The rest are functions:
+ *  a 16 by 16 bit multiply that stops at the last set bit, saturating Q15
+ *  and Q31 add and multiply, and an integer square root. This module does
+ *  not touch any registers; host/bench/fixcheck.c compares it bit for bit
+ *  against plain C arithmetic.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#ifndef FIXMATH_H_
+#define FIXMATH_H_
+
+#include "stdint.h"
+
+// one Horner step of a constant multiply: the product of the bits above b
+// doubled, plus x if bit b of k is set
+#define FIX_MUL_STEP(p, x, k, b)    (((p) << 1) + ((((k) >> (b)) & 1) ? (x) : 0))
+
+// x * k modulo 2^32 for a constant 0 <= k < 2^16, unsigned
+#define FIX_MULU_CONST(x, k)                                                 \
+    FIX_MUL_STEP(FIX_MUL_STEP(FIX_MUL_STEP(FIX_MUL_STEP(                     \
+    FIX_MUL_STEP(FIX_MUL_STEP(FIX_MUL_STEP(FIX_MUL_STEP(                     \
+    FIX_MUL_STEP(FIX_MUL_STEP(FIX_MUL_STEP(FIX_MUL_STEP(                     \
+    FIX_MUL_STEP(FIX_MUL_STEP(FIX_MUL_STEP(FIX_MUL_STEP((uint32_t)0,         \
+    (uint32_t)(x), k, 15), (uint32_t)(x), k, 14), (uint32_t)(x), k, 13),     \
+    (uint32_t)(x), k, 12), (uint32_t)(x), k, 11), (uint32_t)(x), k, 10),     \
+    (uint32_t)(x), k, 9), (uint32_t)(x), k, 8), (uint32_t)(x), k, 7),        \
+    (uint32_t)(x), k, 6), (uint32_t)(x), k, 5), (uint32_t)(x), k, 4),        \
+    (uint32_t)(x), k, 3), (uint32_t)(x), k, 2), (uint32_t)(x), k, 1),        \
+    (uint32_t)(x), k, 0)
+
+// x * k for a signed 32 bit x, two's complement wraps like the unsigned
+// product, so it is exact wherever x * k fits in 32 bits
+#define FIX_MUL_CONST(x, k)     ((int32_t)FIX_MULU_CONST((int32_t)(x), k))
+
+// ceil(log2(d)) for a constant 1 <= d < 2^16
+#define FIX_CLOG2(d)    ((d) > 32768L ? 16 : (d) > 16384 ? 15 : (d) > 8192 ? 14 : \
+                         (d) > 4096 ? 13 : (d) > 2048 ? 12 : (d) > 1024 ? 11 :   \
+                         (d) > 512 ? 10 : (d) > 256 ? 9 : (d) > 128 ? 8 :        \
+                         (d) > 64 ? 7 : (d) > 32 ? 6 : (d) > 16 ? 5 :            \
+                         (d) > 8 ? 4 : (d) > 4 ? 3 : (d) > 2 ? 2 : (d) > 1 ? 1 : 0)
+
+// reciprocal of d less 2^16, 2^16 (2^l - d) / d + 1, below 2^16
+#define FIX_DIV_RECIP(d)    ((uint16_t)((((uint32_t)1 << FIX_CLOG2(d)) - (d)) * \
+                                        65536UL / (d) + 1))
+
+// x / d for a 16 bit unsigned x and a constant 1 <= d < 2^16, truncated
+// like C, from the high word of x times the reciprocal (Granlund and
+// Montgomery, division by invariant integers)
+#define FIX_DIVU_HI(x, d)   ((uint16_t)(FIX_MULU_CONST((uint16_t)(x), FIX_DIV_RECIP(d)) >> 16))
+#define FIX_DIVU_CONST(x, d)                                                 \
+    ((uint16_t)((FIX_DIVU_HI(x, d) +                                         \
+                 (((uint16_t)(x) - FIX_DIVU_HI(x, d)) >> (FIX_CLOG2(d) > 0))) \
+                >> (FIX_CLOG2(d) > 0 ? FIX_CLOG2(d) - 1 : 0)))
+
+// x / d for a 16 bit signed x, truncated toward 0 like C
+#define FIX_DIV_CONST(x, d)                                                  \
+    ((int16_t)((x) < 0 ? 0U - FIX_DIVU_CONST(0U - (uint16_t)(x), d) :        \
+                         FIX_DIVU_CONST(x, d)))
+
+// Q15 (1 sign bit, 15 fraction bits) and Q31 limits
+#define Q15_MAX     INT16_MAX
+#define Q15_MIN     INT16_MIN
+#define Q31_MAX     INT32_MAX
+#define Q31_MIN     INT32_MIN
+#define Q15_ONE     Q15_MAX     // closest to 1.0
+
+uint32_t FixMulU16(uint16_t a, uint16_t b);
+int16_t FixAddQ15(int16_t a, int16_t b);
+int32_t FixAddQ31(int32_t a, int32_t b);
+int16_t FixMulQ15(int16_t a, int16_t b);
+int32_t FixMulQ31(int32_t a, int32_t b);
+uint16_t FixISqrt(uint32_t v);
+uint16_t FixMag3(const int16_t * v);
+
+#endif
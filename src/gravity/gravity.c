@@ -0,0 +1,158 @@
+/*
+ *  gravity.c
+ *  Gravity compensation for the accelerometer, see gravity.h.
+ *
+ *  With g the measured gravity vector and n its length, the travel axis is
+ *
+ *      t = (x - (x.g / n^2) g) / |...|
+ *        = (h / n, -gx gy / (n h), -gx gz / (n h)),  h = sqrt(gy^2 + gz^2)
+ *
+ *  which is perpendicular to g. Each component is rounded to at most
+ *  GRAV_TERMS signed powers of two, so GravityProject needs only shifts and
+ *  adds, and the rounding's leftover projection of gravity is subtracted
+ *  as a constant.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - square root from fixmath
+ */
+
+#include "gravity.h"
+#include "../fixmath/fixmath.h"
+#include "stdint.h"
+
+#define GRAV_MIN_TERM   10  // smaller terms than 1 >> 10 only add rounding
+
+static void PowerTerms(int32_t c, int8_t * term)
+//-------------------------------------------------------------------------
+// Func:  Round a coefficient to GRAV_TERMS signed powers of two, each term
+//        taking the nearest power of two to what is left
+// Args:  c    - coefficient, GRAV_Q fraction bits, -1 to 1
+//        term - GRAV_TERMS terms, see Gravity
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint8_t i;
+
+    for(i = 0; i < GRAV_TERMS; i++)
+    {
+        int32_t mag = (c < 0) ? -c : c;
+        int8_t shift = GRAV_Q;      // smallest term is 1 >> GRAV_Q
+        int32_t p = 1;
+
+        // largest power of two not above mag, then the nearer of it and
+        // the next one up
+        while(p <= (mag >> 1) && shift > 0)
+        {
+            p <<= 1;
+            shift--;
+        }
+        if(mag - p > (p << 1) - mag && shift > 0)
+        {
+            p <<= 1;
+            shift--;
+        }
+        if(mag < (p >> 1) + 1 || shift > GRAV_MIN_TERM)
+        {
+            term[i] = 0;            // rounds to nothing
+            continue;
+        }
+        term[i] = (c < 0) ? -(shift + 1) : (shift + 1);
+        c += (c < 0) ? p : -p;
+    }
+}
+
+void GravityInit(Gravity * grav, const int32_t * sums, uint8_t shift)
+//-------------------------------------------------------------------------
+// Func:  Work out the travel axis from a gravity measurement. Runs once
+//        after power on, so it can multiply and divide.
+// Args:  grav  - projection to set up
+//        sums  - sum of 2^shift sign extended readings of x, y and z,
+//                taken standing still
+//        shift - log2 of the readings summed
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    int32_t g[3];
+    int32_t n;
+    int32_t h;
+    int32_t s;
+    int32_t off = 0;
+    uint8_t i, j;
+
+    // gravity with 2 fraction bits, short enough to square in 32 bits
+    for(i = 0; i < 3; i++)
+    {
+        g[i] = sums[i] >> (shift - 2);
+    }
+    h = FixISqrt(g[1] * g[1] + g[2] * g[2]);
+    n = FixISqrt(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+    if(h == 0)
+    {
+        h = 1;                      // x along gravity, no travel axis, the
+        n = 1;                      // projection comes out as 0
+    }
+
+    s = g[0] * (1L << GRAV_Q) / n;  // x component of gravity, sine of pitch
+    PowerTerms(h * (1L << GRAV_Q) / n, grav->term[0]);
+    PowerTerms(-(s * g[1]) / h, grav->term[1]);
+    PowerTerms(-(s * g[2]) / h, grav->term[2]);
+
+    // what the rounded axis still sees of gravity
+    for(i = 0; i < 3; i++)
+    {
+        for(j = 0; j < GRAV_TERMS; j++)
+        {
+            int8_t k = grav->term[i][j];
+            if(k > 0)
+            {
+                off += g[i] >> (k - 1);
+            }
+            else if(k < 0)
+            {
+                off -= g[i] >> (-k - 1);
+            }
+        }
+    }
+    grav->offset = (int16_t)off;
+}
+
+int16_t GravityProject(const Gravity * grav, const int16_t * raw)
+//-------------------------------------------------------------------------
+// Func:  Acceleration along the travel axis for one reading
+// Args:  grav - projection from GravityInit
+//        raw  - x, y, z as returned by MMA8450ReadXYZ
+// Retn:  acceleration in counts, gravity removed, -2048 to 2047
+//-------------------------------------------------------------------------
+{
+    int16_t a = -grav->offset;      // 2 fraction bits, like the offset
+    uint8_t i, j;
+
+    for(i = 0; i < 3; i++)
+    {
+        int16_t v = ((raw[i] > 0x07FF) ? (raw[i] - 4096) : raw[i]) * 4;
+
+        for(j = 0; j < GRAV_TERMS; j++)
+        {
+            int8_t k = grav->term[i][j];
+            if(k > 0)
+            {
+                a += v >> (k - 1);
+            }
+            else if(k < 0)
+            {
+                a -= v >> (-k - 1);
+            }
+        }
+    }
+
+    a = (a + 2) >> 2;               // back to whole counts, rounded
+    if(a > 2047)
+    {
+        a = 2047;
+    }
+    else if(a < -2048)
+    {
+        a = -2048;
+    }
+    return a;
+}
@@ -0,0 +1,34 @@
+/*
+ *  gravity.h
+ *  Gravity compensation for the accelerometer. The gravity vector is
+ *  measured while the robot stands still, and every sample is projected
+ *  onto the travel axis: the sensor's x axis with its gravity component
+ *  removed. A tilted mounting then no longer scales the forward
+ *  acceleration or leaks acceleration into z, and gravity cancels on all
+ *  three axes. The projection is a sum of shifted samples, no multiply.
+ *  This module does not touch any registers.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#ifndef GRAVITY_H_
+#define GRAVITY_H_
+
+#include "../config.h"
+#include "stdint.h"
+
+#define GRAV_TERMS  2       // power of two terms per axis
+#define GRAV_Q      14      // fraction bits of the travel axis before rounding
+
+// travel axis as signed power of two terms: term k means add (axis >> (k - 1))
+// for k > 0, subtract (axis >> (-k - 1)) for k < 0, nothing for 0
+typedef struct
+{
+    int8_t term[3][GRAV_TERMS];
+    int16_t offset;         // projection of gravity, 1/4 counts
+} Gravity;
+
+void GravityInit(Gravity * grav, const int32_t * sums, uint8_t shift);
+int16_t GravityProject(const Gravity * grav, const int16_t * raw);
+
+#endif
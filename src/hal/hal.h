@@ -0,0 +1,30 @@
+/*
+ *  hal.h
+ *  Hardware abstraction for the MSP430 registers. Firmware includes this
+ *  instead of msp430x22x4.h so the same sources also build on a PC against
+ *  the simulated peripherals in host/hal (SIM_HOST defined by the host build).
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - msp430-elf-gcc register header
+ *             10/19/26 - RAM_ADDR
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+#if defined(SIM_HOST)
+#include "msp430_sim.h"
+#elif defined(__GNUC__)
+#include <msp430.h>         // msp430-elf-gcc, used for the cycle benchmarks
+#else
+#include "../msp430x22x4.h"
+#include <intrinsics.h>
+#endif
+
+// address of a RAM buffer as a 16 bit register value (ADC10SA), the
+// simulator maps the host's pointer to one
+#ifndef RAM_ADDR
+#define RAM_ADDR(p, size)   ((uint16_t)(p))
+#endif
+
+#endif
@@ -8,12 +8,17 @@
  *
  *  Version 1: 04/01/17 - Nathan Duprey
  *                      - added initialization and send cmd
+ *             10/19/26 - added I2CProbe
+ *             10/19/26 - data byte count
+ *             10/19/26 - registers read into bytes
  */
 
 #include "i2c.h"
-#include "../msp430x22x4.h"
+#include "../hal/hal.h"
 #include "stdint.h"
 
+static uint16_t bytes;      // data bytes sent and received, wraps
+
 void I2CInitMaster(void)
 //-------------------------------------------------------------------------
 // Func:  Configure I2C for master mode, SMCLK source
@@ -46,6 +51,27 @@ void I2CSetSlaveAddr(uint16_t addr)
     UCB0CTL1 &= ~UCSWRST;   // start i2c
 }
 
+uint8_t I2CProbe(void)
+//-------------------------------------------------------------------------
+// Func:  Check that the slave answers its address: send the address with
+//        the write bit and a stop, no data. Unlike the transfers below this
+//        does not hang when nothing acknowledges.
+// Args:  None
+// Retn:  1 if the slave acknowledged, 0 if not
+//-------------------------------------------------------------------------
+{
+    uint8_t nack;
+
+    while(UCB0STAT & UCBBUSY);      // wait for bus to be free
+    UCB0CTL1 |= UCTR | UCTXSTT;     // send start bit, slave addr, write bit
+    while(UCB0CTL1 & UCTXSTT);      // wait for the address to go out
+    UCB0CTL1 |= UCTXSTP;            // send stop bit
+    while(UCB0CTL1 & UCTXSTP);      // wait until stop bit is sent
+    nack = UCB0STAT & UCNACKIFG;
+    UCB0STAT &= ~UCNACKIFG;
+    return !nack;
+}
+
 void I2CSendByte(uint8_t data)
 //-------------------------------------------------------------------------
 // Func:  Send a single byte over I2C. Note: this is blocking until the bus
@@ -63,6 +89,7 @@ void I2CSendByte(uint8_t data)
 
     UCB0CTL1 |= UCTXSTP;            // send stop bit
     while(UCB0CTL1 & UCTXSTP);      // wait until stop bit is sent
+    bytes++;
 }
 
 void I2CSend(uint8_t * data, uint8_t length)
@@ -86,6 +113,7 @@ void I2CSend(uint8_t * data, uint8_t length)
     while(!(IFG2 & UCB0TXIFG));     // wait until tx buffer is empty
     UCB0CTL1 |= UCTXSTP;            // send stop bit
     while(UCB0CTL1 & UCTXSTP);      // wait until stop bit is sent
+    bytes += length;
 }
 
 void I2CSendRegister(uint8_t reg, uint8_t data)
@@ -108,6 +136,7 @@ void I2CSendRegister(uint8_t reg, uint8_t data)
 
     UCB0CTL1 |= UCTXSTP;            // send stop bit
     while(UCB0CTL1 & UCTXSTP);      // wait until stop bit is sent
+    bytes += 2;
 }
 
 uint8_t I2CReadRegister(uint8_t addr)
@@ -128,16 +157,17 @@ uint8_t I2CReadRegister(uint8_t addr)
     UCB0CTL1 |= UCTXNACK | UCTXSTP; // send NACK and stop
     while(!(IFG2 & UCB0RXIFG));     // wait for byte to be read
     uint8_t data = UCB0RXBUF;       // get data
+    bytes += 2;
 
     return data;
 }
 
-void I2CReadMultRegisters(uint8_t firstAddr, uint8_t numRegs, int16_t * retData)
+void I2CReadMultRegisters(uint8_t firstAddr, uint8_t numRegs, uint8_t * retData)
 //-------------------------------------------------------------------------
 // Func:  Read a specified number of registers starting from firstAddr
 // Args:  firstAddr - the addredd of the first register to read
 //        numRegs - the number of registers to read
-//        retData - a pointer to an array to store the read values
+//        retData - a pointer to a numRegs byte array for the values
 // Retn:  none
 //-------------------------------------------------------------------------
 {
@@ -161,4 +191,15 @@ void I2CReadMultRegisters(uint8_t firstAddr, uint8_t numRegs, int16_t * retData)
             UCB0CTL1 |= UCTXNACK | UCTXSTP; // send NACK and stop
         }
     }
+    bytes += 1 + numRegs;
+}
+
+uint16_t I2CBytes(void)
+//-------------------------------------------------------------------------
+// Func:  Data bytes the transfers above have moved, addresses not counted
+// Args:  None
+// Retn:  count since power on, wraps at 16 bits
+//-------------------------------------------------------------------------
+{
+    return bytes;
 }
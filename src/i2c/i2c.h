@@ -7,6 +7,9 @@
  *  MSP430x2xx USer Guide: http://www.ti.com/lit/ug/slau144j/slau144j.pdf
  *
  *  Version 1: 04/01/17 - Nathan Duprey
+ *             10/19/26 - added I2CProbe
+ *             10/19/26 - added I2CBytes
+ *             10/19/26 - registers read into bytes
  */
 
 #ifndef I2C_H_
@@ -16,10 +19,12 @@
 
 void I2CInitMaster(void);
 void I2CSetSlaveAddr(uint16_t addr);
+uint8_t I2CProbe(void);
 void I2CSendByte(uint8_t data);
 void I2CSend(uint8_t * data, uint8_t length);
 void I2CSendRegister(uint8_t reg, uint8_t data);
 uint8_t I2CReadRegister(uint8_t addr);
-void I2CReadMultRegisters(uint8_t firstAddr, uint8_t numRegs, int16_t * retData);
+void I2CReadMultRegisters(uint8_t firstAddr, uint8_t numRegs, uint8_t * retData);
+uint16_t I2CBytes(void);
 
 #endif
@@ -7,17 +7,51 @@
  *                  Chad Pollock
  */
 
-#include "msp430x22x4.h"
+#include "config.h"
+#include "hal/hal.h"
 #include "uart/uart.h"
 #include "mma8450q/mma8450q.h"
 #include "i2c/i2c.h"
+#include "estimator/estimator.h"
+#include "gravity/gravity.h"
+#include "speedctl/speedctl.h"
+#include "power/power.h"
+#include "encoder/encoder.h"
+#include "batt/batt.h"
+#include "boot/boot.h"
+#include "wdog/wdog.h"
+#include "duty/duty.h"
 #include "stdint.h"
 
 uint8_t forward[] = {105, 234};      // preset motor commands
 uint8_t stop[] = {0, 0};
 uint8_t reverse[] = {23, 149};
-int32_t fwdDist = 82000000;
-int32_t revDist = -90000000;
+int32_t fwdDist = DIST_FROM_MM(FWD_STOP_MM);    // stopping distances
+int32_t revDist = -DIST_FROM_MM(REV_STOP_MM);
+int32_t cruiseVel = SPEED_CRUISE_VEL;   // speed between the ramps
+uint8_t fwdBase[] = {64, 192};       // motor commands at zero speed, the
+uint8_t revBase[] = {64, 187};       // controller output is added to these
+uint16_t dwellWake;                  // SMCLK cycles from the end of the dwell
+                                     // to the first sample
+int32_t odometer;                    // wheel encoder counts since power on
+int32_t wheelStopVel[2];             // encoder speed when each stop command
+                                     // was sent
+uint8_t estMode = EST_KALMAN;        // estimator, EST_ACCEL, EST_MODEL
+                                     // (drive model) or EST_KALMAN (encoder)
+uint8_t encFault;                    // the encoder failed KalmanCheck and
+                                     // EST_MODEL took over
+uint8_t battComp = 1;                // scale the motor commands for the
+                                     // battery voltage
+MMA8450 mma[MMA_MAX_DEVICES];        // accelerometers, SA0 low and high
+uint8_t mmaCount;                    // how many answered, averaged
+volatile uint16_t ticks;             // loop ticks since power on, wraps
+uint16_t bootTicks;                  // ticks until the sensors sampled
+uint16_t firstMotion;                // tick of the first drive command,
+                                     // 0 until then
+uint8_t wdogMode = WDOG_SUPERVISE;   // watchdog use, WDOG_SUPERVISE (reset
+                                     // a stalled loop), WDOG_INTERVAL (time
+                                     // the battery conversions) or WDOG_OFF
+uint8_t wdogReset;                   // this start was a watchdog reset
 
 #pragma vector=TIMERA1_VECTOR
 #pragma type_attribute=__interrupt
@@ -26,162 +60,252 @@ void TimerA1Interrupt(void)
     switch(__even_in_range(TAIV, 10))
     {
         case TAIV_TAIFG:
-            // return to active mode
-            __bic_SR_register_on_exit(CPUOFF);
+            // return to active mode, from LPM1 or the LPM3 dwell
+            ticks++;
+            EncoderTick();
+            __bic_SR_register_on_exit(LPM3_bits);
             break;
         case TAIV_TACCR1:
+            EncoderEdge(ENC_A);     // wheel encoder, stay asleep
             break;
         case TAIV_TACCR2:
+            EncoderEdge(ENC_B);
             break;
         default:
             break;
     }
 }
 
-int32_t NewVel(int32_t accel, int32_t vInit, uint8_t tmsec)
-//-------------------------------------------------------------------------
-// Func:  Calculate total distance travelled given initial velocity
-// Args:  accel  - acceleration from accelerometer
-//        vInit  - initial velocity in units/msec (previously returned newVel)
-//        tmsec  - time period in miliseconds
-// Retn:  newVel - new velocity in units/dsec
-//-------------------------------------------------------------------------
+#pragma vector=ADC10_VECTOR
+#pragma type_attribute=__interrupt
+void ADC10Interrupt(void)
+{
+    BattBlock();        // a block of battery samples, stay asleep
+}
+
+#pragma vector=WDT_VECTOR
+#pragma type_attribute=__interrupt
+void WdtInterrupt(void)
 {
-    int32_t dVel = (accel * tmsec) / 10;    // change in velocity in units/dsec
-    int32_t newVel = dVel + vInit;          // new velocity after acceleration
-    return(newVel);
+    BattConvert();      // interval mode, a battery sample, stay asleep
 }
 
-int32_t NewDist(int32_t vel, int32_t currDist, uint8_t tmsec)
-//-------------------------------------------------------------------------
-// Func:  Calculate total distance travelled given velocity and time
-// Args:  vel      - velocity in units/msec (previously returned newVel)
-//        currDist - current distance travelled in units
-//        tmsec    - time period in miliseconds
-// Retn:  newDist  - new distance in units
-//-------------------------------------------------------------------------
+#pragma vector=PORT2_VECTOR
+#pragma type_attribute=__interrupt
+void Port2Interrupt(void)
 {
-    int32_t dDist = (vel * tmsec) / 10;      // change in distance
-    int32_t newDist = dDist + currDist;      // new distance
-    return(newDist);
+    // accelerometer INT1, a jolt during PowerStandby
+    P2IE &= ~MMA_INT1_P2;
+    __bic_SR_register_on_exit(LPM4_bits);
 }
 
 void main(void)
 {
-    WDTCTL = WDTPW | WDTHOLD;   // disable watchdog
+    int32_t gravSum[3];     // gravity measured at power on
+    Gravity grav;           // travel axis projection
+
+    WdogStart(WDOG_OFF);        // hold the watchdog until the loop runs
     DCOCTL = CALDCO_1MHZ;       // 1MHz DCO
     BCSCTL1 = CALBC1_1MHZ;
+    BCSCTL3 |= LFXT1S_2;        // ACLK from the VLO, no crystal fitted
     P1DIR |= 0x03;              // set led outputs
     P1OUT &= ~0x03;             // clear led outputs
 
     UARTInit();         // initialize uart
-    UARTSend(stop, 2);  // send stop command to robot
+    UARTSend(stop, 2);  // send stop command to robot, the safe state after
+                        // a watchdog reset as well
+    wdogReset = WdogFired();
     P1OUT |= 0x01;      // turn on red led while setting up accelerometer
-    MMA8450Init();      // initialize accelerometer
-    MMA8450SetZero();   // zero out accelerometer, dont move robot while happening
-    P1OUT &= ~0x01;     // turn off led after finished
+    if(wdogMode == WDOG_INTERVAL)
+    {
+        BattInit(BATT_ON_CALL);         // sample the battery on the
+        WdogStart(WDOG_INTERVAL);       // watchdog interval
+    }
+    else
+    {
+        BattInit(BATT_ON_TICK);         // or on the loop tick
+    }
 
-    TACCR0 = 3333;                          // 1 MHz / 3333 = 300Hz
+    TACCR0 = TICK_TACCR0;                   // SMCLK / (TACCR0 + 1) = TICK_HZ
     TACTL = TASSEL_2 | ID_0 | MC_1 | TAIE;  // SMCLK, div 1, Up mode
+    DutyInit(DUTY_BOOT);    // awake and asleep time from here
+
+    mmaCount = BootSensors(mma);    // as soon as they answer, the second
+    bootTicks = ticks;              // is optional
+    MMA8450ConfigTransient(&mma[0],
+                           TRANS_ELE | TRANS_ZTEFE | TRANS_YTEFE | TRANS_XTEFE,
+                           SEL_3, THS_FROM_MG(STILL_JOLT_MG) | DBCNTM,
+                           STILL_JOLT_SAMPLES);     // jolts latch on INT1
+    MMA8450RouteInterrupts(&mma[0], INT_TRANS, INT_TRANS, 0);   // active low
+    P2DIR &= ~MMA_INT1_P2;
+    P2IES |= MMA_INT1_P2;   // flag falling edges, the pin is polled through
+    P2IFG &= ~MMA_INT1_P2;  // P2IFG rather than interrupting
+    if(wdogReset)           // the loop hung and was reset, the robot may be
+    {                       // anywhere: no run before a nudge, red led on
+        PowerStandby(mma, mmaCount);
+    }
+    MMA8450ReadSum(mma, mmaCount, gravSum); // measure gravity, dont move
+                                            // robot while happening
+    GravityInit(&grav, gravSum, CAL_SHIFT);
+                        // red led stays on through the first rest
+    EncoderInit();      // count the wheel from here
 
     int16_t data[3];        // array for storing acceleration data
-    int16_t xAccel = 0;     // x component of acceleration
-    int32_t vel = 0;        // current velocity
-    int32_t dist = 0;       // distance travelled
-    uint8_t timeStep = 27;  // time step between averaged samples
-    int8_t step = 0;        // flag for what action is happening
-    uint8_t i = 0;          // sample counter
+    Estimator est;          // velocity and distance along the travel axis
+    int32_t model = 0;      // drive model speed along the leg
+    const uint8_t * sent = stop;    // motor commands in effect, before
+                                    // the battery scaling
+    int8_t step = 0;        // 0 rest at the start, 1 forward, 2 rest at the
+                            // finish line, 3 back to the start, 4 rest
+                            // there before the standby
+    uint8_t rest = 0;       // averaging periods spent in a rest step
+    SpeedCtl speedCtl;      // speed controller for the current leg
+    uint8_t motor[2];       // motor commands
+    uint8_t drive[2];       // and as sent, scaled for the battery
+    uint16_t scale;         // battery scale, Q8
+    uint8_t cmd;            // controller output
+    uint8_t mode;           // drive state for the bias estimate
+    uint8_t rate = 0;       // log2 of ticks per sample, 0 or SLOW_SHIFT
+    uint8_t nextRate = 0;   // rate from the next tick on
+    uint8_t i;
+
+    SpeedCtlInit(&speedCtl);
+    EstInit(&est, estMode, 0);  // the encoder counts from 0
+    if(wdogMode == WDOG_SUPERVISE)
+    {
+        WdogStart(WDOG_SUPERVISE);  // from here a stalled loop resets
+    }
 
     while(1)
     {
-        if(step == 0)   // drive forward, slowly increasing speed
+        WdogKick();         // once per tick, from the loop itself
+        P1OUT |= 0x02;
+        MMA8450ReadAvg(mma, mmaCount, data);    // read accelerometers
+        P1OUT &= ~0x02;
+
+        // sum samples along the travel axis until AVG_SAMPLES
+        if(AvgAddSample(&est.avg, GravityProject(&grav, data), rate))
         {
-            P1OUT |= 0x02;
-            MMA8450ReadXYZ(data);   // read accelerometer
-            // convert to 16 bit signed and sum samples
-            xAccel += (data[0] > 0x07FF) ? (data[0] - 4096) : data[0];
-            P1OUT &= ~0x02;
-            i += 1;                 // increment sample counter
-
-            if(i == 8)
+            if(step == 0 || step == 2 || step == 4)
             {
-                i = 0;                                  // reset sample counter
-                xAccel >>= 3;                           // divide by 8 to get average
-                //xAccel &= ~0x0003;                      // get rid of 2 LSBs for noise
-                vel = NewVel(xAccel, vel, timeStep);    // Find velocity and distance
-                dist = NewDist(vel, dist, timeStep);
-                xAccel = 0;
-
-                static uint8_t fwdSpeed[] = {64, 192};
-                UARTSend(fwdSpeed, 2);  // increase speed gradually and send it
-                fwdSpeed[0] += 1;
-                fwdSpeed[1] += 1;
-
-                if(fwdSpeed[0] == 116)
-                {
-                    step = 1;   // move to next step
+                mode = BIAS_STOPPED;
+                if(P2IFG & MMA_INT1_P2)     // the sensor saw a jolt, not
+                {                           // at rest yet
+                    mode = BIAS_DRIVING;
+                    P2IFG &= ~MMA_INT1_P2;
+                    MMA8450ReadEvents(&mma[0]); // release INT1
                 }
             }
-        }
-        else if(step == 1)    // Stop at 12 meters
-        {
-            dist = NewDist(vel, dist, timeStep);    // calculate distance
-            if(dist >= fwdDist)
+            else
             {
-                UARTSend(stop, 2);  // stop robot
-                P1OUT |= 0x01;
-                MMA8450SetZero();   // recalibrate at opposite end
-                P1OUT &= ~0x01;
-                step = 2;           // move to next step
-                vel = 0;            // reset velocity
-                dist = 0;           // reset distance
+                mode = SpeedCtlSteady(&speedCtl) ? BIAS_STEADY : BIAS_DRIVING;
             }
-        }
-        else if(step == 2)
-        {
-            P1OUT |= 0x02;
-            MMA8450ReadXYZ(data);   // read accelerometer
-            // convert to 16 bit signed and sum samples
-            xAccel += (data[0] > 0x07FF) ? (data[0] - 4096) : data[0];
-            P1OUT &= ~0x02;
-            i += 1;                 // increment sample counter
-
-            if(i == 8)
+            odometer = EncoderDistance();   // often enough for its 16 bit count
+            scale = BattScale();            // from the latest block
+            model = SpeedCtlModel(model, sent);
+            EstUpdate(&est, mode, odometer, step == 3 ? -model : model,
+                      sent != stop);        // find velocity
+            encFault = est.encFault;
+
+            if(step == 1)   // drive forward under speed control
             {
-                i = 0;                                  // reset sample counter
-                xAccel >>= 3;                           // divide by 8 to get average
-                //xAccel &= ~0x0003;                      // get rid of 2 LSBs for noise
-                vel = NewVel(xAccel, vel, timeStep);    // Find velocity and distance
-                dist = NewDist(vel, dist, timeStep);
-                xAccel = 0;
-
-                static uint8_t revSpeed[] = {64, 187};
-                UARTSend(revSpeed, 2);  // gradually increase speed and send it
-                revSpeed[0] -= 1;
-                revSpeed[1] -= 1;
-
-                if(revSpeed[0] == 13)
+                cmd = SpeedCtlUpdate(&speedCtl, est.vel, cruiseVel,
+                                     fwdDist - est.dist - BrakeDist(est.vel));
+                motor[0] = fwdBase[0] + cmd;
+                motor[1] = fwdBase[1] + cmd;
+                SpeedCtlCompensate(motor, drive, battComp ? scale : BATT_SCALE_ONE);
+                UARTSend(drive, 2);     // send the new speed
+                sent = motor;
+                if(firstMotion == 0)
                 {
-                    step = 3;   // move to next step
+                    firstMotion = ticks;    // boot metric
+                }
+            }
+            else if(step == 3)  // then back to the start
+            {
+                cmd = SpeedCtlUpdate(&speedCtl, -est.vel, cruiseVel,
+                                     est.dist + BrakeDist(est.vel) - revDist);
+                motor[0] = revBase[0] - cmd;
+                motor[1] = revBase[1] - cmd;
+                SpeedCtlCompensate(motor, drive, battComp ? scale : BATT_SCALE_ONE);
+                UARTSend(drive, 2);     // send the new speed
+                sent = motor;
+            }
+            else if(est.bias.still >= STILL_WINDOWS + REST_WINDOWS ||
+                    ++rest >= REST_MAX_WINDOWS)
+            {
+                // rested long enough to learn the bias, or never came to
+                // rest, start the next leg from here
+                P1OUT &= ~0x01;
+                step++;             // move to next step
+                if(step == 5)       // run done, wait for a nudge on the
+                {                   // chassis and go again
+                    PowerStandby(mma, mmaCount);
+                    EncoderResync();    // Timer A was stopped
+                    AvgTake(&est.avg);  // drop the samples from before
+                    est.bias.still = 0; // rest again from here
+                    P1OUT |= 0x01;  // red led through the first rest
+                    step = 0;
                 }
+                rest = 0;
+                est.vel = 0;        // reset velocity
+                est.dist = 0;       // reset distance
+                KalmanStart(&est.kal, odometer);
+                SpeedCtlInit(&speedCtl);
+            }
+
+            // slow while cruising at a steady speed, full rate on the ramps,
+            // near the lines and at rest, where the bias is learnt
+            if((step == 1 || step == 3) && SpeedCtlSteady(&speedCtl))
+            {
+                nextRate = SLOW_SHIFT;
+            }
+            else
+            {
+                nextRate = 0;
             }
         }
-        else if(step == 3)     // Stop at starting line
+
+        est.dist = NewDist(est.vel, est.dist, rate);    // calculate distance
+
+        if(nextRate != rate)    // only changes at the end of an averaging period
         {
-            dist = NewDist(vel, dist, timeStep);
-            if(dist <= revDist)
+            rate = nextRate;
+            for(i = 0; i < mmaCount; i++)
             {
-                UARTSend(stop, 2);  // send stop command
-                P1OUT |= 0x01;
-                while(1)            // done, loop 5ever and blink leds
-                {
-                  P1OUT ^= 0x03;
-                  volatile uint32_t j = 0;
-                  for(j = 0; j < 10000; j++);
-                }
+                MMA8450SetRate(&mma[i], rate ? ACCEL_SLOW_RATE : ACCEL_DATA_RATE);
             }
+            TACCR0 = rate ? SLOW_TACCR0 : TICK_TACCR0;  // TAR is still below
+        }                                               // either period
+
+        if(step == 1 && est.dist + BrakeDist(est.vel) >= fwdDist)  // would
+        {                                               // coast past the finish
+            UARTSend(stop, 2);  // stop robot
+            sent = stop;
+            P1OUT |= 0x01;      // red led while resting
+            wheelStopVel[0] = EncoderSpeed();
+            DutyPhase(2);       // the dwell is part of the rest
+            dwellWake = PowerDwell(mma, mmaCount);  // wait at the finish
+                                                    // line, asleep
+            EncoderResync();    // Timer A ran from ACLK
+            AvgTake(&est.avg);  // drop the samples from before
+            est.vel = 0;        // stopped long ago
+            model = 0;
+            rate = 0;           // PowerDwell leaves the full rate
+            nextRate = 0;
+            step = 2;           // rest, then back up
+        }
+        else if(step == 3 && est.dist + BrakeDist(est.vel) <= revDist) // Stop
+        {                                                   // at starting line
+            UARTSend(stop, 2);  // send stop command
+            sent = stop;
+            P1OUT |= 0x01;      // red led while resting
+            wheelStopVel[1] = EncoderSpeed();
+            step = 4;           // rest, then standby
         }
 
+        DutySleep();
         __bis_SR_register(LPM1_bits | GIE); // go to sleep
+        DutyWake(step);
     }
 }
@@ -7,89 +7,370 @@
  *
  *  Version 1: 04/01/17 - Nathan Duprey
  *             04/03/17 - wrote calibration fucntion
+ *             10/19/26 - calibration averages CAL_SAMPLES readings
+ *             10/19/26 - added MMA8450ReadSum
+ *             10/19/26 - added MMA8450SetRate
+ *             10/19/26 - transient and motion engines, interrupt routing
+ *             10/19/26 - added MMA8450Standby, MMA8450ReadStatus
+ *             10/19/26 - added MMA8450AutoSleep
+ *             10/19/26 - per device context with register shadows, added
+ *                        MMA8450ReadAvg for two sensors on the bus
+ *             10/19/26 - no calibrated delays, the boot sequencer polls for
+ *                        the sensors and the readings wait for ZYXDR
+ *             10/19/26 - registers read into bytes
+ *             10/19/26 - corrected when ZYXDR clears
+ *             10/19/26 - removed MMA8450SetZero, nothing calls it since
+ *                        gravity is measured at power on
  */
 
  #include "mma8450q.h"
  #include "../i2c/i2c.h"
- #include "../msp430x22x4.h"
+ #include "../hal/hal.h"
  #include "stdint.h"
 
-void MMA8450Init(void)
+static void Select(const MMA8450 * dev)
 //-------------------------------------------------------------------------
-// Func:  Start I2C and initialize the accelerometer
+// Func:  Address the device's transfers to follow
+//-------------------------------------------------------------------------
+{
+    I2CSetSlaveAddr(dev->addr);
+}
+
+static void WriteReg(MMA8450 * dev, uint8_t reg, uint8_t data)
+//-------------------------------------------------------------------------
+// Func:  Write a register of the selected device, keeping the shadows
+//-------------------------------------------------------------------------
+{
+    if(reg == CTRL_REG1)
+    {
+        dev->ctrlReg1 = data;
+    }
+    else if(reg == CTRL_REG3)
+    {
+        dev->ctrlReg3 = data;
+    }
+    I2CSendRegister(reg, data);
+}
+
+void MMA8450InitBus(void)
+//-------------------------------------------------------------------------
+// Func:  Start I2C, before MMA8450Init. The sensors may still be powering
+//        up, MMA8450Init tells when one answers (see src/boot).
 // Args:  none
 // Retn:  none
 //-------------------------------------------------------------------------
 {
-    volatile uint32_t i;                // generic counter for delay
-    for(i = 0; i < 215000; i++);        // wait for power to stabilize
     I2CInitMaster();                    // initialize I2C in master mode
-    I2CSetSlaveAddr(0x1C);              // set slave address for accel
-    I2CSendRegister(CTRL_REG1,          // set active mode, +/-2g, 200Hz sample
-                   (FS_2G | DATA_RATE_400));
 }
 
-uint8_t MMA8450ReadXYZ(int16_t * retData)
+uint8_t MMA8450Init(MMA8450 * dev, uint8_t addr)
+//-------------------------------------------------------------------------
+// Func:  Check for an accelerometer at the address and initialize it
+// Args:  dev  - device context to fill in
+//        addr - MMA_ADDR_SA0_0 or MMA_ADDR_SA0_1
+// Retn:  1 if it answered with its WHO_AM_I, 0 if there is none, then
+//        nothing was written
+//-------------------------------------------------------------------------
+{
+    dev->addr = addr;
+    dev->ctrlReg1 = FS_STANDBY;         // power on values
+    dev->ctrlReg3 = 0;
+    Select(dev);
+    if(!I2CProbe() || I2CReadRegister(WHO_AM_I) != MMA_DEVICE_ID)
+    {
+        return 0;
+    }
+    WriteReg(dev, CTRL_REG1,            // set active mode, range and rate
+             (ACCEL_FS | ACCEL_DATA_RATE));     // from config.h
+    return 1;
+}
+
+static void WaitSample(MMA8450 * dev)
+//-------------------------------------------------------------------------
+// Func:  Poll STATUS until a new sample is ready. Reading STATUS leaves
+//        ZYXDR set, only reading the output registers up to OUT_Z_MSB
+//        (MMA8450ReadXYZ) clears it, so the sample must be read after.
+//-------------------------------------------------------------------------
+{
+    while(!(MMA8450ReadStatus(dev) & ZYXDR))
+    {
+    }
+}
+
+uint8_t MMA8450ReadXYZ(MMA8450 * dev, int16_t * retData)
 //-------------------------------------------------------------------------
 // Func:  Read the X, Y, and Z registers from the accelerometer
-// Args:  a pointer to a 3 byte array for storing the values
+// Args:  dev - the accelerometer
+//        retData - a pointer to a 3 element array for storing the values
 // Retn:  the status register
 //-------------------------------------------------------------------------
 {
-    int16_t data[7];
+    uint8_t data[7];
+    Select(dev);
     I2CReadMultRegisters(OUT_X_LSB, 7, data);  // read X,Y,Z
+    MMA8450Unpack(data, retData);
+
+    return data[6]; // return the status register
+}
+
+uint8_t MMA8450ReadAvg(MMA8450 * devs, uint8_t count, int16_t * retData)
+//-------------------------------------------------------------------------
+// Func:  Read the X, Y, and Z registers of one or two accelerometers back
+//        to back and average them. Their noise is independent, so two
+//        take it down by about the square root of 2 at the same sample
+//        rate. The average is rounded to 12 bits again, computed in offset
+//        binary so only unsigned values are shifted.
+// Args:  devs - the accelerometers
+//        count - 1 or 2
+//        retData - a pointer to a 3 element array for storing the values
+// Retn:  the first one's status register
+//-------------------------------------------------------------------------
+{
+    int16_t other[3];
+    uint8_t status = MMA8450ReadXYZ(&devs[0], retData);
+    uint8_t i;
+
+    if(count > 1)
+    {
+        MMA8450ReadXYZ(&devs[1], other);
+        for(i = 0; i < 3; i++)
+        {
+            retData[i] = (((uint16_t)(retData[i] ^ 0x800) + (other[i] ^ 0x800) + 1)
+                          >> 1) ^ 0x800;
+        }
+    }
+    return status;
+}
+
+void MMA8450Unpack(const uint8_t * data, int16_t * retData)
+//-------------------------------------------------------------------------
+// Func:  Combine the LSB/MSB register pairs into 12 bit readings
+// Args:  data - the 6 registers from OUT_X_LSB
+//        retData - pointer to a 3 element array for the readings
+// Retn:  none
+//-------------------------------------------------------------------------
+{
     uint8_t i;                                 // loop counter
 
     // convert the received data into a valid 12 bit value
     // left shift the MSB and or it with the LSB
     for(i = 0; i < 3; i++)
     {
-        retData[i] = (((data[i*2+1] & 0xFF) << 4) | (data[i*2] & 0x0F)) & 0x0FFF;
+        retData[i] = ((uint16_t)data[i*2+1] << 4) | (data[i*2] & 0x0F);
     }
-
-    return data[6]; // return the status register
 }
 
-void MMA8450SetZero()
+void MMA8450ReadSum(MMA8450 * devs, uint8_t count, int32_t * sums)
 //-------------------------------------------------------------------------
-// Func:  function to determine and set zero offsets to minimize error. using
-//        the method described in AN3916 from NXP/Freescale.
-//        http://www.nxp.com/assets/documents/data/en/application-notes/AN3916.pdf
-// Args:  none
+// Func:  Sum CAL_SAMPLES readings of each axis in the active mode, one per
+//        output sample of the first sensor, for measuring gravity. Dont
+//        move the robot while this runs, CAL_SAMPLES / ACCEL_ODR_HZ
+//        seconds. The sums take in the zero offsets of the sensors
+//        along with gravity, so none are written to OFF_X/Y/Z.
+// Args:  devs - the accelerometers, averaged as MMA8450ReadAvg
+//        count - 1 or 2
+//        sums - 3 element array for the sums of the sign extended readings
 // Retn:  none
 //-------------------------------------------------------------------------
 {
-    uint8_t i;                  // generic loop counter
-    volatile uint32_t j;        // delay loop counter
+    uint8_t j, k;               // loop counters
     int16_t accelData[3];       // array with accel value
-    int16_t xCal, yCal, zCal;   // calibration values
-
-    uint8_t ctrlReg1 = I2CReadRegister(CTRL_REG1);      // get current mode
 
-    for(i = 0; i < 2; i++)      // run twice for better accuracy
+    sums[0] = 0;
+    sums[1] = 0;
+    sums[2] = 0;
+    for(k = 0; k < CAL_SAMPLES; k++)
     {
-        I2CSendRegister(CTRL_REG1,      // change to 8g, 1.56 sample rate
-                       (FS_8G | DATA_RATE_1_56));
-
-        for(j = 0; j < 166667; j++);    // empty looop to delay for about 2s
-
-        MMA8450ReadXYZ(accelData);      // get readings
-        for(j = 0; j < 3; j++)          // calculate calibration values for
-        {                               // each axis
-            if(accelData[i] > 2047)
+        WaitSample(&devs[0]);
+        MMA8450ReadAvg(devs, count, accelData);
+        for(j = 0; j < 3; j++)
+        {
+            if(accelData[j] > 2047)
             {
-                accelData[i] -= 4096;
+                accelData[j] -= 4096;
             }
+            sums[j] += accelData[j];
         }
-        xCal += -1 * accelData[0];
-        yCal += -1 * accelData[1];
-        zCal += (256 - accelData[2]);
-
-        I2CSendRegister(CTRL_REG1, FS_STANDBY); // return to standby mode
-        I2CSendRegister(OFF_X, xCal);           // send calibration values
-        I2CSendRegister(OFF_Y, yCal);
-        I2CSendRegister(OFF_Z, zCal);
     }
+}
+
+void MMA8450SetRate(MMA8450 * dev, uint8_t dataRate)
+//-------------------------------------------------------------------------
+// Func:  Change the output data rate, keeping the range. CTRL_REG1 is only
+//        changed in standby, so this goes through standby and back; the
+//        first sample at the new rate is ready one new output period
+//        later. Call it just after reading a sample and no sample is lost
+//        as long as the next read is at least that far away.
+// Args:  dev - the accelerometer
+//        dataRate - DATA_RATE_ value, ACCEL_DATA_RATE or ACCEL_SLOW_RATE
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    Select(dev);
+    WriteReg(dev, CTRL_REG1, FS_STANDBY);
+    WriteReg(dev, CTRL_REG1, (ACCEL_FS | dataRate));
+}
+
+void MMA8450Standby(MMA8450 * dev)
+//-------------------------------------------------------------------------
+// Func:  Stop sampling, the registers keep their settings. MMA8450SetRate
+//        makes the sensor active again.
+// Args:  dev - the accelerometer
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    Select(dev);
+    WriteReg(dev, CTRL_REG1, FS_STANDBY);
+}
+
+uint8_t MMA8450ReadStatus(MMA8450 * dev)
+//-------------------------------------------------------------------------
+// Func:  Read the STATUS register, ZYXDR is set once a new sample is ready
+//        and stays set until the output registers are read
+// Args:  dev - the accelerometer
+// Retn:  the status register
+//-------------------------------------------------------------------------
+{
+    Select(dev);
+    return I2CReadRegister(MMA_STATUS);
+}
+
+uint8_t MMA8450ReadSysmod(MMA8450 * dev)
+//-------------------------------------------------------------------------
+// Func:  Read the SYSMOD register, SYSMOD_WAKE once the sensor samples
+//        at its active rate after MMA8450Init or MMA8450SetRate
+// Args:  dev - the accelerometer
+// Retn:  SYSMOD_STANDBY, SYSMOD_WAKE or SYSMOD_SLEEP
+//-------------------------------------------------------------------------
+{
+    Select(dev);
+    return I2CReadRegister(SYSMOD);
+}
+
+void MMA8450ConfigTransient(MMA8450 * dev, uint8_t cfg, uint8_t hpCutoff,
+                            uint8_t ths, uint8_t count)
+//-------------------------------------------------------------------------
+// Func:  Set up the transient engine, which compares the high pass filtered
+//        data of each enabled axis against a threshold. Goes through
+//        standby and back to the current mode.
+// Args:  dev      - the accelerometer
+//        cfg      - TRANSIENT_CFG, TRANS_ bits, 0 disables the engine
+//        hpCutoff - HP_FILTER_CUTOFF, SEL_0 (highest) to SEL_3
+//        ths      - TRANSIENT_THS, THS_FROM_MG() and optionally DBCNTM
+//        count    - samples the threshold must be exceeded for
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint8_t ctrlReg1 = dev->ctrlReg1;   // current mode
+
+    Select(dev);
+    WriteReg(dev, CTRL_REG1, FS_STANDBY);
+    WriteReg(dev, HP_FILTER_CUTOFF, hpCutoff);
+    WriteReg(dev, TRANSIENT_CFG, cfg);
+    WriteReg(dev, TRANSIENT_THS, ths);
+    WriteReg(dev, TRANSIENT_COUNT, count);
+    WriteReg(dev, CTRL_REG1, ctrlReg1); // return to previous operating mode
+}
+
+void MMA8450ConfigMotion(MMA8450 * dev, uint8_t engine, uint8_t cfg,
+                         uint8_t ths, uint8_t count)
+//-------------------------------------------------------------------------
+// Func:  Set up one of the two freefall/motion engines, which compare the
+//        unfiltered data (gravity included) against a threshold. Goes
+//        through standby and back to the current mode.
+// Args:  dev    - the accelerometer
+//        engine - 1 or 2
+//        cfg    - FF_MT_CFG, FF_MT_ bits, 0 disables the engine
+//        ths    - FF_MT_THS, THS_FROM_MG() and optionally DBCNTM
+//        count  - samples the condition must hold for
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint8_t base = (engine == 2) ? FF_MT_CGF_2 : FF_MT_CGF_1;
+    uint8_t ctrlReg1 = dev->ctrlReg1;   // current mode
+
+    Select(dev);
+    WriteReg(dev, CTRL_REG1, FS_STANDBY);
+    WriteReg(dev, base, cfg);
+    WriteReg(dev, base + (FF_MT_THS_1 - FF_MT_CGF_1), ths);
+    WriteReg(dev, base + (FF_MT_COUNT_1 - FF_MT_CGF_1), count);
+    WriteReg(dev, CTRL_REG1, ctrlReg1); // return to previous operating mode
+}
+
+void MMA8450RouteInterrupts(MMA8450 * dev, uint8_t enable, uint8_t toInt1,
+                            uint8_t ctrlReg3)
+//-------------------------------------------------------------------------
+// Func:  Enable interrupt sources and route them to the INT1 or INT2 pin.
+//        Goes through standby and back to the current mode.
+// Args:  dev      - the accelerometer
+//        enable   - CTRL_REG4, INT_ bits of the sources to enable
+//        toInt1   - CTRL_REG5, INT_ bits of the sources on INT1, the rest
+//                   go to INT2
+//        ctrlReg3 - CTRL_REG3, pin polarity and drive (IPOL, PP_OD) and
+//                   the WAKE_ sources for auto-sleep
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint8_t ctrlReg1 = dev->ctrlReg1;   // current mode
+
+    Select(dev);
+    WriteReg(dev, CTRL_REG1, FS_STANDBY);
+    WriteReg(dev, CTRL_REG3, ctrlReg3);
+    WriteReg(dev, CTRL_REG5, toInt1);
+    WriteReg(dev, CTRL_REG4, enable);
+    WriteReg(dev, CTRL_REG1, ctrlReg1); // return to previous operating mode
+}
+
+uint8_t MMA8450ReadEvents(MMA8450 * dev)
+//-------------------------------------------------------------------------
+// Func:  Read which sources are interrupting and clear the latched
+//        transient and motion events by reading their source registers,
+//        which releases the interrupt pins
+// Args:  dev - the accelerometer
+// Retn:  INT_SOURCE, INT_ bits
+//-------------------------------------------------------------------------
+{
+    uint8_t source;
+
+    Select(dev);
+    source = I2CReadRegister(INT_SOURCE);
+    if(source & INT_TRANS)
+    {
+        I2CReadRegister(TRANSIENT_SRC);
+    }
+    if(source & INT_FF_MT_1)
+    {
+        I2CReadRegister(FF_MT_SRC_1);
+    }
+    if(source & INT_FF_MT_2)
+    {
+        I2CReadRegister(FF_MT_SRC_2);
+    }
+    return source;
+}
+
+void MMA8450AutoSleep(MMA8450 * dev, uint8_t aslpRate, uint8_t count, uint8_t wake)
+//-------------------------------------------------------------------------
+// Func:  Set up auto-sleep: after count * ASLP_COUNT_MS without an event
+//        from the wake sources the sensor samples at the sleep rate, and
+//        the next such event brings it back to the active rate. The wake
+//        sources must also be enabled in CTRL_REG4. Goes through standby
+//        and back to the current mode.
+// Args:  dev      - the accelerometer
+//        aslpRate - ASLP_RATE_ value
+//        count    - ASLP_COUNT
+//        wake     - CTRL_REG3 WAKE_ bits, 0 turns auto-sleep off
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint8_t ctrlReg1 = dev->ctrlReg1;   // current mode
 
-    I2CSendRegister(CTRL_REG1, ctrlReg1);    // return to previous operating mode
+    Select(dev);
+    WriteReg(dev, CTRL_REG1, FS_STANDBY);
+    WriteReg(dev, ASLP_COUNT, count);
+    WriteReg(dev, CTRL_REG3,            // keep the pin setup
+             (dev->ctrlReg3 & (FIFO_GATE | IPOL | PP_OD)) | wake);
+    WriteReg(dev, CTRL_REG2, wake ? SLPE : 0);
+    WriteReg(dev, CTRL_REG1,            // return to previous operating mode
+             (ctrlReg1 & ~(ASLP_RATE1_BIT | ASLP_RATE0_BIT)) | aslpRate);
 }
@@ -8,11 +8,22 @@
  *  Version 1: 04/01/17 - Nathan Duprey
  *                      - Added register addresses
  *             04/03/17 - added CTRL_REG1 bit definitions
+ *             10/19/26 - active mode CTRL_REG1 from config.h
+ *             10/19/26 - added MMA8450ReadSum
+ *             10/19/26 - added MMA8450SetRate
+ *             10/19/26 - transient and motion engine bits, interrupt routing
+ *             10/19/26 - added MMA8450Standby, MMA8450ReadStatus
+ *             10/19/26 - auto-sleep
+ *             10/19/26 - per device context, two sensors averaged
+ *             10/19/26 - added MMA8450ReadSysmod
+ *             10/19/26 - MMA8450Unpack takes the register bytes
+ *             10/19/26 - removed MMA8450SetZero and the offsets it kept
  */
 
 #ifndef MMA8450Q_H_
 #define MMA8450Q_H_
 
+#include "../config.h"
 #include "stdint.h"
 
 // Register definitions from Table 11 in datasheet
@@ -127,6 +138,59 @@
 #define FS_2G           FS0_BIT
 #define FS_4G           FS1_BIT
 #define FS_8G           (FS1_BIT | FS0_BIT)
+// active mode settings from config.h
+#if ACCEL_ODR_HZ == 400
+#define ACCEL_DATA_RATE DATA_RATE_400
+#elif ACCEL_ODR_HZ == 200
+#define ACCEL_DATA_RATE DATA_RATE_200
+#elif ACCEL_ODR_HZ == 100
+#define ACCEL_DATA_RATE DATA_RATE_100
+#elif ACCEL_ODR_HZ == 50
+#define ACCEL_DATA_RATE DATA_RATE_50
+#else
+#error "ACCEL_ODR_HZ is not a MMA8450Q output data rate"
+#endif
+#if SLOW_ODR_HZ == 400
+#define ACCEL_SLOW_RATE DATA_RATE_400
+#elif SLOW_ODR_HZ == 200
+#define ACCEL_SLOW_RATE DATA_RATE_200
+#elif SLOW_ODR_HZ == 100
+#define ACCEL_SLOW_RATE DATA_RATE_100
+#elif SLOW_ODR_HZ == 50
+#define ACCEL_SLOW_RATE DATA_RATE_50
+#else
+#error "SLOW_ODR_HZ is not a MMA8450Q output data rate"
+#endif
+#if SLEEP_ODR_HZ == 50
+#define ACCEL_SLEEP_RATE    ASLP_RATE_50
+#elif SLEEP_ODR_HZ == 25
+#define ACCEL_SLEEP_RATE    ASLP_RATE_25
+#else
+#error "SLEEP_ODR_HZ is not a MMA8450Q sleep mode rate"
+#endif
+#if ACCEL_FS_G == 2
+#define ACCEL_FS        FS_2G
+#elif ACCEL_FS_G == 4
+#define ACCEL_FS        FS_4G
+#else
+#define ACCEL_FS        FS_8G
+#endif
+
+
+// CTRL_REG2 bit definitions
+#define ST_BIT      0x80        // self test
+#define BOOT_BIT    0x40        // reload the calibration
+#define SLPE        0x04        // auto-sleep enable
+
+
+// SYSMOD values
+#define SYSMOD_STANDBY  0x00
+#define SYSMOD_WAKE     0x01
+#define SYSMOD_SLEEP    0x02
+
+
+// ASLP_COUNT, quiet time before auto-sleep, per count
+#define ASLP_COUNT_MS   320
 
 
 // CTRL_REG3 bit definitions
@@ -140,10 +204,102 @@
 #define PP_OD       0x01
 
 
+// CTRL_REG4 interrupt enable, CTRL_REG5 routing (set routes the source to
+// INT1, clear to INT2) and INT_SOURCE bits, the same bit for each source
+#define INT_ASLP    0x80
+#define INT_FIFO    0x40
+#define INT_TRANS   0x20
+#define INT_LNDPRT  0x10
+#define INT_PULSE   0x08
+#define INT_FF_MT_1 0x04
+#define INT_FF_MT_2 0x02
+#define INT_DRDY    0x01
+
+
+// FF_MT_CFG_1/2 bit definitions
+#define FF_MT_ELE   0x80        // latch the event until FF_MT_SRC is read
+#define FF_MT_OAE   0x40        // 1 motion (any axis above), 0 freefall
+#define FF_MT_ZEFE  0x20        // (all axes below)
+#define FF_MT_YEFE  0x10
+#define FF_MT_XEFE  0x08
+// FF_MT_SRC_1/2 bit definitions
+#define FF_MT_EA    0x80        // event active
+#define FF_MT_ZHE   0x20
+#define FF_MT_ZHP   0x10
+#define FF_MT_YHE   0x08
+#define FF_MT_YHP   0x04
+#define FF_MT_XHE   0x02
+#define FF_MT_XHP   0x01
+
+
+// TRANSIENT_CFG bit definitions
+#define TRANS_ELE   0x10        // latch the event until TRANSIENT_SRC is read
+#define TRANS_ZTEFE 0x08
+#define TRANS_YTEFE 0x04
+#define TRANS_XTEFE 0x02
+#define TRANS_HPF_BYP   0x01    // compare the unfiltered data
+// TRANSIENT_SRC bit definitions
+#define TRANS_EA    0x40        // event active
+#define TRANS_ZTE   0x20
+#define TRANS_ZTP   0x10
+#define TRANS_YTE   0x08
+#define TRANS_YTP   0x04
+#define TRANS_XTE   0x02
+#define TRANS_XTP   0x01
+
+
+// FF_MT_THS_1/2 and TRANSIENT_THS bit definitions
+#define DBCNTM      0x80        // debounce counter clears instead of
+                                // counting down when the condition ends
+#define THS_MASK    0x7F
+// thresholds are 7 bits of 1/16 g whatever the full scale range
+#define THS_FROM_MG(mg)     (((mg) * 16L + 500) / 1000)
+
+
+
+// I2C addresses, set by the SA0 pin, and the WHO_AM_I value
+#define MMA_ADDR_SA0_0  0x1C
+#define MMA_ADDR_SA0_1  0x1D
+#define MMA_DEVICE_ID   0xC6
+#define MMA_MAX_DEVICES 2
+
+
+// interrupt pins, wired to port 2
+#define MMA_INT1_P2 0x01        // INT1 on P2.0
+#define MMA_INT2_P2 0x02        // INT2 on P2.1
+
+
+// gravity measurement at power on (MMA8450ReadSum), readings summed
+#define CAL_SHIFT   6
+#define CAL_SAMPLES (1 << CAL_SHIFT)
+
+// one sensor on the bus. The driver keeps copies of the control registers
+// it writes, so the settings can change without reading them back
+typedef struct
+{
+    uint8_t addr;           // 7 bit I2C address
+    uint8_t ctrlReg1;       // shadows of CTRL_REG1 and CTRL_REG3
+    uint8_t ctrlReg3;
+} MMA8450;
 
 // function prototypes
-void MMA8450Init(void);
-uint8_t MMA8450ReadXYZ(int16_t * retData);
-void MMA8450SetZero();
+void MMA8450InitBus(void);
+uint8_t MMA8450Init(MMA8450 * dev, uint8_t addr);
+uint8_t MMA8450ReadXYZ(MMA8450 * dev, int16_t * retData);
+uint8_t MMA8450ReadAvg(MMA8450 * devs, uint8_t count, int16_t * retData);
+void MMA8450Unpack(const uint8_t * data, int16_t * retData);
+void MMA8450ReadSum(MMA8450 * devs, uint8_t count, int32_t * sums);
+void MMA8450SetRate(MMA8450 * dev, uint8_t dataRate);
+void MMA8450Standby(MMA8450 * dev);
+uint8_t MMA8450ReadStatus(MMA8450 * dev);
+uint8_t MMA8450ReadSysmod(MMA8450 * dev);
+void MMA8450ConfigTransient(MMA8450 * dev, uint8_t cfg, uint8_t hpCutoff,
+                            uint8_t ths, uint8_t count);
+void MMA8450ConfigMotion(MMA8450 * dev, uint8_t engine, uint8_t cfg,
+                         uint8_t ths, uint8_t count);
+void MMA8450RouteInterrupts(MMA8450 * dev, uint8_t enable, uint8_t toInt1,
+                            uint8_t ctrlReg3);
+uint8_t MMA8450ReadEvents(MMA8450 * dev);
+void MMA8450AutoSleep(MMA8450 * dev, uint8_t aslpRate, uint8_t count, uint8_t wake);
 
 #endif
@@ -0,0 +1,104 @@
+/*
+ *  pack12.c
+ *  Packed 12 bit sample storage, see pack12.h.
+ *
+ *  The shifts are by 4 and 8 only: 8 is a byte access or a swap of the
+ *  bytes of a register, 4 is four single bit shifts on the MSP430.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include "pack12.h"
+#include "stdint.h"
+
+void Pack12(uint8_t * dst, const int16_t * src, uint16_t count)
+//-------------------------------------------------------------------------
+// Func:  Pack a run of samples
+// Args:  dst - PACK12_BYTES(count) bytes, the last half byte of an odd
+//              count is cleared
+//        src - samples, the low 12 bits are kept
+//        count - number of samples
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint16_t a, b;
+
+    for(; count >= 2; count -= 2)
+    {
+        a = src[0];
+        b = src[1];
+        dst[0] = (uint8_t)a;
+        dst[1] = ((a >> 8) & 0x0F) | (uint8_t)(b << 4);
+        dst[2] = (uint8_t)(b >> 4);
+        src += 2;
+        dst += 3;
+    }
+    if(count != 0)
+    {
+        a = src[0];
+        dst[0] = (uint8_t)a;
+        dst[1] = (a >> 8) & 0x0F;
+    }
+}
+
+void Unpack12(int16_t * dst, const uint8_t * src, uint16_t count)
+//-------------------------------------------------------------------------
+// Func:  Unpack a run of samples
+// Args:  dst - count samples, 0 to 0x0FFF
+//        src - PACK12_BYTES(count) packed bytes
+//        count - number of samples
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    for(; count >= 2; count -= 2)
+    {
+        dst[0] = src[0] | ((uint16_t)(src[1] & 0x0F) << 8);
+        dst[1] = (src[1] >> 4) | ((uint16_t)src[2] << 4);
+        src += 3;
+        dst += 2;
+    }
+    if(count != 0)
+    {
+        dst[0] = src[0] | ((uint16_t)(src[1] & 0x0F) << 8);
+    }
+}
+
+void Pack12Put(uint8_t * buf, uint16_t index, int16_t sample)
+//-------------------------------------------------------------------------
+// Func:  Store one sample, leaving its neighbours as they are
+// Args:  buf - packed buffer
+//        index - sample number
+//        sample - the low 12 bits are kept
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint8_t * p = buf + index + (index >> 1);
+
+    if(index & 1)
+    {
+        p[0] = (p[0] & 0x0F) | (uint8_t)(sample << 4);
+        p[1] = (uint8_t)((uint16_t)sample >> 4);
+    }
+    else
+    {
+        p[0] = (uint8_t)sample;
+        p[1] = (p[1] & 0xF0) | (((uint16_t)sample >> 8) & 0x0F);
+    }
+}
+
+int16_t Pack12Get(const uint8_t * buf, uint16_t index)
+//-------------------------------------------------------------------------
+// Func:  Read one sample
+// Args:  buf - packed buffer
+//        index - sample number
+// Retn:  the sample, 0 to 0x0FFF
+//-------------------------------------------------------------------------
+{
+    const uint8_t * p = buf + index + (index >> 1);
+
+    if(index & 1)
+    {
+        return (p[0] >> 4) | ((uint16_t)p[1] << 4);
+    }
+    return p[0] | ((uint16_t)(p[1] & 0x0F) << 8);
+}
@@ -0,0 +1,31 @@
+/*
+ *  pack12.h
+ *  Packed storage for 12 bit samples, two to three bytes instead of four,
+ *  for sample buffers and recordings that have to fit in the 1 KB of RAM.
+ *  Sample 2k takes byte 3k and the low half of byte 3k + 1, sample 2k + 1
+ *  the high half of byte 3k + 1 and byte 3k + 2, so sample i starts at
+ *  byte i + i / 2. The low 12 bits of a sample are stored and come back
+ *  in 0 to 0x0FFF, the accelerometer's raw format; SignExtend12 turns them
+ *  back into signed values. Nothing here multiplies or divides.
+ *
+ *  Pack12 and Unpack12 convert runs of samples a pair at a time,
+ *  Pack12Put and Pack12Get reach single samples anywhere in a buffer.
+ *  host/bench/fixcheck.c checks them against a plain bit copy.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#ifndef PACK12_H_
+#define PACK12_H_
+
+#include "stdint.h"
+
+// bytes taken by n packed samples
+#define PACK12_BYTES(n)     ((n) + ((n) + 1) / 2)
+
+void Pack12(uint8_t * dst, const int16_t * src, uint16_t count);
+void Unpack12(int16_t * dst, const uint8_t * src, uint16_t count);
+void Pack12Put(uint8_t * buf, uint16_t index, int16_t sample);
+int16_t Pack12Get(const uint8_t * buf, uint16_t index);
+
+#endif
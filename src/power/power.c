@@ -0,0 +1,133 @@
+/*
+ *  power.c
+ *  Low power phases of the run, see power.h.
+ *
+ *  The EZ430-RF2500 has no 32 kHz crystal, so ACLK comes from the VLO,
+ *  which is anywhere from 4 to 20 kHz. It is measured against SMCLK (the
+ *  calibrated DCO) right before each use.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - added PowerStandby
+ *             10/19/26 - battery sampling off while asleep
+ *             10/19/26 - one or two accelerometers
+ *             10/19/26 - watchdog paused while asleep
+ *             10/19/26 - left out of the duty cycle accounts
+ *             10/19/26 - corrected when ZYXDR clears
+ *             10/19/26 - LPM3 and LPM4 kept in the duty cycle accounts
+ */
+
+#include "power.h"
+#include "../hal/hal.h"
+#include "../mma8450q/mma8450q.h"
+#include "../batt/batt.h"
+#include "../wdog/wdog.h"
+#include "../duty/duty.h"
+#include "stdint.h"
+
+#define SLEEP_COUNT     (SLEEP_AFTER_MS / ASLP_COUNT_MS)
+#if SLEEP_COUNT < 1 || SLEEP_COUNT > 255
+#error "SLEEP_AFTER_MS does not fit ASLP_COUNT"
+#endif
+
+uint16_t PowerDwell(MMA8450 * mma, uint8_t count)
+//-------------------------------------------------------------------------
+// Func:  Wait DWELL_MS in LPM3 with the accelerometers in standby, then
+//        bring them back to ACCEL_DATA_RATE and Timer A back to the
+//        control loop tick. ACLK must be the VLO (BCSCTL3 LFXT1S_2)
+//        and the Timer A interrupt must clear LPM3_bits on exit. Battery
+//        sampling and the watchdog stop for the dwell.
+// Args:  mma   - the accelerometers
+//        count - 1 or 2
+// Retn:  wake up latency, SMCLK cycles from the end of the dwell to the
+//        first fresh sample of each
+//-------------------------------------------------------------------------
+{
+    uint16_t vlo;               // ACLK cycles in DWELL_CAL_CYCLES
+    uint16_t wake;
+    uint8_t i;
+
+    WdogPause();                // the calibration alone outlasts it
+    for(i = 0; i < count; i++)
+    {
+        MMA8450Standby(&mma[i]);    // nothing to read while asleep
+    }
+    BattStop();                 // nor convert, reference off
+
+    TACTL = TASSEL_1 | ID_0 | MC_2 | TACLR;     // ACLK, continuous, no
+    __delay_cycles(DWELL_CAL_CYCLES);           // interrupt, count it
+    vlo = TAR;                                  // against SMCLK
+
+    TACCR0 = (vlo << (DWELL_CAL_SHIFT - 3)) - 1;        // DWELL_MS at
+    TACTL = TASSEL_1 | ID_3 | MC_1 | TACLR | TAIE;      // ACLK / 8
+    DutyPause();                                // Timer B stops with SMCLK
+    __bis_SR_register(LPM3_bits | GIE);         // only ACLK runs
+    DutyResume(DUTY_DWELL);
+
+    TACTL = TASSEL_2 | ID_0 | MC_2 | TACLR;     // SMCLK, time the wake up
+    for(i = 0; i < count; i++)
+    {
+        MMA8450SetRate(&mma[i], ACCEL_DATA_RATE);
+    }
+    for(i = 0; i < count; i++)
+    {
+        // first sample ready; ZYXDR stays set until the loop's first
+        // MMA8450ReadXYZ reads the output registers, not cleared here
+        while(!(MMA8450ReadStatus(&mma[i]) & ZYXDR))
+        {
+        }
+    }
+    wake = TAR;
+
+    TACCR0 = TICK_TACCR0;                       // back to the loop tick
+    TACTL = TASSEL_2 | ID_0 | MC_1 | TACLR | TAIE;
+    BattStart();
+    WdogResume();
+    return wake;
+}
+
+void PowerStandby(MMA8450 * mma, uint8_t count)
+//-------------------------------------------------------------------------
+// Func:  Sleep in LPM4, all clocks off, until the first accelerometer's
+//        transient engine (set up by main, latched on INT1 at P2.0) sees a
+//        jolt, a second one is in standby meanwhile. The first drops to
+//        SLEEP_ODR_HZ once it has been quiet for SLEEP_AFTER_MS, and the
+//        jolt wakes it as well. Then Timer A is back at the control loop
+//        tick and the sensors at ACCEL_DATA_RATE. The Port 2 interrupt
+//        must clear LPM4_bits on exit. Battery sampling and the watchdog
+//        stop for the standby.
+// Args:  mma   - the accelerometers, the first one wakes the MCU
+//        count - 1 or 2
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    uint8_t i;
+
+    TACTL = TACLR;                      // stop the loop tick
+    BattStop();
+    WdogPause();
+    for(i = 1; i < count; i++)
+    {
+        MMA8450Standby(&mma[i]);
+    }
+    MMA8450AutoSleep(&mma[0], ACCEL_SLEEP_RATE, SLEEP_COUNT, WAKE_TRANS);
+
+    P2IFG &= ~MMA_INT1_P2;              // clear the flag before releasing
+    MMA8450ReadEvents(&mma[0]);         // INT1, a jolt from here on leaves
+    P2IE |= MMA_INT1_P2;                // an edge
+    DutyPause();
+    __bis_SR_register(LPM4_bits | GIE); // until the Port 2 interrupt
+    DutyResume(0);                      // a standby, not timed
+
+    MMA8450AutoSleep(&mma[0], ACCEL_SLEEP_RATE, 0, 0);  // stay at the full rate
+    for(i = 1; i < count; i++)
+    {
+        MMA8450SetRate(&mma[i], ACCEL_DATA_RATE);
+    }
+    P2IFG &= ~MMA_INT1_P2;
+    MMA8450ReadEvents(&mma[0]);         // release INT1 for the next jolt
+
+    TACCR0 = TICK_TACCR0;               // back to the loop tick
+    TACTL = TASSEL_2 | ID_0 | MC_1 | TACLR | TAIE;
+    BattStart();
+    WdogResume();
+}
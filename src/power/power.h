@@ -0,0 +1,23 @@
+/*
+ *  power.h
+ *  Low power phases of the run, where the control loop stops and the MCU
+ *  sleeps: the dwell at the finish line, in LPM3 with Timer A on ACLK from
+ *  the VLO, and the standby between runs, in LPM4 until the accelerometer
+ *  feels a nudge.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - added PowerStandby
+ *             10/19/26 - one or two accelerometers
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include "../config.h"
+#include "../mma8450q/mma8450q.h"
+#include "stdint.h"
+
+uint16_t PowerDwell(MMA8450 * mma, uint8_t count);
+void PowerStandby(MMA8450 * mma, uint8_t count);
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ *  proftable.c
+ *  Speed profile tables, generated by host/gen/profgen.c, see
+ *  proftable.h. Acceleration 1000 mm/s^2 to 1300 mm/s.
+ */
+
+#include "proftable.h"
+#include "stdint.h"
+
+// motor command for each averaged sample of the acceleration phase
+const uint8_t profCmd[PROF_LEN] =
+{
+    18, 19, 20, 21, 22, 24, 25, 26, 27, 28, 29, 30, 31, 32, 34, 35,
+    36, 37, 38, 39, 40, 41, 43, 44, 45, 46, 47, 48, 49, 50, 52, 53,
+    54, 55, 56, 57, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58, 58,
+    55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+    55, 55
+};
+
+// expected speed after each, velocity units
+const int16_t profVel[PROF_LEN] =
+{
+    108, 215, 322, 427, 532, 642, 751, 859, 966, 1072, 1177, 1281,
+    1385, 1488, 1597, 1704, 1811, 1916, 2021, 2126, 2229, 2332, 2440, 2547,
+    2653, 2759, 2863, 2967, 3071, 3173, 3281, 3388, 3495, 3600, 3704, 3808,
+    3911, 4008, 4098, 4183, 4262, 4336, 4405, 4469, 4530, 4586, 4639, 4689,
+    4717, 4744, 4769, 4792, 4814, 4834, 4853, 4871, 4888, 4903, 4918, 4932,
+    4944, 4956, 4967, 4978, 4988, 4997
+};
+
+// command for a steady speed, indexed by speed >> PROF_SPEED_SHIFT
+const uint8_t profSpeedCmd[PROF_SPEED_BINS] =
+{
+    0, 3, 3, 4, 4, 4, 4, 5, 5, 6, 7, 8, 8, 9, 10, 10,
+    11, 12, 12, 13, 14, 14, 15, 16, 16, 17, 18, 19, 19, 20, 21, 21,
+    22, 23, 23, 24, 25, 25, 26, 27, 27, 28, 29, 30, 30, 31, 32, 32,
+    33, 34, 34, 35, 36, 36, 37, 38, 38, 39, 40, 41, 41, 42, 43, 43,
+    44, 45, 45, 46, 47, 47, 48, 49, 49, 50, 51, 51, 52, 53, 54, 54,
+    55, 56, 56, 57, 58
+};
+
+// steady speed at each command, velocity units
+const int16_t profCmdVel[PROF_CMD_MAX + 1] =
+{
+    0, 0, 0, 0, 372, 466, 560, 654, 744, 838, 932, 1026,
+    1120, 1214, 1304, 1398, 1492, 1586, 1680, 1770, 1864, 1958, 2052, 2146,
+    2236, 2330, 2424, 2518, 2612, 2702, 2796, 2890, 2984, 3078, 3172, 3262,
+    3356, 3450, 3544, 3638, 3728, 3822, 3916, 4010, 4104, 4194, 4288, 4382,
+    4476, 4570, 4660, 4754, 4848, 4942, 5036, 5130, 5220, 5314, 5408, 5502,
+    5596, 5686, 5780, 5874
+};
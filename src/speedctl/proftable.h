@@ -0,0 +1,25 @@
+/*
+ *  proftable.h
+ *  Speed profile tables, generated by host/gen/profgen.c from
+ *  misc/drive_characterization.csv and config.h. Do not edit, rebuild
+ *  the profile-tables target instead.
+ */
+
+#ifndef PROFTABLE_H_
+#define PROFTABLE_H_
+
+#include "stdint.h"
+
+#define PROF_LEN        66      // averaged samples to reach cruise speed
+#define PROF_SPEED_SHIFT    6  // profSpeedCmd bin width, log2 velocity units
+#define PROF_SPEED_BINS 85
+#define PROF_VEL_MAX    6084L  // fastest possible speed plus 1/8
+#define PROF_LAG_SHIFT  4      // drive time constant, log2 averaged samples
+#define PROF_CMD_MAX    63     // last profCmdVel command, full speed
+
+extern const uint8_t profCmd[PROF_LEN];
+extern const int16_t profVel[PROF_LEN];
+extern const uint8_t profSpeedCmd[PROF_SPEED_BINS];
+extern const int16_t profCmdVel[PROF_CMD_MAX + 1];
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ *  speedctl.c
+ *  Speed profile and PI speed controller for the drive, see speedctl.h.
+ *  The gains are powers of two so an update is shifts and adds.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - table driven ramp with feedforward command
+ *             10/19/26 - added SpeedCtlSteady
+ *             10/19/26 - added SpeedCtlModel
+ *             10/19/26 - added SpeedCtlCompensate
+ */
+
+#include "speedctl.h"
+#include "stdint.h"
+
+static uint8_t FeedForward(int32_t speed)
+//-------------------------------------------------------------------------
+// Func:  Look up the command that holds a steady speed
+// Args:  speed - velocity units, not negative
+// Retn:  motor command, 0 to SPEED_CMD_MAX
+//-------------------------------------------------------------------------
+{
+    int32_t i = speed >> PROF_SPEED_SHIFT;
+
+    if(i >= PROF_SPEED_BINS)
+    {
+        i = PROF_SPEED_BINS - 1;
+    }
+    return profSpeedCmd[i];
+}
+
+void SpeedCtlInit(SpeedCtl * ctl)
+//-------------------------------------------------------------------------
+// Func:  Reset the controller before a leg, starting from rest
+// Args:  ctl - controller state
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    ctl->setpoint = 0;
+    ctl->integ = 0;
+    ctl->tick = 0;
+    ctl->cmdRef = 0;
+    ctl->held = 0;
+}
+
+uint8_t SpeedCtlUpdate(SpeedCtl * ctl, int32_t speed, int32_t cruise,
+                       int32_t remaining)
+//-------------------------------------------------------------------------
+// Func:  Advance the speed profile and run the PI controller, once per
+//        averaged sample. While accelerating the setpoint and the
+//        feedforward command are read from profVel and profCmd, after that
+//        the setpoint is the cruise speed. Near the end it tapers linearly
+//        with the remaining distance down to the approach speed. The PI
+//        terms only correct around the feedforward.
+// Args:  ctl       - controller state
+//        speed     - estimated speed along the leg, velocity units
+//        cruise    - cruise speed, velocity units
+//        remaining - distance left before the stop command, distance units
+// Retn:  motor command, 0 (stopped) to SPEED_CMD_MAX
+//-------------------------------------------------------------------------
+{
+    int32_t sp = cruise;
+    int32_t approach = SPEED_APPROACH_VEL;
+    int32_t ff;
+    int32_t err;
+    int32_t integ;
+    int32_t u;
+
+    if(remaining > 0)
+    {
+        approach += remaining >> SPEED_APPROACH_SHIFT;
+    }
+    if(approach < sp)
+    {
+        sp = approach;
+    }
+    if(ctl->tick < PROF_LEN && profVel[ctl->tick] <= sp)
+    {
+        sp = profVel[ctl->tick];
+        ff = profCmd[ctl->tick];
+        ctl->tick++;
+    }
+    else
+    {
+        ctl->tick = PROF_LEN;   // capped by cruise or approach, ramp is over
+        ff = FeedForward(sp);
+    }
+    ctl->setpoint = sp;
+
+    err = sp - speed;
+    integ = ctl->integ + err;
+    u = ff + (err >> SPEED_KP_SHIFT) + (integ >> SPEED_KI_SHIFT);
+
+    // anti-windup: only integrate while the output is not saturated, or
+    // when the error drives it back out of saturation
+    if(u > SPEED_CMD_MAX)
+    {
+        u = SPEED_CMD_MAX;
+        if(err < 0)
+        {
+            ctl->integ = integ;
+        }
+    }
+    else if(u < 0)
+    {
+        u = 0;
+        if(err > 0)
+        {
+            ctl->integ = integ;
+        }
+    }
+    else
+    {
+        ctl->integ = integ;
+    }
+
+    if(u >= ctl->cmdRef - 1 && u <= ctl->cmdRef + 1)
+    {
+        if(ctl->held < 255)
+        {
+            ctl->held++;
+        }
+    }
+    else
+    {
+        ctl->cmdRef = (uint8_t)u;
+        ctl->held = 0;
+    }
+
+    return (uint8_t)u;
+}
+
+uint8_t SpeedCtlSteady(const SpeedCtl * ctl)
+//-------------------------------------------------------------------------
+// Func:  Whether the drive is at a steady speed: the command has stayed
+//        within one count for STEADY_WINDOWS updates, long enough for the
+//        drive's lag to have settled
+// Args:  ctl - controller state
+// Retn:  1 if steady, 0 otherwise
+//-------------------------------------------------------------------------
+{
+    return (ctl->held >= STEADY_WINDOWS);
+}
+
+int32_t SpeedCtlLimit(int32_t vel)
+//-------------------------------------------------------------------------
+// Func:  Sanity check on the integrated velocity. The drive cannot go
+//        faster than PROF_VEL_MAX, so a larger estimate is accumulated
+//        offset error and is clipped before it reaches the distance.
+// Args:  vel - estimated velocity, either direction
+// Retn:  vel limited to +-PROF_VEL_MAX
+//-------------------------------------------------------------------------
+{
+    if(vel > PROF_VEL_MAX)
+    {
+        return PROF_VEL_MAX;
+    }
+    if(vel < -PROF_VEL_MAX)
+    {
+        return -PROF_VEL_MAX;
+    }
+    return vel;
+}
+
+static uint8_t MotorOffset(uint8_t cmd, uint8_t stop)
+//-------------------------------------------------------------------------
+// Func:  How far a motor command byte is from the motor's stop value
+// Args:  cmd  - byte sent, 0 stops both motors
+//        stop - the motor's stop value, MOTOR1_STOP or MOTOR2_STOP
+// Retn:  offset, 0 to PROF_CMD_MAX, either direction
+//-------------------------------------------------------------------------
+{
+    uint8_t d;
+
+    if(cmd == 0)
+    {
+        return 0;
+    }
+    d = (cmd > stop) ? cmd - stop : stop - cmd;
+    return (d > PROF_CMD_MAX) ? PROF_CMD_MAX : d;
+}
+
+int32_t SpeedCtlModel(int32_t model, const uint8_t * sent)
+//-------------------------------------------------------------------------
+// Func:  Advance the drive model by one averaging period: a first order
+//        lag of 2^PROF_LAG_SHIFT periods toward the steady speed of the
+//        commands in effect over it, the mean of the two sides' profCmdVel.
+//        The commands are taken as sent, trims included, but before
+//        SpeedCtlCompensate, which keeps their speeds nominal.
+// Args:  model - modelled speed magnitude, velocity units, 0 at rest
+//        sent  - the two motor command bytes last sent
+// Retn:  modelled speed at the end of the period
+//-------------------------------------------------------------------------
+{
+    int32_t target = ((int32_t)profCmdVel[MotorOffset(sent[0], MOTOR1_STOP)] +
+                      profCmdVel[MotorOffset(sent[1], MOTOR2_STOP)]) >> 1;
+    int32_t err = target - model;
+
+    // rounded, the model settles within 2^(PROF_LAG_SHIFT - 1) of the
+    // target
+    return model + ((err + (1 << (PROF_LAG_SHIFT - 1))) >> PROF_LAG_SHIFT);
+}
+
+void SpeedCtlCompensate(const uint8_t * cmd, uint8_t * out, uint16_t scale)
+//-------------------------------------------------------------------------
+// Func:  Scale the motor commands for the battery: each byte's offset from
+//        its motor's stop value is multiplied by scale, rounded and capped
+//        at full command. The controller, feedforward and drive model work
+//        on the nominal commands, this is only applied to the bytes sent.
+// Args:  cmd   - the two nominal motor command bytes, 0 stops both
+//        out   - the two bytes to send
+//        scale - Q8, BattScale
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    static const uint8_t stops[2] = {MOTOR1_STOP, MOTOR2_STOP};
+    uint16_t d;
+    uint8_t i;
+
+    for(i = 0; i < 2; i++)
+    {
+        if(cmd[i] == 0)
+        {
+            out[i] = 0;
+            continue;
+        }
+        d = ((uint16_t)MotorOffset(cmd[i], stops[i]) * scale + 128) >> 8;
+        if(d > PROF_CMD_MAX)
+        {
+            d = PROF_CMD_MAX;
+        }
+        out[i] = (cmd[i] > stops[i]) ? stops[i] + (uint8_t)d : stops[i] - (uint8_t)d;
+    }
+}
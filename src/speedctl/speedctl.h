@@ -0,0 +1,49 @@
+/*
+ *  speedctl.h
+ *  Speed profile and PI speed controller for the drive. Works on speed
+ *  magnitudes in estimator velocity units (config.h), so both legs use it,
+ *  and returns a motor command offset from the Sabertooth stop value. This
+ *  module does not touch any registers.
+ *
+ *  The acceleration ramp and the feedforward command come from the flash
+ *  tables in proftable.c, generated from the drive characterization. The
+ *  same characterization gives a model of the drive, the speed the
+ *  commands sent lead to, for the estimator's complementary filter.
+ *
+ *  Version 1: 10/19/26 - initial version
+ *             10/19/26 - profile and feedforward from proftable
+ *             10/19/26 - steady command detection for the bias estimate
+ *             10/19/26 - drive model, speed from the commands sent
+ *             10/19/26 - battery compensation of the commands
+ */
+
+#ifndef SPEEDCTL_H_
+#define SPEEDCTL_H_
+
+#include "../config.h"
+#include "proftable.h"
+#include "stdint.h"
+
+// Sabertooth simplified serial stop values, motor 1 and motor 2. A 0 byte
+// stops both.
+#define MOTOR1_STOP     64
+#define MOTOR2_STOP     192
+
+typedef struct
+{
+    int32_t setpoint;   // target speed, velocity units
+    int32_t integ;      // integral of the speed error
+    uint8_t tick;       // averaged samples into the acceleration table
+    uint8_t cmdRef;     // command the last steady stretch started at
+    uint8_t held;       // updates the command stayed within 1 of cmdRef
+} SpeedCtl;
+
+void SpeedCtlInit(SpeedCtl * ctl);
+uint8_t SpeedCtlUpdate(SpeedCtl * ctl, int32_t speed, int32_t cruise,
+                       int32_t remaining);
+uint8_t SpeedCtlSteady(const SpeedCtl * ctl);
+int32_t SpeedCtlLimit(int32_t vel);
+int32_t SpeedCtlModel(int32_t model, const uint8_t * sent);
+void SpeedCtlCompensate(const uint8_t * cmd, uint8_t * out, uint16_t scale);
+
+#endif
@@ -7,11 +7,14 @@
  *
  *  Version 1: 04/01/17 - Nathan Duprey
  *                      - added init and send functions
+ *             10/19/26 - byte count
  */
 
  #include "stdint.h"
  #include "uart.h"
- #include "../msp430x22x4.h"
+ #include "../hal/hal.h"
+
+static uint16_t bytes;      // bytes sent, wraps
 
 void UARTInit(void)
 //-------------------------------------------------------------------------
@@ -38,6 +41,7 @@ void UARTSendByte(uint8_t data)
 {
     while(!(IFG2 & UCA0TXIFG));     // wait for tx buffer to empty
     UCA0TXBUF = data;               // put data in tx buffer
+    bytes++;
 }
 
 void UARTSend(uint8_t * data, uint8_t length)
@@ -55,3 +59,13 @@ void UARTSend(uint8_t * data, uint8_t length)
         UARTSendByte(data[i]);
     }
 }
+
+uint16_t UARTBytes(void)
+//-------------------------------------------------------------------------
+// Func:  Bytes handed to the transmitter
+// Args:  None
+// Retn:  count since power on, wraps at 16 bits
+//-------------------------------------------------------------------------
+{
+    return bytes;
+}
@@ -8,6 +8,7 @@
  *
  *  Version 1: 04/01/17 - Nathan Duprey
  *                      - added init and send functions
+ *             10/19/26 - added UARTBytes
  */
 
 #ifndef UART_H_
@@ -18,5 +19,6 @@
 void UARTInit(void);
 void UARTSendByte(uint8_t data);
 void UARTSend(uint8_t * data, uint8_t length);
+uint16_t UARTBytes(void);
 
 #endif
@@ -0,0 +1,102 @@
+/*
+ *  wdog.c
+ *  Watchdog timer, see wdog.h.
+ *
+ *  The control word of the current mode is kept so WdogKick and
+ *  WdogResume can write it back with WDTCNTCL. In watchdog mode the WDT+
+ *  keeps its clock running in low power modes (the clock fail-safe), so
+ *  sourced from SMCLK it would keep the DCO on through an LPM3 dwell and
+ *  still run out; holding it is the only way to sleep.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#include "wdog.h"
+#include "../hal/hal.h"
+#include "stdint.h"
+
+// interval select for 32768, 8192, 512 or 64 clock cycles
+#define WDOG_IS(n)      ((n) == 32768L ? 0 : (n) == 8192L ? WDTIS0 : \
+                         (n) == 512L ? WDTIS1 : WDTIS1 | WDTIS0)
+
+static uint16_t ctl = WDTPW | WDTHOLD;  // control word of the mode
+
+void WdogStart(uint8_t mode)
+//-------------------------------------------------------------------------
+// Func:  Start the watchdog in a mode, counting from 0
+// Args:  mode - WDOG_SUPERVISE, reset after WDOG_CYCLES of SMCLK without a
+//               WdogKick, WDOG_INTERVAL, WDT_VECTOR every WDOG_TICK_ACLK
+//               cycles of ACLK, or WDOG_OFF, held
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    if(mode == WDOG_SUPERVISE)
+    {
+        ctl = WDTPW | WDTCNTCL | WDOG_IS(WDOG_CYCLES);
+    }
+    else if(mode == WDOG_INTERVAL)
+    {
+        ctl = WDTPW | WDTTMSEL | WDTCNTCL | WDTSSEL | WDOG_IS(WDOG_TICK_ACLK);
+    }
+    else
+    {
+        ctl = WDTPW | WDTHOLD;
+    }
+    WDTCTL = ctl;
+    IE1 &= ~WDTIE;
+    if(mode == WDOG_INTERVAL)
+    {
+        IFG1 &= ~WDTIFG;
+        IE1 |= WDTIE;
+    }
+}
+
+void WdogKick(void)
+//-------------------------------------------------------------------------
+// Func:  Clear the watchdog count. Called once per control loop tick from
+//        the loop itself, not from an interrupt, which would go on while
+//        the loop hangs. Does nothing unless supervising.
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    if(!(ctl & (WDTHOLD | WDTTMSEL)))
+    {
+        WDTCTL = ctl;
+    }
+}
+
+void WdogPause(void)
+//-------------------------------------------------------------------------
+// Func:  Hold the watchdog for a sleep longer than its interval
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    WDTCTL = WDTPW | WDTHOLD;
+}
+
+void WdogResume(void)
+//-------------------------------------------------------------------------
+// Func:  Restart the mode WdogPause interrupted, counting from 0
+// Args:  none
+// Retn:  none
+//-------------------------------------------------------------------------
+{
+    WDTCTL = ctl;
+}
+
+uint8_t WdogFired(void)
+//-------------------------------------------------------------------------
+// Func:  Check for and clear the watchdog reset flag. Call before starting
+//        interval mode, which sets the same flag.
+// Args:  none
+// Retn:  1 if the last reset was the watchdog running out (or a WDTCTL
+//        write without the password), 0 after power on
+//-------------------------------------------------------------------------
+{
+    uint8_t fired = (IFG1 & WDTIFG) != 0;
+
+    IFG1 &= ~WDTIFG;
+    return fired;
+}
@@ -0,0 +1,34 @@
+/*
+ *  wdog.h
+ *  Watchdog timer (WDT+), used one of two ways. As a watchdog
+ *  (WDOG_SUPERVISE) it resets the MCU unless the control loop clears it
+ *  within WDOG_CYCLES of SMCLK, so a hang in one of the polled I2C or
+ *  UART waits ends in a reset, and main sends the stop command again
+ *  first thing. As an interval timer (WDOG_INTERVAL) it interrupts every
+ *  WDOG_TICK_ACLK cycles of ACLK for slow background work, the battery
+ *  conversions, which leaves Timer A to the loop tick and the encoder.
+ *  It cannot do both at once.
+ *
+ *  main holds it from its first line, a watchdog reset leaves WDTIFG set
+ *  (WdogFired). PowerDwell and PowerStandby pause it while asleep.
+ *
+ *  Version 1: 10/19/26 - initial version
+ */
+
+#ifndef WDOG_H_
+#define WDOG_H_
+
+#include "../config.h"
+#include "stdint.h"
+
+#define WDOG_OFF        0   // held
+#define WDOG_SUPERVISE  1   // watchdog, WdogKick every control loop tick
+#define WDOG_INTERVAL   2   // interval timer, WDT_VECTOR
+
+void WdogStart(uint8_t mode);
+void WdogKick(void);
+void WdogPause(void);
+void WdogResume(void);
+uint8_t WdogFired(void);
+
+#endif